@@ -38,6 +38,7 @@
 #include <stdlib.h>
 #include <string.h> 
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -54,6 +55,7 @@
 #endif
 
 #include <glib.h>
+#include <glib/gstdio.h>
 
 /***************************************************************************/
 
@@ -66,12 +68,17 @@ public:
 	bool checkWord (const char *word, size_t len);
 	char **suggestWord (const char* const word, size_t len, size_t *out_n_suggs);
 
-	bool requestDictionary (const char * szLang);
+	bool requestDictionary (const char * dic);
+
+	/* the size of the dictionary's files, which hunspell keeps in memory
+	 * in much the same amount */
+	size_t memoryUsage () const { return m_memory_usage; }
 
 private:
 	GIConv  m_translate_in; /* Selected translation from/to Unicode */
 	GIConv  m_translate_out;
 	Hunspell *hunspell;
+	size_t m_memory_usage;
 };
 
 /***************************************************************************/
@@ -83,7 +90,7 @@ g_iconv_is_valid(GIConv i)
 }
 
 HunspellChecker::HunspellChecker()
-: m_translate_in(nullptr), m_translate_out(nullptr), hunspell(nullptr)
+: m_translate_in(nullptr), m_translate_out(nullptr), hunspell(nullptr), m_memory_usage(0)
 {
 }
 
@@ -96,18 +103,37 @@ HunspellChecker::~HunspellChecker()
 		g_iconv_close(m_translate_out);
 }
 
+static bool
+isAscii(const char *word, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+		if (static_cast<unsigned char>(word[i]) >= 0x80)
+			return false;
+	return true;
+}
+
 bool
 HunspellChecker::checkWord(const char *utf8Word, size_t len)
 {
 	if (len > MAXWORDLEN || !g_iconv_is_valid(m_translate_in))
 		return false;
 
-	// the 8bit encodings use precomposed forms
-	char *normalizedWord = g_utf8_normalize (utf8Word, len, G_NORMALIZE_NFC);
-	char *in = normalizedWord;
+	// the 8bit encodings use precomposed forms, which ASCII words already are
+	char *normalizedWord = nullptr;
+	char asciiWord[MAXWORDLEN + 1];
+	char *in;
+	size_t len_in;
+	if (isAscii(utf8Word, len)) {
+		memcpy(asciiWord, utf8Word, len);
+		in = asciiWord;
+		len_in = len;
+	} else {
+		normalizedWord = g_utf8_normalize (utf8Word, len, G_NORMALIZE_NFC);
+		in = normalizedWord;
+		len_in = strlen(in);
+	}
 	char word8[MAXWORDLEN + 1];
 	char *out = word8;
-	size_t len_in = strlen(in);
 	size_t len_out = sizeof( word8 ) - 1;
 	size_t result = g_iconv(m_translate_in, &in, &len_in, &out, &len_out);
 	g_free(normalizedWord);
@@ -197,31 +223,83 @@ s_buildDictionaryDirs (std::vector<std::string> & dirs)
 #endif
 }
 
+/* What a dictionary directory held when it was last read. Adding, removing
+ * or renaming a file changes the modification time of its directory, so
+ * the directory is only read again when that changes. */
+struct DictionaryDir
+{
+	DictionaryDir() : mtime(-1), current(false) {}
+
+	gint64 mtime;
+	bool current;			/* whether dics reflects mtime */
+	std::vector<std::string> dics;	/* the .dic files with an .aff file beside them */
+};
+
+/* The dictionary directories by path, kept in the provider's user_data */
+typedef std::map<std::string, DictionaryDir> DictionaryIndex;
+
+/* Dictionaries may be requested from several threads at once */
+static GMutex s_dictionaryIndexLock;
+
 static void
-s_buildHashNames (std::vector<std::string> & names, const char * dict)
+s_readDictionaryDir (const std::string & path, gint64 mtime, DictionaryDir & dir)
 {
-	names.clear ();
+	dir.dics.clear ();
+	dir.mtime = mtime;
 
-	std::vector<std::string> dirs;
-	s_buildDictionaryDirs (dirs);
+	GDir * gdir = g_dir_open (path.c_str(), 0, nullptr);
+	if (gdir) {
+		const char * entry;
 
-	char *dict_dic = g_strconcat(dict, ".dic", nullptr);
-	for (size_t i = 0; i < dirs.size(); i++)
-		{
-			char *tmp = g_build_filename (dirs[i].c_str(), dict_dic, nullptr);
-			names.push_back (tmp);
-			g_free (tmp);
+		while ((entry = g_dir_read_name (gdir)) != NULL) {
+			size_t len = strlen (entry);
+			if (len > 4 && strcmp (entry + len - 4, ".dic") == 0) {
+				std::string aff (entry, len - 3);
+				aff += "aff";
+				char * aff_path = g_build_filename (path.c_str(), aff.c_str(), nullptr);
+				if (g_file_test (aff_path, G_FILE_TEST_EXISTS))
+					dir.dics.push_back (entry);
+				g_free (aff_path);
+			}
 		}
 
-	g_free(dict_dic);
+		g_dir_close (gdir);
+	}
+
+	/* a file added within the same second would not change the time, so
+	 * read a directory changed that recently again next time */
+	dir.current = g_get_real_time () / G_USEC_PER_SEC > dir.mtime + 1;
 }
 
-static bool
-s_hasCorrespondingAffFile(const std::string & dicFile)
+/* Fills @dirs with copies of the dictionary directories in search order,
+ * reading again those that changed since they were last read */
+static void
+s_getDictionaryDirs (EnchantProvider * me, std::vector<std::pair<std::string, DictionaryDir> > & dirs)
 {
-    std::string aff = dicFile;
-    aff.replace(aff.end()-3,aff.end(), "aff");
-    return g_file_test(aff.c_str(), G_FILE_TEST_EXISTS) != 0;
+	DictionaryIndex * index = static_cast<DictionaryIndex *>(me->user_data);
+	std::vector<std::string> paths;
+
+	s_buildDictionaryDirs (paths);
+
+	dirs.clear ();
+	g_mutex_lock (&s_dictionaryIndexLock);
+	for (size_t i = 0; i < paths.size(); i++)
+		{
+			DictionaryDir & dir = (*index)[paths[i]];
+			GStatBuf st;
+
+			if (g_stat (paths[i].c_str(), &st) != 0)
+				{
+					dir.mtime = -1;
+					dir.current = true;
+					dir.dics.clear ();
+				}
+			else if (!dir.current || dir.mtime != st.st_mtime)
+				s_readDictionaryDir (paths[i], st.st_mtime, dir);
+
+			dirs.push_back (std::make_pair (paths[i], dir));
+		}
+	g_mutex_unlock (&s_dictionaryIndexLock);
 }
 
 static bool is_plausible_dict_for_tag(const char *dir_entry, const char *tag)
@@ -246,62 +324,49 @@ static bool is_plausible_dict_for_tag(const char *dir_entry, const char *tag)
 }
 
 static char *
-hunspell_request_dictionary (const char * tag)
+hunspell_request_dictionary (EnchantProvider * me, const char * tag)
 {
-	std::vector<std::string> names;
+	std::vector<std::pair<std::string, DictionaryDir> > dirs;
+	std::string dic (tag);
 
-	s_buildHashNames (names, tag);
+	dic += ".dic";
+	s_getDictionaryDirs (me, dirs);
 
-	for (size_t i = 0; i < names.size (); i++) {
-		if (g_file_test(names[i].c_str(), G_FILE_TEST_EXISTS)) {
-			if(s_hasCorrespondingAffFile(names[i])){
-				return strdup (names[i].c_str());
-			}
-		}
+	for (size_t i = 0; i < dirs.size(); i++) {
+		const std::vector<std::string> & dics = dirs[i].second.dics;
+		for (size_t j = 0; j < dics.size(); j++)
+			if (dics[j] == dic)
+				return g_build_filename (dirs[i].first.c_str(), dic.c_str(), nullptr);
 	}
-	
-	std::vector<std::string> dirs;
-	s_buildDictionaryDirs (dirs);
 
 	for (size_t i = 0; i < dirs.size(); i++) {
-		GDir *dir = g_dir_open (dirs[i].c_str(), 0, nullptr);
-		if (dir) {
-			const char *dir_entry;
-			while ((dir_entry = g_dir_read_name (dir)) != NULL) {
-				if (is_plausible_dict_for_tag(dir_entry, tag)) {
-					char *dict = g_build_filename (dirs[i].c_str(), 
-								       dir_entry, nullptr);
-                    if(s_hasCorrespondingAffFile(dict)){
-			                    g_dir_close (dir);
-					    return dict;
-                    }
-				}
-			}
-
-			g_dir_close (dir);
-		}
+		const std::vector<std::string> & dics = dirs[i].second.dics;
+		for (size_t j = 0; j < dics.size(); j++)
+			if (is_plausible_dict_for_tag(dics[j].c_str(), tag))
+				return g_build_filename (dirs[i].first.c_str(), dics[j].c_str(), nullptr);
 	}
 
 	return NULL;
 }
 
 bool
-HunspellChecker::requestDictionary(const char *szLang)
+HunspellChecker::requestDictionary(const char *dic)
 {
-	char *dic = NULL, *aff = NULL;
-
-	dic = hunspell_request_dictionary (szLang);
-	if (!dic)
-		return false;
+	char *aff = NULL;
 
 	aff = strdup(dic);
 	int len_dic = strlen(dic);
 	strcpy(aff+len_dic-3, "aff");
 	if (g_file_test(aff, G_FILE_TEST_EXISTS))
 	{
+		GStatBuf st;
+
 		hunspell = new Hunspell(aff, dic);
+		if (g_stat(aff, &st) == 0)
+			m_memory_usage += st.st_size;
+		if (g_stat(dic, &st) == 0)
+			m_memory_usage += st.st_size;
 	}
-	free(dic);
 	free(aff);
 	if(hunspell == NULL){
 		return false;
@@ -342,56 +407,54 @@ hunspell_dict_check (EnchantDict * me, const char *const word, size_t len)
 }
 
 static void
-hunspell_provider_enum_dicts (const char * const directory,
-			     std::vector<std::string> & out_dicts)
+hunspell_dict_check_many (EnchantDict * me, const char *const *const words,
+			  const size_t *const lens, size_t n_words, int *results)
 {
-	GDir * dir = g_dir_open (directory, 0, nullptr);
-	if (dir) {
-		const char * entry;
-		
-		while ((entry = g_dir_read_name (dir)) != NULL) {
-			char * utf8_entry = g_filename_to_utf8 (entry, -1, nullptr, nullptr, nullptr);
-			if (utf8_entry) {
-				std::string dir_entry (utf8_entry);
-				g_free (utf8_entry);
-
-				int hit = dir_entry.rfind (".dic");
-				if (hit != -1) {
-					/* don't include hyphenation dictionaries
-					   and require .aff file to be present*/
-					if(dir_entry.compare (0, 5, "hyph_") != 0)
-					{
-						std::string name(dir_entry.substr (0, hit));
-						std::string affFileName(name + ".aff");
-						char * aff = g_build_filename(directory, affFileName.c_str(), nullptr);
-						if (g_file_test(aff, G_FILE_TEST_EXISTS))
-						{
-							out_dicts.push_back (dir_entry.substr (0, hit));
-						}
-						g_free(aff);
-					}
-				}
-			}
-		}
+	HunspellChecker * checker;
 
-		g_dir_close (dir);
-	}
+	checker = static_cast<HunspellChecker *>(me->user_data);
+
+	for (size_t i = 0; i < n_words; i++)
+		results[i] = checker->checkWord(words[i], lens[i]) ? 0 : 1;
+}
+
+static size_t
+hunspell_dict_get_memory_usage (EnchantDict * me)
+{
+	HunspellChecker * checker;
+
+	checker = static_cast<HunspellChecker *>(me->user_data);
+	return checker->memoryUsage ();
 }
 
 extern "C" {
 
 static char ** 
-hunspell_provider_list_dicts (EnchantProvider * me _GL_UNUSED_PARAMETER, 
+hunspell_provider_list_dicts (EnchantProvider * me, 
 			      size_t * out_n_dicts)
 {
-	std::vector<std::string> dict_dirs, dicts;
+	std::vector<std::pair<std::string, DictionaryDir> > dict_dirs;
+	std::vector<std::string> dicts;
 	char ** dictionary_list = NULL;
 
-	s_buildDictionaryDirs (dict_dirs);
+	s_getDictionaryDirs (me, dict_dirs);
 
 	for (size_t i = 0; i < dict_dirs.size(); i++)
 		{
-			hunspell_provider_enum_dicts (dict_dirs[i].c_str(), dicts);
+			const std::vector<std::string> & dics = dict_dirs[i].second.dics;
+			for (size_t j = 0; j < dics.size(); j++)
+				{
+					/* don't include hyphenation dictionaries */
+					if (dics[j].compare (0, 5, "hyph_") == 0)
+						continue;
+
+					char * utf8_entry = g_filename_to_utf8 (dics[j].c_str(), dics[j].size() - 4,
+										nullptr, nullptr, nullptr);
+					if (utf8_entry) {
+						dicts.push_back (utf8_entry);
+						g_free (utf8_entry);
+					}
+				}
 		}
 
 	if (dicts.size () > 0) {
@@ -406,25 +469,31 @@ hunspell_provider_list_dicts (EnchantProvider * me _GL_UNUSED_PARAMETER,
 }
 
 static EnchantDict *
-hunspell_provider_request_dict(EnchantProvider * me _GL_UNUSED_PARAMETER, const char *const tag)
+hunspell_provider_request_dict(EnchantProvider * me, const char *const tag)
 {
 	EnchantDict *dict;
 	HunspellChecker * checker;
-	
-	checker = new HunspellChecker();
-	
-	if (!checker)
+	char * dic;
+
+	dic = hunspell_request_dictionary (me, tag);
+	if (!dic)
 		return NULL;
+
+	checker = new HunspellChecker();
 	
-	if (!checker->requestDictionary(tag)) {
+	if (!checker->requestDictionary(dic)) {
 		delete checker;
+		g_free (dic);
 		return NULL;
 	}
+	g_free (dic);
 	
 	dict = g_new0(EnchantDict, 1);
 	dict->user_data = (void *) checker;
 	dict->check = hunspell_dict_check;
+	dict->check_many = hunspell_dict_check_many;
 	dict->suggest = hunspell_dict_suggest;
+	dict->get_memory_usage = hunspell_dict_get_memory_usage;
 	// don't implement personal, session
 	
 	return dict;
@@ -442,20 +511,20 @@ hunspell_provider_dispose_dict (EnchantProvider * me _GL_UNUSED_PARAMETER, Encha
 }
 
 static int
-hunspell_provider_dictionary_exists (struct str_enchant_provider * me _GL_UNUSED_PARAMETER,
+hunspell_provider_dictionary_exists (struct str_enchant_provider * me,
 				     const char *const tag)
 {
-	std::vector <std::string> names;
+	std::vector<std::pair<std::string, DictionaryDir> > dirs;
+	std::string dic (tag);
 
-	s_buildHashNames (names, tag);
-	for (size_t i = 0; i < names.size(); i++) {
-		if (g_file_test (names[i].c_str(), G_FILE_TEST_EXISTS))
-		{
-			std::string aff(names[i]);
-			aff.replace(aff.end() - 3, aff.end(), "aff");
-			if (g_file_test(aff.c_str(), G_FILE_TEST_EXISTS))
+	dic += ".dic";
+	s_getDictionaryDirs (me, dirs);
+
+	for (size_t i = 0; i < dirs.size(); i++) {
+		const std::vector<std::string> & dics = dirs[i].second.dics;
+		for (size_t j = 0; j < dics.size(); j++)
+			if (dics[j] == dic)
 				return 1;
-		}
 	}
 
 	return 0;
@@ -464,6 +533,7 @@ hunspell_provider_dictionary_exists (struct str_enchant_provider * me _GL_UNUSED
 static void
 hunspell_provider_dispose (EnchantProvider * me)
 {
+	delete static_cast<DictionaryIndex *>(me->user_data);
 	g_free (me);
 }
 
@@ -485,6 +555,7 @@ init_enchant_provider (void)
 	EnchantProvider *provider;
 	
 	provider = g_new0(EnchantProvider, 1);
+	provider->user_data = new DictionaryIndex();
 	provider->dispose = hunspell_provider_dispose;
 	provider->request_dict = hunspell_provider_request_dict;
 	provider->dispose_dict = hunspell_provider_dispose_dict;
@@ -492,6 +563,7 @@ init_enchant_provider (void)
 	provider->identify = hunspell_provider_identify;
 	provider->describe = hunspell_provider_describe;
 	provider->list_dicts = hunspell_provider_list_dicts;
+	provider->concurrent_request_dict = 1;
 
 	return provider;
 }
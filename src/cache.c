@@ -0,0 +1,292 @@
+/* enchant
+ * Copyright (C) 2003 Dom Lachowicz
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02110-1301, USA.
+ *
+ * In addition, as a special exception, Dom Lachowicz
+ * gives permission to link the code of this program with
+ * non-LGPL Spelling Provider libraries (eg: a MSFT Office
+ * spell checker backend) and distribute linked combinations including
+ * the two.  You must obey the GNU Lesser General Public License in all
+ * respects for all of the code used other than said providers.  If you modify
+ * this file, you may extend this exception to your version of the
+ * file, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+/**
+ *
+ *  This file implements the caches of check results and suggestions in
+ *  the type EnchantCache.
+ *
+ *  Entries are kept in a hash table for lookup and in a queue, most
+ *  recently used first, to find the entry to forget when the cache is
+ *  full. A generation count, increased on every invalidation, lets
+ *  callers compute a value without holding the cache locked and still
+ *  never store a value computed before the last invalidation.
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "cache.h"
+
+/* Words shorter than this are looked up without being copied to the heap */
+#define ENCHANT_CACHE_KEY_LEN 64
+
+typedef struct str_enchant_cache_entry
+{
+	char *word;
+	gpointer value;
+} EnchantCacheEntry;
+
+struct str_enchant_cache
+{
+	GMutex lock;
+	GHashTable *map;	/* word -> link of its entry in lru */
+	GQueue lru;		/* EnchantCacheEntries, most recently used first */
+	size_t max_entries;
+	gint enabled;		/* whether max_entries is not 0, read without the lock */
+	guint generation;
+
+	size_t hits;
+	size_t misses;
+
+	GCopyFunc value_copy;
+	GDestroyNotify value_destroy;
+};
+
+static void
+enchant_cache_entry_free (EnchantCache * me, EnchantCacheEntry * entry)
+{
+	if (me->value_destroy)
+		(*me->value_destroy) (entry->value);
+	g_free (entry->word);
+	g_free (entry);
+}
+
+static void
+enchant_cache_remove_oldest (EnchantCache * me)
+{
+	EnchantCacheEntry * entry;
+
+	entry = (EnchantCacheEntry *) g_queue_pop_tail (&me->lru);
+	g_hash_table_remove (me->map, entry->word);
+	enchant_cache_entry_free (me, entry);
+}
+
+static void
+enchant_cache_clear (EnchantCache * me)
+{
+	while (!g_queue_is_empty (&me->lru))
+		enchant_cache_remove_oldest (me);
+}
+
+EnchantCache*
+enchant_cache_new (GCopyFunc value_copy, GDestroyNotify value_destroy)
+{
+	EnchantCache * me = g_new0 (EnchantCache, 1);
+
+	g_mutex_init (&me->lock);
+	/* keys are owned by the entries */
+	me->map = g_hash_table_new (g_str_hash, g_str_equal);
+	g_queue_init (&me->lru);
+	me->value_copy = value_copy;
+	me->value_destroy = value_destroy;
+
+	return me;
+}
+
+void
+enchant_cache_free (EnchantCache * me)
+{
+	g_return_if_fail (me);
+
+	enchant_cache_clear (me);
+	g_hash_table_destroy (me->map);
+	g_mutex_clear (&me->lock);
+	g_free (me);
+}
+
+void
+enchant_cache_set_size (EnchantCache * me, size_t max_entries)
+{
+	g_return_if_fail (me);
+
+	g_mutex_lock (&me->lock);
+	me->max_entries = max_entries;
+	g_atomic_int_set (&me->enabled, max_entries != 0);
+	while (g_queue_get_length (&me->lru) > max_entries)
+		enchant_cache_remove_oldest (me);
+	me->hits = me->misses = 0;
+	g_mutex_unlock (&me->lock);
+}
+
+size_t
+enchant_cache_get_size (EnchantCache * me)
+{
+	size_t max_entries;
+
+	g_return_val_if_fail (me, 0);
+
+	g_mutex_lock (&me->lock);
+	max_entries = me->max_entries;
+	g_mutex_unlock (&me->lock);
+
+	return max_entries;
+}
+
+gboolean
+enchant_cache_is_enabled (EnchantCache * me)
+{
+	g_return_val_if_fail (me, FALSE);
+
+	return g_atomic_int_get (&me->enabled);
+}
+
+gboolean
+enchant_cache_lookup (EnchantCache * me, const char *const word, size_t len,
+		      gpointer * value)
+{
+	char key[ENCHANT_CACHE_KEY_LEN];
+	char * utf;
+	GList * link;
+
+	g_return_val_if_fail (me, FALSE);
+	g_return_val_if_fail (word, FALSE);
+	g_return_val_if_fail (value, FALSE);
+
+	/* a cache that is off costs no copy and no locking */
+	if (!g_atomic_int_get (&me->enabled))
+		return FALSE;
+
+	if (len < sizeof (key))
+		{
+			memcpy (key, word, len);
+			key[len] = '\0';
+			utf = key;
+		}
+	else
+		utf = g_strndup (word, len);
+
+	g_mutex_lock (&me->lock);
+	if (!me->max_entries)
+		link = NULL;
+	else if ((link = (GList *) g_hash_table_lookup (me->map, utf)) != NULL)
+		{
+			EnchantCacheEntry * entry = (EnchantCacheEntry *) link->data;
+
+			g_queue_unlink (&me->lru, link);
+			g_queue_push_head_link (&me->lru, link);
+			*value = me->value_copy ? (*me->value_copy) (entry->value, NULL) : entry->value;
+			me->hits++;
+		}
+	else
+		me->misses++;
+	g_mutex_unlock (&me->lock);
+
+	if (utf != key)
+		g_free (utf);
+
+	return link != NULL;
+}
+
+guint
+enchant_cache_get_generation (EnchantCache * me)
+{
+	g_return_val_if_fail (me, 0);
+
+	return (guint) g_atomic_int_get ((gint *) &me->generation);
+}
+
+void
+enchant_cache_insert (EnchantCache * me, const char *const word, size_t len,
+		      gpointer value, guint generation)
+{
+	EnchantCacheEntry * entry = NULL;
+	GList * link;
+	char * utf;
+
+	g_return_if_fail (me);
+	g_return_if_fail (word);
+
+	if (!g_atomic_int_get (&me->enabled))
+		{
+			if (me->value_destroy)
+				(*me->value_destroy) (value);
+			return;
+		}
+
+	utf = g_strndup (word, len);
+
+	g_mutex_lock (&me->lock);
+	if (me->max_entries && me->generation == generation)
+		{
+			if ((link = (GList *) g_hash_table_lookup (me->map, utf)) != NULL)
+				{
+					/* another thread got there first */
+					g_queue_unlink (&me->lru, link);
+					g_queue_push_head_link (&me->lru, link);
+				}
+			else
+				{
+					if (g_queue_get_length (&me->lru) >= me->max_entries)
+						enchant_cache_remove_oldest (me);
+
+					entry = g_new (EnchantCacheEntry, 1);
+					entry->word = utf;
+					entry->value = value;
+					g_queue_push_head (&me->lru, entry);
+					g_hash_table_insert (me->map, entry->word, me->lru.head);
+				}
+		}
+	g_mutex_unlock (&me->lock);
+
+	if (!entry)
+		{
+			if (me->value_destroy)
+				(*me->value_destroy) (value);
+			g_free (utf);
+		}
+}
+
+void
+enchant_cache_invalidate (EnchantCache * me)
+{
+	g_return_if_fail (me);
+
+	g_mutex_lock (&me->lock);
+	g_atomic_int_inc ((gint *) &me->generation);
+	enchant_cache_clear (me);
+	g_mutex_unlock (&me->lock);
+}
+
+void
+enchant_cache_get_stats (EnchantCache * me, size_t * hits, size_t * misses)
+{
+	g_return_if_fail (me);
+
+	g_mutex_lock (&me->lock);
+	if (hits)
+		*hits = me->hits;
+	if (misses)
+		*misses = me->misses;
+	g_mutex_unlock (&me->lock);
+}
@@ -0,0 +1,77 @@
+/* enchant
+ * Copyright (C) 2003 Dom Lachowicz
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02110-1301, USA.
+ *
+ * In addition, as a special exception, Dom Lachowicz
+ * gives permission to link the code of this program with
+ * non-LGPL Spelling Provider libraries (eg: a MSFT Office
+ * spell checker backend) and distribute linked combinations including
+ * the two.  You must obey the GNU Lesser General Public License in all
+ * respects for all of the code used other than said providers.  If you modify
+ * this file, you may extend this exception to your version of the
+ * file, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A bounded map from words to values which forgets the least recently used
+ * words first. All calls may be made from several threads at once. */
+typedef struct str_enchant_cache EnchantCache;
+
+/* @value_copy makes the copies of values that lookups return, and
+ * @value_destroy frees values; either may be NULL */
+EnchantCache* enchant_cache_new(GCopyFunc value_copy, GDestroyNotify value_destroy);
+void enchant_cache_free(EnchantCache * me);
+
+/* Holds at most @max_entries words from now on, 0 turning the cache off.
+ * Also resets the hit and miss counts. */
+void enchant_cache_set_size(EnchantCache * me, size_t max_entries);
+size_t enchant_cache_get_size(EnchantCache * me);
+
+/* Whether the cache holds any words, for callers to skip copying values
+ * they would insert; reads no lock */
+gboolean enchant_cache_is_enabled(EnchantCache * me);
+
+/* Returns whether @word is in the cache, and a copy of its value in @value */
+gboolean enchant_cache_lookup(EnchantCache * me, const char *const word, size_t len,
+			      gpointer * value);
+
+/* Values are computed from the state things were in when
+ * enchant_cache_get_generation was called; enchant_cache_insert takes
+ * ownership of @value and drops it if the cache was invalidated since */
+guint enchant_cache_get_generation(EnchantCache * me);
+void enchant_cache_insert(EnchantCache * me, const char *const word, size_t len,
+			  gpointer value, guint generation);
+
+/* Forgets all words, to be called whenever their values may have changed */
+void enchant_cache_invalidate(EnchantCache * me);
+
+void enchant_cache_get_stats(EnchantCache * me, size_t * hits, size_t * misses);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CACHE_H */
@@ -89,6 +89,27 @@ namespace enchant
 				return false; // never reached
 			}
 
+			std::vector<bool> check (const std::vector<std::string> & utf8words) {
+				std::vector<const char *> words (utf8words.size ());
+				std::vector<ssize_t> lens (utf8words.size ());
+				std::vector<unsigned char> misspelled ((utf8words.size () + 7) / 8);
+				std::vector<bool> result (utf8words.size ());
+
+				for (size_t i = 0; i < utf8words.size (); i++) {
+					words[i] = utf8words[i].c_str ();
+					lens[i] = utf8words[i].size ();
+				}
+
+				if (enchant_dict_check_many (m_dict, words.data (), lens.data (),
+							     words.size (), misspelled.data ()) < 0)
+					throw enchant::Exception (enchant_dict_get_error (m_dict));
+
+				for (size_t i = 0; i < result.size (); i++)
+					result[i] = !(misspelled[i / 8] & (1 << (i % 8)));
+
+				return result;
+			}
+
 			void suggest (const std::string & utf8word, 
 				      std::vector<std::string> & out_suggestions) {
 				size_t n_suggs;
@@ -231,6 +252,17 @@ namespace enchant
 				return new Dict (dict, m_broker);
 			}
 
+			Dict * request_dict_for_thread (const std::string & lang) {
+				EnchantDict * dict = enchant_broker_request_dict_for_thread (m_broker, lang.c_str());
+				
+				if (!dict) {
+					throw enchant::Exception (enchant_broker_get_error (m_broker));
+					return 0; // never reached
+				}
+				
+				return new Dict (dict, m_broker);
+			}
+
 			Dict * request_pwl_dict (const std::string & pwl) {
 				EnchantDict * dict = enchant_broker_request_pwl_dict (m_broker, pwl.c_str());
 				
@@ -251,6 +283,10 @@ namespace enchant
 			void set_ordering (const std::string & tag, const std::string & ordering) {
 				enchant_broker_set_ordering (m_broker, tag.c_str(), ordering.c_str());
 			}
+
+			void set_pwl_refresh_interval (int msecs) {
+				enchant_broker_set_pwl_refresh_interval (m_broker, msecs);
+			}
 			
 			void describe (EnchantBrokerDescribeFn fn, void * user_data = NULL) {
 				enchant_broker_describe (m_broker, fn, user_data);
@@ -105,7 +105,7 @@ main (int argc, char **argv)
 		}
 	}
 	
-	broker = enchant_broker_init ();
+	broker = enchant_broker_init_lazy ();
 	
 	if (mode == 0) {
 		enchant_broker_describe (broker, enumerate_providers, stdout);
@@ -111,6 +111,14 @@ struct str_enchant_dict
 	
 	void (*add_to_exclude) (struct str_enchant_dict * me,
 				 const char *const word, size_t len);
+
+	/* optional; stores in results[i] what check would return for words[i] */
+	void (*check_many) (struct str_enchant_dict * me,
+			    const char *const *const words, const size_t *const lens,
+			    size_t n_words, int *results);
+
+	/* optional; an estimate of the memory the dictionary takes, in bytes */
+	size_t (*get_memory_usage) (struct str_enchant_dict * me);
 };
 	
 struct str_enchant_provider
@@ -137,6 +145,11 @@ struct str_enchant_provider
 
 	char ** (*list_dicts) (struct str_enchant_provider * me,
 							   size_t * out_n_dicts);
+
+	/* optional; non-zero if request_dict may be called while other threads
+	 * call into the provider, so that dictionaries can load in parallel.
+	 * Otherwise the broker calls the provider one thread at a time. */
+	int concurrent_request_dict;
 };
 
 #ifdef __cplusplus
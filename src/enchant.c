@@ -62,6 +62,45 @@ typedef enum
 		MODE_L
 	} IspellMode_t;
 
+/* The stages of parse_file timed with -P */
+typedef enum
+	{
+		STAGE_READ,
+		STAGE_TOKENIZE,
+		STAGE_CHECK,
+		STAGE_SUGGEST,
+		STAGE_OUTPUT,
+		N_STAGES
+	} Stage_t;
+
+static const char * const stage_names[N_STAGES] = {
+	"read", "tokenize", "check", "suggest", "output"
+};
+
+static gboolean time_stages = FALSE;
+static gint64 stage_usecs[N_STAGES];
+static size_t n_tokens;
+
+/* The time a stage starts, if stages are timed */
+#define stage_start() (time_stages ? g_get_monotonic_time () : 0)
+
+static void
+stage_end (Stage_t stage, gint64 start)
+{
+	if (time_stages)
+		stage_usecs[stage] += g_get_monotonic_time () - start;
+}
+
+static void
+print_stage_times (FILE * to)
+{
+	int i;
+
+	fprintf (to, "tokens\t%lu\n", (unsigned long)n_tokens);
+	for (i = 0; i < N_STAGES; i++)
+		fprintf (to, "%s_usecs\t%ld\n", stage_names[i], (long)stage_usecs[i]);
+}
+
 static void 
 print_version (FILE * to)
 {
@@ -79,6 +118,8 @@ print_help (FILE * to, const char * prog)
   -h Show this help message\n\
   -l lists misspellings\n\
   -L displays line numbers\n\
+  -p FILE uses the word list in FILE instead of a dictionary\n\
+  -P prints the time spent in each stage on standard error\n\
   -v displays program version.\n", prog);
 }
 
@@ -136,19 +177,31 @@ static void
 do_mode_a (FILE * out, EnchantDict * dict, GString * word, size_t start_pos, size_t lineCount, gboolean terse_mode)
 {
 	size_t n_suggs;
-	char ** suggs;	
+	char ** suggs;
+	gboolean correct;
+	gint64 start;
+
+	start = stage_start ();
+	correct = word->len <= MIN_WORD_LENGTH || enchant_dict_check (dict, word->str, word->len) == 0;
+	stage_end (STAGE_CHECK, start);
 
-	if (word->len <= MIN_WORD_LENGTH || enchant_dict_check (dict, word->str, word->len) == 0) {
+	if (correct) {
+		start = stage_start ();
 		if (!terse_mode) {
 			if (lineCount)
 				fprintf (out, "* %u\n", (unsigned int)lineCount);
 			else
 				fwrite ("*\n", 1, 2, out);
 		}
+		stage_end (STAGE_OUTPUT, start);
 	}
 	else {
+		start = stage_start ();
 		suggs = enchant_dict_suggest (dict, word->str, 
 					      word->len, &n_suggs);
+		stage_end (STAGE_SUGGEST, start);
+
+		start = stage_start ();
 		if (!n_suggs || !suggs) {
 			fwrite ("# ", 1, 2, out);
 			if (lineCount)
@@ -177,17 +230,27 @@ do_mode_a (FILE * out, EnchantDict * dict, GString * word, size_t start_pos, siz
 
 			enchant_dict_free_string_list (dict, suggs);
 		}
+		stage_end (STAGE_OUTPUT, start);
 	}
 }
 
 static void
 do_mode_l (FILE * out, EnchantDict * dict, GString * word, size_t lineCount)
 {
-	if (enchant_dict_check (dict, word->str, word->len) != 0) {
+	gboolean correct;
+	gint64 start;
+
+	start = stage_start ();
+	correct = enchant_dict_check (dict, word->str, word->len) == 0;
+	stage_end (STAGE_CHECK, start);
+
+	if (!correct) {
+		start = stage_start ();
 		if (lineCount)
 			fprintf (out, "%u ", (unsigned int)lineCount);
 		print_utf (out, word->str);
 		fwrite ("\n", 1, 1, out);
+		stage_end (STAGE_OUTPUT, start);
 	}
 }
 
@@ -376,7 +439,7 @@ tokenize_line (GString * line)
 }
 
 static int
-parse_file (FILE * in, FILE * out, IspellMode_t mode, int countLines, gchar *dictionary)
+parse_file (FILE * in, FILE * out, IspellMode_t mode, int countLines, gchar *dictionary, gchar *pwl)
 {
 	EnchantBroker * broker;
 	EnchantDict * dict;
@@ -387,11 +450,15 @@ parse_file (FILE * in, FILE * out, IspellMode_t mode, int countLines, gchar *dic
 	size_t pos, lineCount = 0;
 
 	gboolean was_last_line = FALSE, corrected_something = FALSE, terse_mode = FALSE;
+	gint64 start;
 
 	if (mode == MODE_A)
 		print_version (out);
 
-	if (dictionary) {
+	if (pwl) {
+		lang = NULL;
+	}
+	else if (dictionary) {
 		lang = convert_language_code (dictionary);
 	}
 	else {
@@ -402,11 +469,17 @@ parse_file (FILE * in, FILE * out, IspellMode_t mode, int countLines, gchar *dic
 
 	/* Enchant will get rid of useless trailing garbage like de_DE@euro or de_DE.ISO-8859-15 */
 	
-	broker = enchant_broker_init ();
-	dict = enchant_broker_request_dict (broker, lang);
+	broker = enchant_broker_init_lazy ();
+	if (lang)
+		dict = enchant_broker_request_dict (broker, lang);
+	else
+		dict = enchant_broker_request_pwl_dict (broker, pwl);
 
 	if (!dict) {
-		fprintf (stderr, "Couldn't create a dictionary for %s\n", lang);
+		if (lang)
+			fprintf (stderr, "Couldn't create a dictionary for %s\n", lang);
+		else
+			fprintf (stderr, "Couldn't open the word list %s\n", pwl);
 		free (lang);
 		enchant_broker_free (broker);
 		return 1;
@@ -418,7 +491,9 @@ parse_file (FILE * in, FILE * out, IspellMode_t mode, int countLines, gchar *dic
 	
 	while (!was_last_line) {
 		gboolean mode_A_no_command = FALSE;
+		start = stage_start ();
 		was_last_line = consume_line (in, str);
+		stage_end (STAGE_READ, start);
 
 		if (countLines)
 			lineCount++;
@@ -490,7 +565,9 @@ parse_file (FILE * in, FILE * out, IspellMode_t mode, int countLines, gchar *dic
 			}
 
 			if (mode != MODE_A || mode_A_no_command) {
+				start = stage_start ();
 				token_ptr = tokens = tokenize_line (str);
+				stage_end (STAGE_TOKENIZE, start);
 				if (tokens == NULL)
 					putc('\n', out);
 				while (tokens != NULL) {
@@ -500,6 +577,7 @@ parse_file (FILE * in, FILE * out, IspellMode_t mode, int countLines, gchar *dic
 					tokens = tokens->next;
 					pos = GPOINTER_TO_INT(tokens->data);
 					tokens = tokens->next;
+					n_tokens++;
 
 					if (mode == MODE_A)
 						do_mode_a (out, dict, word, pos, lineCount, terse_mode);
@@ -513,13 +591,18 @@ parse_file (FILE * in, FILE * out, IspellMode_t mode, int countLines, gchar *dic
 			}
 		} 
 		
+		start = stage_start ();
 		if (mode == MODE_A && corrected_something) {
 			fwrite ("\n", 1, 1, out);
 		}
 		g_string_truncate (str, 0);
 		fflush (out);
+		stage_end (STAGE_OUTPUT, start);
 	}
 
+	if (time_stages)
+		print_stage_times (stderr);
+
 	enchant_broker_free_dict (broker, dict);
 	enchant_broker_free (broker);
 
@@ -539,6 +622,7 @@ int main (int argc, char ** argv)
 
 	int countLines = 0;
 	gchar *dictionary = 0;  /* -d dictionary */
+	gchar *pwl = 0;  /* -p word list */
 
 	/* Initialize system locale */
 	setlocale(LC_ALL, "");
@@ -570,6 +654,12 @@ int main (int argc, char ** argv)
 				     	i++;
 					dictionary = argv[i];  /* Emacs calls ispell with '-d dictionary'. */
 				}
+				else if (arg[1] == 'p') {
+					i++;
+					pwl = argv[i];
+				}
+				else if (arg[1] == 'P')
+					time_stages = TRUE;
 			} 
 			else if ((strlen (arg) == 3) && (arg[1] == 'v') && (arg[2] == 'v')) {
 				mode = MODE_VERSION;   /* Emacs calls ispell with '-vv'. */
@@ -577,6 +667,9 @@ int main (int argc, char ** argv)
 			else if (arg[1] == 'd') {
 			        dictionary = arg + 2;  /* Accept "-ddictionary", i.e. no space between -d and dictionary. */
 			}
+			else if (arg[1] == 'p') {
+				pwl = arg + 2;
+			}
 			else if (strlen (arg) > 2) {
 				fprintf (stderr, "-%c does not take any parameters.\n", arg[1]);
 				exit(1);
@@ -603,7 +696,7 @@ int main (int argc, char ** argv)
 			}
 		}
 		
-		rval = parse_file (fp, stdout, mode, countLines, dictionary);
+		rval = parse_file (fp, stdout, mode, countLines, dictionary, pwl);
 		
 		if (file)
 			fclose (fp);
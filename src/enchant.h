@@ -39,6 +39,7 @@ extern "C" {
 
 typedef struct str_enchant_broker EnchantBroker;
 typedef struct str_enchant_dict   EnchantDict;
+typedef struct str_enchant_suggest_request EnchantSuggestRequest;
 
 const char *enchant_get_version (void);
 
@@ -47,9 +48,32 @@ const char *enchant_get_version (void);
  *
  * Returns: A new broker object capable of requesting
  * dictionaries from providers.
+ *
+ * A broker and the dictionaries requested from it may be used from
+ * several threads at once, except that enchant_broker_free and the
+ * last enchant_broker_free_dict of a dictionary must not race with
+ * other calls on the same object. Words are checked concurrently;
+ * calls that reach a provider are serialized per dictionary, see
+ * enchant_broker_request_dict_for_thread.
  */
 EnchantBroker *enchant_broker_init (void);
 
+/**
+ * enchant_broker_init_lazy
+ *
+ * Returns: A new broker object like the one enchant_broker_init returns,
+ * but which only loads a provider once a request gets to it.
+ *
+ * What the broker needs to know of the providers without loading them
+ * is kept in a manifest in the user's configuration directory, which is
+ * rebuilt for a provider whenever its module changes. Dictionary requests
+ * load the providers that last listed the tag first, and the others
+ * only if none of those has it; listing the dictionaries loads them all.
+ * A provider is still loaded, and its dictionaries listed again, before
+ * one it comes ahead of in the ordering is chosen.
+ */
+EnchantBroker *enchant_broker_init_lazy (void);
+
 /**
  * enchant_broker_free
  * @broker: A non-null #EnchantBroker
@@ -67,6 +91,61 @@ void enchant_broker_free (EnchantBroker * broker);
  */
 EnchantDict *enchant_broker_request_dict (EnchantBroker * broker, const char *const tag);
 
+/**
+ * enchant_broker_request_dict_for_thread
+ * @broker: A non-null #EnchantBroker
+ * @tag: The non-null language tag you wish to request a dictionary for ("en_US", "de_DE", ...)
+ *
+ * Like enchant_broker_request_dict, but the calling thread gets a
+ * dictionary of its own from the provider, so that threads checking
+ * words in the same language do not wait for each other. The session
+ * and the personal and exclude word lists are shared with the
+ * dictionary enchant_broker_request_dict returns for @tag. Requesting
+ * again from the same thread returns the same dictionary. If the
+ * provider cannot open another dictionary, the shared one is returned.
+ *
+ * Free the dictionary with enchant_broker_free_dict, preferably before
+ * the thread exits.
+ *
+ * Returns: An #EnchantDict, or %null if no suitable dictionary could be found. This dictionary is reference counted.
+ */
+EnchantDict *enchant_broker_request_dict_for_thread (EnchantBroker * broker, const char *const tag);
+
+/**
+ * enchant_broker_preload
+ * @broker: A non-null #EnchantBroker
+ * @tags: The non-null language tags to load dictionaries for
+ * @n_tags: The number of tags in @tags
+ *
+ * Loads the dictionaries enchant_broker_request_dict would return for
+ * @tags on worker threads of the broker, and returns without waiting for
+ * them. Providers that allow it load several dictionaries at once. The
+ * broker keeps the dictionaries until it is freed, so that requesting
+ * them later does not load them again; with a memory budget set by
+ * enchant_broker_set_dict_memory_budget it keeps them as it keeps
+ * dictionaries no longer in use.
+ */
+void enchant_broker_preload (EnchantBroker * broker, const char *const *const tags, size_t n_tags);
+
+/**
+ * enchant_broker_dict_is_ready
+ * @broker: A non-null #EnchantBroker
+ * @tag: The non-null language tag you wish to request a dictionary for ("en_US", "de_DE", ...)
+ *
+ * Returns: 1 if a dictionary for @tag is loaded, 0 if it is being preloaded,
+ * -1 if it was not requested or no suitable dictionary could be found
+ */
+int enchant_broker_dict_is_ready (EnchantBroker * broker, const char *const tag);
+
+/**
+ * enchant_broker_preload_wait
+ * @broker: A non-null #EnchantBroker
+ *
+ * Blocks until the dictionaries passed to enchant_broker_preload are loaded,
+ * or known not to be available.
+ */
+void enchant_broker_preload_wait (EnchantBroker * broker);
+
 /**
  * enchant_broker_request_pwl_dict
  *
@@ -112,13 +191,190 @@ int enchant_broker_dict_exists (EnchantBroker * broker, const char * const tag);
 void enchant_broker_set_ordering (EnchantBroker * broker,
                                   const char * const tag,
 				  const char * const ordering);
+
+/**
+ * enchant_broker_set_pwl_refresh_interval
+ * @broker: A non-null #EnchantBroker
+ * @msecs: The minimum time between two looks, in milliseconds, or 0
+ *
+ * By default a dictionary looks at its personal and exclude word
+ * lists for changes made by other programs each time it checks a word
+ * or makes suggestions, at the cost of a stat() call each time.
+ * A non-zero @msecs makes the dictionaries of @broker, current and
+ * future, look at most once every @msecs instead. Words added or
+ * removed through Enchant itself are always seen immediately.
+ */
+void enchant_broker_set_pwl_refresh_interval (EnchantBroker * broker, int msecs);
+
+/**
+ * enchant_broker_set_dict_sharing
+ * @broker: A non-null #EnchantBroker
+ * @enabled: Whether to share dictionaries with other brokers
+ *
+ * Dictionaries that @broker requests from now on, while @enabled, use
+ * the provider dictionary of the other brokers in the process that
+ * share theirs, so that a language used by several of them is only
+ * loaded once. Sessions and personal and exclude word lists stay with
+ * each broker. Off by default.
+ */
+void enchant_broker_set_dict_sharing (EnchantBroker * broker, int enabled);
+
+/**
+ * enchant_broker_set_dict_memory_budget
+ * @broker: A non-null #EnchantBroker
+ * @n_bytes: The memory the dictionaries may take, in bytes, or 0
+ *
+ * By default a dictionary is unloaded once every request for it has been
+ * freed. A non-zero @n_bytes makes @broker keep such dictionaries loaded
+ * for later requests as long as the dictionaries it has loaded, in use or
+ * not, take less than @n_bytes together; beyond that the ones least
+ * recently used are unloaded first. The memory a dictionary takes is what
+ * its provider estimates; dictionaries of providers that cannot tell
+ * count for 4 MB each. Dictionaries in use are never unloaded; those
+ * enchant_broker_preload loaded count as not in use.
+ */
+void enchant_broker_set_dict_memory_budget (EnchantBroker * broker, size_t n_bytes);
+
+/**
+ * EnchantDictMemoryFn
+ * @lang_tag: The dictionary's language tag (eg: en_US, de_AT, ...)
+ * @n_bytes: The memory the provider estimates the dictionary takes, or 0 if it cannot tell
+ * @in_use: 1 if the dictionary is in use, 0 if the broker only keeps it for later requests
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Callback used to describe the memory an individual dictionary takes
+ */
+typedef void (*EnchantDictMemoryFn) (const char * const lang_tag,
+				     size_t n_bytes,
+				     int in_use,
+				     void * user_data);
+
+/**
+ * enchant_broker_describe_dict_memory
+ * @broker: A non-null #EnchantBroker
+ * @fn: A non-null #EnchantDictMemoryFn
+ * @user_data: Optional user-data
+ *
+ * Enumerates the dictionaries @broker has loaded from its providers,
+ * including those kept for the budget of
+ * enchant_broker_set_dict_memory_budget.
+ */
+void enchant_broker_describe_dict_memory (EnchantBroker * broker,
+					  EnchantDictMemoryFn fn,
+					  void * user_data);
+
+/**
+ * enchant_broker_set_stats_enabled
+ * @broker: A non-null #EnchantBroker
+ * @enabled: Whether to count operations
+ *
+ * Makes the dictionaries of @broker count the words they check, the
+ * suggestions they make, the words added and removed, the calls to their
+ * providers and the times they read and rewrite the personal and exclude
+ * word lists, and time them, for enchant_broker_get_stats and
+ * enchant_dict_get_stats. Counting costs little, even with several threads
+ * using a dictionary. Off by default.
+ */
+void enchant_broker_set_stats_enabled (EnchantBroker * broker, int enabled);
+
+/**
+ * EnchantStatsFn
+ * @provider_name: The provider's name (eg: hunspell), or "Personal Wordlist"
+ * @operation: What was counted: "check", "check_many", "suggest", "add", "remove",
+ *             "provider_check", "provider_suggest", "pwl_refresh", "pwl_rewrite"
+ *             or "request_dict"
+ * @count: The number of operations
+ * @total_usecs: The time they took together, in microseconds
+ * @histogram: How many took less than a microsecond, then how many took at
+ *             least 2^(i-1) and less than 2^i microseconds for each following
+ *             bucket i, with the last bucket counting all that took longer
+ * @n_buckets: The number of buckets in @histogram
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Callback used to report the operations of one kind a provider's dictionaries made
+ */
+typedef void (*EnchantStatsFn) (const char * const provider_name,
+				const char * const operation,
+				size_t count,
+				size_t total_usecs,
+				const size_t * const histogram,
+				size_t n_buckets,
+				void * user_data);
+
+/**
+ * enchant_broker_get_stats
+ * @broker: A non-null #EnchantBroker
+ * @fn: A non-null #EnchantStatsFn
+ * @user_data: Optional user-data
+ *
+ * Reports what the dictionaries of @broker counted, freed ones included,
+ * per provider and operation. Operations never made are not reported.
+ */
+void enchant_broker_get_stats (EnchantBroker * broker,
+			       EnchantStatsFn fn,
+			       void * user_data);
+
+/**
+ * EnchantTraceBeginFn
+ * @provider_name: The provider's name (eg: hunspell)
+ * @lang_tag: The language of the dictionary
+ * @operation: The provider call: "check", "check_many" or "suggest"
+ * @word_len: The length of the word in bytes, or for "check_many" of all the words
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Callback made before a dictionary calls its provider
+ */
+typedef void (*EnchantTraceBeginFn) (const char * const provider_name,
+				     const char * const lang_tag,
+				     const char * const operation,
+				     size_t word_len,
+				     void * user_data);
+
+/**
+ * EnchantTraceEndFn
+ * @provider_name: The provider's name (eg: hunspell)
+ * @lang_tag: The language of the dictionary
+ * @operation: The provider call: "check", "check_many" or "suggest"
+ * @word_len: The length of the word in bytes, or for "check_many" of all the words
+ * @usecs: The time the call took in microseconds, including any wait for
+ *         other threads using the same provider dictionary
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Callback made after a dictionary called its provider
+ */
+typedef void (*EnchantTraceEndFn) (const char * const provider_name,
+				   const char * const lang_tag,
+				   const char * const operation,
+				   size_t word_len,
+				   size_t usecs,
+				   void * user_data);
+
+/**
+ * enchant_broker_set_trace_hooks
+ * @broker: A non-null #EnchantBroker
+ * @begin: The #EnchantTraceBeginFn, or %null
+ * @end: The #EnchantTraceEndFn, or %null
+ * @user_data: Optional user-data
+ *
+ * Makes the dictionaries of @broker call @begin and @end around each
+ * call to their provider, in the thread making it, with no lock held.
+ * Answers from the word lists and caches don't reach the provider and
+ * are not traced. Pass %null for both to stop tracing; calls already
+ * under way may still use the previous hooks.
+ */
+void enchant_broker_set_trace_hooks (EnchantBroker * broker,
+				     EnchantTraceBeginFn begin,
+				     EnchantTraceEndFn end,
+				     void * user_data);
+
 /**
  * enchant_broker_get_error
  * @broker: A non-null broker
  *
  * Returns a const char string or NULL describing the last exception in UTF8 encoding.
  * WARNING: error is transient and is likely cleared as soon as the
- * next broker operation happens
+ * next broker operation happens. Each thread sees only the errors of
+ * the broker operations it made itself.
  */
 const char *enchant_broker_get_error (EnchantBroker * broker);
 
@@ -162,6 +418,26 @@ void enchant_broker_describe (EnchantBroker * broker,
  */
 int enchant_dict_check (EnchantDict * dict, const char *const word, ssize_t len);
 
+/**
+ * enchant_dict_check_many
+ * @dict: A non-null #EnchantDict
+ * @words: An array of @n_words words you wish to check, in UTF-8 encoding
+ * @lens: The byte lengths of @words, or %null; a negative length, or a %null
+ *        @lens, means strlen of the word
+ * @n_words: The number of words in @words
+ * @misspelled: A bitmap of at least (@n_words + 7) / 8 bytes, in which bit
+ *              (i % 8) of byte (i / 8) is set if @words[i] is not correctly spelled
+ *
+ * Checks many words at once, with the same result for each word as
+ * enchant_dict_check but at a lower cost per word. Words that are %null,
+ * empty or not valid UTF-8 are marked as misspelled.
+ *
+ * Returns: the number of misspelled words, or negative if a word could not be checked
+ */
+int enchant_dict_check_many (EnchantDict * dict, const char *const *const words,
+                             const ssize_t *const lens, size_t n_words,
+                             unsigned char *misspelled);
+
 /**
  * enchant_dict_suggest
  * @dict: A non-null #EnchantDict
@@ -177,6 +453,86 @@ int enchant_dict_check (EnchantDict * dict, const char *const word, ssize_t len)
 char **enchant_dict_suggest (EnchantDict * dict, const char *const word,
                              ssize_t len, size_t * out_n_suggs);
 
+/**
+ * EnchantSuggestCallback
+ * @request: The #EnchantSuggestRequest that has completed
+ * @user_data: The user data passed to enchant_dict_suggest_async
+ *
+ * Callback invoked from a worker thread once the suggestions for @request
+ * are available from enchant_suggest_request_get_suggestions. It must not
+ * wait for other requests or free the dictionary they were made on.
+ */
+typedef void (*EnchantSuggestCallback) (EnchantSuggestRequest * request,
+                                        void * user_data);
+
+/**
+ * enchant_dict_suggest_async
+ * @dict: A non-null #EnchantDict
+ * @word: The non-null word you wish to find suggestions for, in UTF-8 encoding
+ * @len: The byte length of @word, or -1 for strlen (@word)
+ * @callback: The function to call once the suggestions are ready, or %null
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Finds the suggestions enchant_dict_suggest would give on a worker thread
+ * of the broker. Requests on one dictionary are handled one at a time and
+ * in order, and other calls on the dictionary wait while one is handled,
+ * so providers are never used from two threads at once. Freeing the
+ * dictionary cancels the requests made on it that have not started yet.
+ *
+ * Returns: A request to be freed with enchant_suggest_request_free, or %null
+ */
+EnchantSuggestRequest *enchant_dict_suggest_async (EnchantDict * dict, const char *const word,
+                                                   ssize_t len, EnchantSuggestCallback callback,
+                                                   void * user_data);
+
+/**
+ * enchant_suggest_request_is_done
+ * @request: A non-null #EnchantSuggestRequest
+ *
+ * Returns: 1 if the suggestions are ready or the request was cancelled, 0 otherwise
+ */
+int enchant_suggest_request_is_done (EnchantSuggestRequest * request);
+
+/**
+ * enchant_suggest_request_wait
+ * @request: A non-null #EnchantSuggestRequest
+ *
+ * Blocks until enchant_suggest_request_is_done returns 1 for @request.
+ * Must not be called from an #EnchantSuggestCallback.
+ */
+void enchant_suggest_request_wait (EnchantSuggestRequest * request);
+
+/**
+ * enchant_suggest_request_get_suggestions
+ * @request: A non-null #EnchantSuggestRequest
+ * @out_n_suggs: The location to store the # of suggestions returned, or %null
+ *
+ * Returns: A %null terminated list of UTF-8 encoded suggestions, or %null if
+ * there are none, the request is not done yet or it was cancelled. The list
+ * belongs to @request and is freed along with it.
+ */
+char **enchant_suggest_request_get_suggestions (EnchantSuggestRequest * request,
+                                                size_t * out_n_suggs);
+
+/**
+ * enchant_suggest_request_cancel
+ * @request: A non-null #EnchantSuggestRequest
+ *
+ * Cancels @request unless it is already done. It is done as soon as this
+ * returns, without suggestions, and its callback will not be called unless
+ * it is already running.
+ */
+void enchant_suggest_request_cancel (EnchantSuggestRequest * request);
+
+/**
+ * enchant_suggest_request_free
+ * @request: A non-null #EnchantSuggestRequest
+ *
+ * Cancels @request if it is not done yet and releases it. Must be called
+ * once for every request, and may be called from its callback.
+ */
+void enchant_suggest_request_free (EnchantSuggestRequest * request);
+
 /**
  * enchant_dict_add
  * @dict: A non-null #EnchantDict
@@ -263,7 +619,8 @@ void enchant_dict_free_string_list (EnchantDict * dict, char **string_list);
  *
  * Returns a const char string or NULL describing the last exception in UTF8 encoding.
  * WARNING: error is transient. It will likely be cleared as soon as
- * the next dictionary operation is called
+ * the next dictionary operation is called. Each thread sees only the
+ * errors of the dictionary operations it made itself.
  *
  * Returns: an error message
  */
@@ -297,6 +654,70 @@ void enchant_dict_describe (EnchantDict * dict,
 			    EnchantDictDescribeFn fn,
 			    void * user_data);
 
+/**
+ * enchant_dict_set_check_cache_size
+ * @dict: A non-null #EnchantDict
+ * @n_words: The number of words to remember, or 0
+ *
+ * Makes @dict remember what enchant_dict_check and
+ * enchant_dict_check_many said about the last @n_words words the
+ * provider had to be asked about, so that checking them again costs
+ * a hash lookup. The cache is emptied whenever words are added or
+ * removed or the word lists change on disk. It is off (0) by default,
+ * and is shared with the dictionaries returned by
+ * enchant_broker_request_dict_for_thread for the same language.
+ */
+void enchant_dict_set_check_cache_size (EnchantDict * dict, size_t n_words);
+
+/**
+ * enchant_dict_get_check_cache_stats
+ * @dict: A non-null #EnchantDict
+ * @hits: Where to store the number of words found in the cache, or %null
+ * @misses: Where to store the number of words not found, or %null
+ *
+ * Counts lookups in the cache of enchant_dict_set_check_cache_size
+ * since its size was last set.
+ */
+void enchant_dict_get_check_cache_stats (EnchantDict * dict, size_t * hits, size_t * misses);
+
+/**
+ * enchant_dict_set_suggest_cache_size
+ * @dict: A non-null #EnchantDict
+ * @n_words: The number of words to remember, or 0
+ *
+ * Makes @dict remember the suggestions enchant_dict_suggest and
+ * enchant_dict_suggest_async made for the last @n_words words, so that
+ * asking again for the same word returns a copy of the same list. Like
+ * the cache of enchant_dict_set_check_cache_size, it is emptied whenever
+ * the word lists change, is off (0) by default and is shared with the
+ * dictionaries of enchant_broker_request_dict_for_thread.
+ */
+void enchant_dict_set_suggest_cache_size (EnchantDict * dict, size_t n_words);
+
+/**
+ * enchant_dict_get_suggest_cache_stats
+ * @dict: A non-null #EnchantDict
+ * @hits: Where to store the number of words found in the cache, or %null
+ * @misses: Where to store the number of words not found, or %null
+ *
+ * Counts lookups in the cache of enchant_dict_set_suggest_cache_size
+ * since its size was last set.
+ */
+void enchant_dict_get_suggest_cache_stats (EnchantDict * dict, size_t * hits, size_t * misses);
+
+/**
+ * enchant_dict_get_stats
+ * @dict: A non-null #EnchantDict
+ * @fn: A non-null #EnchantStatsFn
+ * @user_data: Optional user-data
+ *
+ * Reports what @dict counted since its broker enabled
+ * enchant_broker_set_stats_enabled, per operation. The dictionaries
+ * returned by enchant_broker_request_dict_for_thread for the same
+ * language count together.
+ */
+void enchant_dict_get_stats (EnchantDict * dict, EnchantStatsFn fn, void * user_data);
+
 /**
  * enchant_broker_list_dicts
  * @broker: A non-null #EnchantBroker
@@ -46,25 +46,102 @@
 #include "enchant.h"
 #include "enchant-provider.h"
 #include "pwl.h"
+#include "cache.h"
+#include "wordset.h"
+#include "stats.h"
 #include "unused-parameter.h"
 #include "relocatable.h"
 #include "configmake.h"
 
 /********************************************************************************/
 
+/* Errors are kept per thread, so that threads sharing a broker or a
+ * dictionary never see or clear each other's errors. Each broker and session
+ * has a table from thread to its last error there, freed along with it. */
+typedef struct str_enchant_errors
+{
+	GMutex lock;			/* protects by_thread */
+	GHashTable * by_thread;		/* thread id -> last error, NULL until the first */
+	gint n_errors;			/* entries in by_thread, read atomically */
+} EnchantErrors;
+
 struct str_enchant_broker
 {
-	GSList *provider_list;	/* list of all of the spelling backend providers */
+	GSList *provider_modules;	/* EnchantProviderModules of all of the spelling backend providers */
 	GHashTable *dict_map;		/* map of language tag -> dictionary */
+	GHashTable *thread_dict_map;	/* map of language tag and thread -> per-thread dictionary */
 	GHashTable *provider_ordering; /* map of language tag -> provider order */
-
-	gchar * error;
+	int pwl_refresh_interval;	/* msecs between looking for changes to the PWL files */
+	gboolean share_dicts;		/* whether to use provider dicts shared with other brokers */
+	size_t dict_memory_budget;	/* bytes of provider dicts to keep loaded, 0 to free them when unused */
+	GQueue unused_dicts;		/* provider dicts kept for the budget, most recently used first */
+	gint collect_stats;		/* whether dicts count their operations, read atomically */
+	GHashTable *provider_stats;	/* map of provider name -> EnchantStats of its requests and freed dicts */
+	struct str_enchant_trace_hooks *trace_hooks;	/* read atomically, NULL if not tracing */
+	GSList *old_trace_hooks;	/* replaced hooks, kept for the calls that may still use them */
+	GThreadPool *suggest_pool;	/* workers for enchant_dict_suggest_async, created on first use */
+	GThreadPool *preload_pool;	/* workers for enchant_broker_preload, created on first use */
+	GHashTable *preloads;		/* map of normalized language tag -> EnchantPreload */
+	GCond preload_cond;		/* signalled with the broker locked as preloads finish */
+
+	GKeyFile *manifest;		/* for lazy brokers, what is known of the modules without loading them */
+	char *manifest_file;
+
+	GMutex lock;			/* protects the dict maps, provider_ordering, pwl_refresh_interval,
+					 * the loading of provider modules and the manifest */
+	EnchantErrors errors;
 };
 
+/* The hooks given to enchant_broker_set_trace_hooks. They are replaced
+ * rather than changed, as dicts read them without locking. */
+typedef struct str_enchant_trace_hooks
+{
+	EnchantTraceBeginFn begin;
+	EnchantTraceEndFn end;
+	void *user_data;
+} EnchantTraceHooks;
+
+/* A dictionary enchant_broker_preload was asked for. The broker keeps the
+ * dict until it is freed, so that requesting it does not load it again,
+ * unless a memory budget lets it unload the dict with the unused ones. */
+typedef struct str_enchant_preload
+{
+	char *tag;
+	EnchantDict *dict;		/* the broker's reference, NULL if none was found or it was released */
+	char *dict_tag;			/* the tag the dict is kept under once released */
+	gboolean done;
+} EnchantPreload;
+
+/* What the broker keeps in a provider's enchant_private_data */
+typedef struct str_enchant_provider_private_data
+{
+	GModule *module;
+	GMutex lock;			/* held across calls into a provider without concurrent_request_dict */
+} EnchantProviderPrivateData;
+
+/* A module in the provider directory. Lazy brokers take its identifier,
+ * description and dictionaries from the manifest and only load it once a
+ * request gets to it. */
+typedef struct str_enchant_provider_module
+{
+	char *filename;
+	char *dir_name;
+	char *dir_entry;
+	gint64 mtime;
+	gint64 size;
+
+	char *identifier;
+	char *description;
+	char **tags;			/* the dictionaries the provider listed, NULL if unknown */
+
+	EnchantProvider *provider;	/* NULL until loaded */
+	gboolean failed;		/* whether the module failed to load */
+} EnchantProviderModule;
+
 typedef struct str_enchant_session
 {
-	GHashTable *session_include;
-	GHashTable *session_exclude;
+	EnchantWordSet *session_include;
+	EnchantWordSet *session_exclude;
 	EnchantPWL *personal;
 	EnchantPWL *exclude;
 
@@ -72,19 +149,167 @@ typedef struct str_enchant_session
 	char * exclude_filename;
 	char * language_tag;
 
-	char * error;
+	EnchantErrors errors;
 
 	gboolean is_pwl;
 
 	EnchantProvider * provider;
+
+	GRWLock lock;		/* readers look words up, writers change the word lists */
+	GMutex refresh_lock;	/* held while looking for changes to the PWL files */
+
+	EnchantCache * check_cache;	/* word -> result of enchant_dict_check, as a pointer */
+	EnchantCache * suggest_cache;	/* word -> result of enchant_dict_suggest */
+
+	EnchantStats * stats;		/* created the first time the broker collects stats */
 } EnchantSession;
 
 typedef struct str_enchant_dict_private_data
 {
 	unsigned int reference_count;
 	EnchantSession* session;
+	EnchantBroker* broker;
+
+	GMutex provider_lock;		/* held while the provider dict is in use */
+	GMutex * provider_mutex;	/* provider_lock, or that of the provider dict shared with other brokers */
+	struct str_enchant_shared_dict * shared_provider_dict;	/* the provider dict shared with other brokers */
+	EnchantDict * shared_dict;	/* for per-thread dicts, the dict whose session they share */
+	char * thread_key;		/* for per-thread dicts, the key in thread_dict_map */
+	GQueue suggest_queue;		/* EnchantSuggestRequests not yet started */
+	gboolean suggest_scheduled;	/* whether a worker is serving suggest_queue */
+	size_t memory_usage;		/* what the provider estimated the dict takes, 0 if unknown */
 } EnchantDictPrivateData;
 
+struct str_enchant_suggest_request
+{
+	EnchantDict * dict;
+	char * word;
+	size_t len;
+	EnchantSuggestCallback callback;
+	void * user_data;
+
+	char ** suggs;
+	size_t n_suggs;
+	gboolean done;
+	gboolean cancelled;
+
+	gint ref_count;		/* held by the caller and while queued or running */
+};
+
+/* Protects the suggestion queues and the state of the requests in them */
+static GMutex enchant_suggest_mutex;
+static GCond enchant_suggest_cond;
+
+#define enchant_dict_lock_provider(dict) \
+	g_mutex_lock (((EnchantDictPrivateData*)(dict)->enchant_private_data)->provider_mutex)
+#define enchant_dict_unlock_provider(dict) \
+	g_mutex_unlock (((EnchantDictPrivateData*)(dict)->enchant_private_data)->provider_mutex)
+
+/* A provider dict shared by the brokers that enabled dict sharing. Each of
+ * them gets a copy of the EnchantDict, which providers keep their state out
+ * of, with a session of its own. */
+typedef struct str_enchant_shared_dict
+{
+	char * key;			/* the file name of the provider module and the tag */
+	EnchantProvider * provider;
+	EnchantDict * dict;		/* the dict as the provider returned it */
+	guint ref_count;		/* copies of dict in use */
+	GMutex provider_lock;		/* held while the provider dict is in use */
+} EnchantSharedDict;
+
+/* Protects the following */
+static GMutex enchant_shared_dicts_mutex;
+/* key -> EnchantSharedDict */
+static GHashTable * enchant_shared_dicts;
+/* EnchantProvider -> number of EnchantSharedDicts it made. A provider whose
+ * broker is freed while some remain is kept without an owner until the last
+ * one is freed. */
+static GHashTable * enchant_shared_dict_providers;
+
+/* Each thread gets an id the first time it needs one; unlike the
+ * addresses of threads these ids are never reused. */
+static GPrivate enchant_thread_id;
+static gint enchant_last_thread_id;
+
+static guint
+enchant_get_thread_id (void)
+{
+	guint id = GPOINTER_TO_UINT (g_private_get (&enchant_thread_id));
+
+	if (id == 0)
+		{
+			id = (guint) g_atomic_int_add (&enchant_last_thread_id, 1) + 1;
+			g_private_set (&enchant_thread_id, GUINT_TO_POINTER (id));
+		}
+
+	return id;
+}
+
+static void
+enchant_errors_init (EnchantErrors * errors)
+{
+	g_mutex_init (&errors->lock);
+	errors->by_thread = NULL;
+	errors->n_errors = 0;
+}
+
+/* Frees the errors of every thread, with the object they belong to */
+static void
+enchant_errors_clear (EnchantErrors * errors)
+{
+	if (errors->by_thread)
+		g_hash_table_destroy (errors->by_thread);
+	g_mutex_clear (&errors->lock);
+}
+
+/* The error of the calling thread stays valid until that thread sets or
+ * clears it, as no other thread touches its entry */
+static const char *
+enchant_errors_get (EnchantErrors * errors)
+{
+	const char * err = NULL;
+
+	if (g_atomic_int_get (&errors->n_errors) == 0)
+		return NULL;
+
+	g_mutex_lock (&errors->lock);
+	if (errors->by_thread)
+		err = (const char *) g_hash_table_lookup (errors->by_thread,
+							  GUINT_TO_POINTER (enchant_get_thread_id ()));
+	g_mutex_unlock (&errors->lock);
+
+	return err;
+}
+
+/* takes ownership of @err */
+static void
+enchant_errors_set (EnchantErrors * errors, char * err)
+{
+	g_mutex_lock (&errors->lock);
+	if (!errors->by_thread)
+		errors->by_thread = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+	g_hash_table_insert (errors->by_thread, GUINT_TO_POINTER (enchant_get_thread_id ()), err);
+	g_atomic_int_set (&errors->n_errors, g_hash_table_size (errors->by_thread));
+	g_mutex_unlock (&errors->lock);
+}
+
+/* Called at the start of most operations, so it takes no lock while no
+ * thread has an error set */
+static void
+enchant_errors_unset (EnchantErrors * errors)
+{
+	if (g_atomic_int_get (&errors->n_errors) == 0)
+		return;
+
+	g_mutex_lock (&errors->lock);
+	if (errors->by_thread)
+		{
+			g_hash_table_remove (errors->by_thread, GUINT_TO_POINTER (enchant_get_thread_id ()));
+			g_atomic_int_set (&errors->n_errors, g_hash_table_size (errors->by_thread));
+		}
+	g_mutex_unlock (&errors->lock);
+}
+
 typedef EnchantProvider *(*EnchantProviderInitFunc) (void);
 typedef void             (*EnchantPreConfigureFunc) (EnchantProvider * provider, const char * module_dir);
 
@@ -237,19 +462,30 @@ enchant_iso_639_from_tag (const char * const dict_tag)
 	return new_tag;
 }
 
+static gpointer
+enchant_string_list_copy (gconstpointer string_list, gpointer data _GL_UNUSED_PARAMETER)
+{
+	return g_strdupv ((gchar **) string_list);
+}
+
 static void
 enchant_session_destroy (EnchantSession * session)
 {
-	g_hash_table_destroy (session->session_include);
-	g_hash_table_destroy (session->session_exclude);
+	enchant_word_set_free (session->session_include);
+	enchant_word_set_free (session->session_exclude);
 	enchant_pwl_free (session->personal);
 	enchant_pwl_free (session->exclude);
 	g_free (session->personal_filename);
 	g_free (session->exclude_filename);
 	free (session->language_tag);
 
-	if (session->error)
-		g_free (session->error);
+	enchant_errors_clear (&session->errors);
+	g_rw_lock_clear (&session->lock);
+	g_mutex_clear (&session->refresh_lock);
+	enchant_cache_free (session->check_cache);
+	enchant_cache_free (session->suggest_cache);
+	if (session->stats)
+		enchant_stats_free (session->stats);
 
 	g_free (session);
 }
@@ -281,14 +517,19 @@ enchant_session_new_with_pwl (EnchantProvider * provider,
 		exclude = enchant_pwl_init ();
 
 	session = g_new0 (EnchantSession, 1);
-	session->session_include = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-	session->session_exclude = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	session->session_include = enchant_word_set_new ();
+	session->session_exclude = enchant_word_set_new ();
 	session->personal = personal;
 	session->exclude = exclude;
 	session->provider = provider;
 	session->language_tag = strdup (lang);
 	session->personal_filename = g_strdup (pwl); /* Need g_strdup because may be NULL */
 	session->exclude_filename = g_strdup (excl); /* Need g_strdup because may be NULL */
+	enchant_errors_init (&session->errors);
+	g_rw_lock_init (&session->lock);
+	g_mutex_init (&session->refresh_lock);
+	session->check_cache = enchant_cache_new (NULL, NULL);
+	session->suggest_cache = enchant_cache_new (enchant_string_list_copy, (GDestroyNotify) g_strfreev);
 
 	return session;
 }
@@ -338,20 +579,74 @@ enchant_session_new (EnchantProvider *provider, const char * const lang)
 	return session;
 }
 
+/* Changes to the word lists are made with refresh_lock held too, so that
+ * enchant_session_refresh sees them either not started or complete */
+static void
+enchant_session_write_lock (EnchantSession * session)
+{
+	g_mutex_lock (&session->refresh_lock);
+	g_rw_lock_writer_lock (&session->lock);
+}
+
+/* Any change to the word lists may change what enchant_dict_check and
+ * enchant_dict_suggest say */
+static void
+enchant_session_write_unlock (EnchantSession * session)
+{
+	enchant_cache_invalidate (session->check_cache);
+	enchant_cache_invalidate (session->suggest_cache);
+	g_rw_lock_writer_unlock (&session->lock);
+	g_mutex_unlock (&session->refresh_lock);
+}
+
+/* Reads the changes others made to the PWL files, if it is time to look for
+ * them. Readers are only held off while a changed file is read again, and
+ * when another thread is already looking there is no need to look as well. */
+static void
+enchant_session_refresh (EnchantSession * session)
+{
+	gboolean personal_due, exclude_due;
+
+	if (!g_mutex_trylock (&session->refresh_lock))
+		return;
+
+	personal_due = enchant_pwl_refresh_is_due (session->personal);
+	exclude_due = enchant_pwl_refresh_is_due (session->exclude);
+
+	if (personal_due || exclude_due)
+		{
+			g_rw_lock_writer_lock (&session->lock);
+			if (personal_due)
+				enchant_pwl_refresh (session->personal);
+			if (exclude_due)
+				enchant_pwl_refresh (session->exclude);
+			enchant_cache_invalidate (session->check_cache);
+			enchant_cache_invalidate (session->suggest_cache);
+			g_rw_lock_writer_unlock (&session->lock);
+		}
+
+	g_mutex_unlock (&session->refresh_lock);
+}
+
+static void
+enchant_session_set_refresh_interval (EnchantSession * session, int msecs)
+{
+	enchant_pwl_set_refresh_interval (session->personal, msecs);
+	enchant_pwl_set_refresh_interval (session->exclude, msecs);
+}
+
 static void
 enchant_session_add (EnchantSession * session, const char * const word, size_t len)
 {
-	char* key = g_strndup (word, len);
-	g_hash_table_remove (session->session_exclude, key);
-	g_hash_table_insert (session->session_include, key, GINT_TO_POINTER(TRUE));
+	enchant_word_set_remove (session->session_exclude, word, len);
+	enchant_word_set_add (session->session_include, word, len);
 }
 
 static void
 enchant_session_remove (EnchantSession * session, const char * const word, size_t len)
 {
-	char* key = g_strndup (word, len);
-	g_hash_table_remove (session->session_include, key);
-	g_hash_table_insert (session->session_exclude, key, GINT_TO_POINTER(TRUE));
+	enchant_word_set_remove (session->session_include, word, len);
+	enchant_word_set_add (session->session_exclude, word, len);
 }
 
 static void
@@ -380,48 +675,119 @@ enchant_session_remove_exclude (EnchantSession * session, const char * const wor
 
 /* a word is excluded if it is in the exclude dictionary or in the session exclude list
  *  AND the word has not been added to the session include list
+ *
+ * These two must be called with the session locked for reading
  */
 static gboolean
 enchant_session_exclude (EnchantSession * session, const char * const word, size_t len)
 {
-	gboolean result = FALSE;
+	return !enchant_word_set_contains (session->session_include, word, len) &&
+		(enchant_word_set_contains (session->session_exclude, word, len) ||
+		 enchant_pwl_check_loaded (session->exclude, word, len) == 0);
+}
 
-	char * utf = g_strndup (word, len);
+static gboolean
+enchant_session_contains (EnchantSession * session, const char * const word, size_t len)
+{
+	return enchant_word_set_contains (session->session_include, word, len) ||
+		(enchant_pwl_check_loaded (session->personal, word, len) == 0 &&
+		 enchant_pwl_check_loaded (session->exclude, word, len) != 0);
+}
 
-	if (!g_hash_table_lookup (session->session_include, utf) &&
-			(g_hash_table_lookup (session->session_exclude, utf)||
-			 enchant_pwl_check (session->exclude, word, len) == 0 ))
-			result = TRUE;
-	g_free (utf);
+static void
+enchant_session_clear_error (EnchantSession * session)
+{
+	enchant_errors_unset (&session->errors);
+}
 
-	return result;
+/* The name the stats of @session are reported under */
+static const char *
+enchant_session_get_provider_name (EnchantSession * session)
+{
+	if (session->provider)
+		return (*session->provider->identify) (session->provider);
+
+	return "Personal Wordlist";
 }
 
-static gboolean
-enchant_session_contains (EnchantSession * session, const char * const word, size_t len)
+/* The stats of the session of @dict if its broker collects them, else NULL.
+ * They are created on first use, as they are not small. */
+static EnchantStats *
+enchant_dict_get_collected_stats (EnchantDict * dict)
 {
-	gboolean result = FALSE;
+	EnchantDictPrivateData * dict_private_data = (EnchantDictPrivateData*)dict->enchant_private_data;
+	EnchantSession * session;
+	EnchantStats * stats;
+
+	if (!g_atomic_int_get (&dict_private_data->broker->collect_stats))
+		return NULL;
 
-	char * utf = g_strndup (word, len);
+	session = dict_private_data->session;
+	stats = (EnchantStats *) g_atomic_pointer_get (&session->stats);
+	if (stats == NULL)
+		{
+			stats = enchant_stats_new ();
+			if (g_atomic_pointer_compare_and_exchange (&session->stats, NULL, stats))
+				{
+					enchant_pwl_set_stats (session->personal, stats);
+					enchant_pwl_set_stats (session->exclude, stats);
+				}
+			else
+				{
+					enchant_stats_free (stats);
+					stats = (EnchantStats *) g_atomic_pointer_get (&session->stats);
+				}
+		}
 
-	if (g_hash_table_lookup (session->session_include, utf) ||
-		(enchant_pwl_check (session->personal, word, len) == 0 &&
-		 (!enchant_pwl_check (session->exclude, word, len)) == 0))
-		result = TRUE;
+	return stats;
+}
 
-	g_free (utf);
+/* The monotonic time, if @stats is to count the operation starting now */
+#define enchant_stats_start(stats) ((stats) ? g_get_monotonic_time () : 0)
 
-	return result;
+/* The trace hooks of the broker of @dict, or NULL if it does not trace */
+static EnchantTraceHooks *
+enchant_dict_get_trace_hooks (EnchantDict * dict)
+{
+	EnchantDictPrivateData * dict_private_data = (EnchantDictPrivateData*)dict->enchant_private_data;
+
+	return (EnchantTraceHooks *) g_atomic_pointer_get (&dict_private_data->broker->trace_hooks);
+}
+
+/* Calls the begin hook, if any, before @dict calls its provider, and
+ * returns the time the call starts */
+static gint64
+enchant_dict_trace_begin (EnchantDict * dict, EnchantTraceHooks * hooks,
+			  const char * operation, size_t word_len)
+{
+	EnchantSession * session;
+
+	if (hooks == NULL)
+		return 0;
+
+	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	if (hooks->begin)
+		(*hooks->begin) (enchant_session_get_provider_name (session), session->language_tag,
+				 operation, word_len, hooks->user_data);
+
+	return g_get_monotonic_time ();
 }
 
+/* Calls the end hook, if any, after @dict called its provider */
 static void
-enchant_session_clear_error (EnchantSession * session)
+enchant_dict_trace_end (EnchantDict * dict, EnchantTraceHooks * hooks,
+			const char * operation, size_t word_len, gint64 start)
 {
-	if (session->error)
-		{
-			g_free (session->error);
-			session->error = NULL;
-		}
+	EnchantSession * session;
+	gint64 usecs;
+
+	if (hooks == NULL || hooks->end == NULL)
+		return;
+
+	usecs = g_get_monotonic_time () - start;
+	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	(*hooks->end) (enchant_session_get_provider_name (session), session->language_tag,
+		       operation, word_len, (size_t) MAX (usecs, 0), hooks->user_data);
 }
 
 /********************************************************************************/
@@ -444,8 +810,7 @@ enchant_dict_set_error (EnchantDict * dict, const char * const err)
 
 	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
 
-	enchant_session_clear_error (session);
-	session->error = strdup (err);
+	enchant_errors_set (&session->errors, g_strdup (err));
 }
 
 const char *
@@ -456,13 +821,18 @@ enchant_dict_get_error (EnchantDict * dict)
 	g_return_val_if_fail (dict, NULL);
 
 	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
-	return session->error;
+	return enchant_errors_get (&session->errors);
 }
 
 int
 enchant_dict_check (EnchantDict * dict, const char *const word, ssize_t len)
 {
 	EnchantSession * session;
+	EnchantStats * stats;
+	gint64 start;
+	gpointer cached;
+	guint generation;
+	int result;
 
 	g_return_val_if_fail (dict, -1);
 	g_return_val_if_fail (word, -1);
@@ -473,100 +843,290 @@ enchant_dict_check (EnchantDict * dict, const char *const word, ssize_t len)
 	g_return_val_if_fail (len, -1);
 	g_return_val_if_fail (g_utf8_validate(word, len, NULL),-1);
 
+	stats = enchant_dict_get_collected_stats (dict);
+	start = enchant_stats_start (stats);
+
 	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
 	enchant_session_clear_error (session);
+	enchant_session_refresh (session);
 
+	g_rw_lock_reader_lock (&session->lock);
+	generation = enchant_cache_get_generation (session->check_cache);
+	if (enchant_cache_lookup (session->check_cache, word, len, &cached))
+		result = GPOINTER_TO_INT (cached);
 	/* first, see if it's to be excluded*/
-	if (enchant_session_exclude (session, word, len))
-		return 1;
-
+	else if (enchant_session_exclude (session, word, len))
+		result = 1;
 	/* then, see if it's in our pwl or session*/
-	if (enchant_session_contains(session, word, len))
+	else if (enchant_session_contains(session, word, len))
+		result = 0;
+	else
+		result = -1;
+	g_rw_lock_reader_unlock (&session->lock);
+
+	if (result < 0)
+		{
+			if (dict->check)
+				{
+					EnchantTraceHooks * hooks = enchant_dict_get_trace_hooks (dict);
+					gint64 trace_start = enchant_dict_trace_begin (dict, hooks, "check", len);
+					gint64 provider_start = enchant_stats_start (stats);
+
+					enchant_dict_lock_provider (dict);
+					result = (*dict->check) (dict, word, len);
+					enchant_dict_unlock_provider (dict);
+					enchant_stats_record (stats, ENCHANT_STATS_PROVIDER_CHECK, provider_start);
+					enchant_dict_trace_end (dict, hooks, "check", len, trace_start);
+				}
+			else if (session->is_pwl)
+				result = 1;
+
+			/* only the answers that took the provider are worth keeping */
+			if (result >= 0)
+				enchant_cache_insert (session->check_cache, word, len, GINT_TO_POINTER (result), generation);
+		}
+
+	enchant_stats_record (stats, ENCHANT_STATS_CHECK, start);
+
+	return result;
+}
+
+#define enchant_mark_misspelled(bitmap, i) ((bitmap)[(i) / 8] |= 1 << ((i) % 8))
+
+int
+enchant_dict_check_many (EnchantDict * dict, const char *const *const words,
+			 const ssize_t *const lens, size_t n_words,
+			 unsigned char *misspelled)
+{
+	EnchantSession * session;
+	EnchantStats * stats;
+	gint64 start;
+	const char ** pending_words;
+	size_t * pending_lens;
+	size_t * pending_index;
+	int * pending_results;
+	size_t i, n_pending = 0;
+	int n_misspelled = 0, result = 0;
+	guint generation;
+
+	g_return_val_if_fail (dict, -1);
+	g_return_val_if_fail (words || !n_words, -1);
+	g_return_val_if_fail (misspelled || !n_words, -1);
+
+	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	if (!n_words)
 		return 0;
 
-	if (dict->check)
-		return (*dict->check) (dict, word, len);
-	else if (session->is_pwl)
-		return 1;
+	stats = enchant_dict_get_collected_stats (dict);
+	start = enchant_stats_start (stats);
+
+	memset (misspelled, 0, (n_words + 7) / 8);
+
+	/* look for changes to the word lists once for the whole batch */
+	enchant_session_refresh (session);
+	g_rw_lock_reader_lock (&session->lock);
+	generation = enchant_cache_get_generation (session->check_cache);
+
+	pending_words = g_new (const char *, n_words);
+	pending_lens = g_new (size_t, n_words);
+	pending_index = g_new (size_t, n_words);
+
+	for (i = 0; i < n_words; i++)
+		{
+			const char * word = words[i];
+			size_t len = 0;
+			gpointer cached;
+			gboolean correct = FALSE, excluded = FALSE;
+
+			if (word)
+				len = (lens && lens[i] >= 0) ? (size_t)lens[i] : strlen (word);
+			if (!word || !len || !g_utf8_validate (word, len, NULL))
+				{
+					enchant_mark_misspelled (misspelled, i);
+					n_misspelled++;
+					continue;
+				}
+
+			if (enchant_cache_lookup (session->check_cache, word, len, &cached))
+				{
+					if (GPOINTER_TO_INT (cached) != 0)
+						{
+							enchant_mark_misspelled (misspelled, i);
+							n_misspelled++;
+						}
+					continue;
+				}
+
+			/* same order as enchant_dict_check: session additions win over
+			 * exclusions, which win over the personal word list */
+			if (enchant_word_set_contains (session->session_include, word, len))
+				correct = TRUE;
+			else if (enchant_word_set_contains (session->session_exclude, word, len) ||
+				 enchant_pwl_check_loaded (session->exclude, word, len) == 0)
+				excluded = TRUE;
+			else if (enchant_pwl_check_loaded (session->personal, word, len) == 0)
+				correct = TRUE;
+
+			if (excluded)
+				{
+					enchant_mark_misspelled (misspelled, i);
+					n_misspelled++;
+				}
+			else if (!correct)
+				{
+					pending_words[n_pending] = word;
+					pending_lens[n_pending] = len;
+					pending_index[n_pending] = i;
+					n_pending++;
+				}
+		}
+
+	g_rw_lock_reader_unlock (&session->lock);
+
+	if (n_pending)
+		{
+			EnchantTraceHooks * hooks = NULL;
+			gint64 provider_start = enchant_stats_start (stats), trace_start = 0;
+			size_t pending_len = 0;
+
+			pending_results = g_new (int, n_pending);
+
+			if (dict->check_many || dict->check)
+				{
+					hooks = enchant_dict_get_trace_hooks (dict);
+					if (hooks)
+						for (i = 0; i < n_pending; i++)
+							pending_len += pending_lens[i];
+					trace_start = enchant_dict_trace_begin (dict, hooks, "check_many", pending_len);
+				}
+
+			if (dict->check_many)
+				{
+					enchant_dict_lock_provider (dict);
+					(*dict->check_many) (dict, pending_words, pending_lens, n_pending, pending_results);
+					enchant_dict_unlock_provider (dict);
+					enchant_stats_record (stats, ENCHANT_STATS_PROVIDER_CHECK, provider_start);
+				}
+			else if (dict->check)
+				{
+					enchant_dict_lock_provider (dict);
+					for (i = 0; i < n_pending; i++)
+						pending_results[i] = (*dict->check) (dict, pending_words[i], pending_lens[i]);
+					enchant_dict_unlock_provider (dict);
+					enchant_stats_record (stats, ENCHANT_STATS_PROVIDER_CHECK, provider_start);
+				}
+			else
+				{
+					for (i = 0; i < n_pending; i++)
+						pending_results[i] = session->is_pwl ? 1 : -1;
+				}
+
+			enchant_dict_trace_end (dict, hooks, "check_many", pending_len, trace_start);
 
-	return -1;
+			for (i = 0; i < n_pending; i++)
+				{
+					if (pending_results[i] < 0)
+						result = -1;
+					else
+						enchant_cache_insert (session->check_cache, pending_words[i], pending_lens[i],
+								      GINT_TO_POINTER (pending_results[i]), generation);
+					if (pending_results[i] != 0)
+						{
+							enchant_mark_misspelled (misspelled, pending_index[i]);
+							n_misspelled++;
+						}
+				}
+
+			g_free (pending_results);
+		}
+
+	g_free (pending_words);
+	g_free (pending_lens);
+	g_free (pending_index);
+
+	enchant_stats_record (stats, ENCHANT_STATS_CHECK_MANY, start);
+
+	return result < 0 ? result : n_misspelled;
 }
 
-/* @suggs must have at least n_suggs + n_new_suggs space allocated
+/* Moves the items of @new_suggs that are not already in @suggs to the end of
+ * @suggs and frees the others, leaving @new_suggs empty.
+ * @suggs must have at least n_suggs + n_new_suggs space allocated
  * @n_suggs is the number if items currently appearing in @suggs
+ * @seen holds the NFD forms of the items in @suggs, and takes the new ones
  *
  * returns the number of items in @suggs after merge is complete
  */
-static int
-enchant_dict_merge_suggestions(char ** suggs, size_t n_suggs, char ** new_suggs, size_t n_new_suggs)
+static size_t
+enchant_dict_merge_suggestions(char ** suggs, size_t n_suggs, GHashTable * seen,
+			       char ** new_suggs, size_t n_new_suggs)
 {
-	size_t i, j;
+	size_t i;
 
 	for(i = 0; i < n_new_suggs; i++)
 		{
-			int is_duplicate = 0;
 			char * normalized_new_sugg;
 
 			normalized_new_sugg = g_utf8_normalize (new_suggs[i], -1, G_NORMALIZE_NFD);
 
-			for(j = 0; j < n_suggs; j++)
+			if(g_hash_table_contains (seen, normalized_new_sugg))
 				{
-					char* normalized_sugg;
-					normalized_sugg = g_utf8_normalize (suggs[j], -1, G_NORMALIZE_NFD);
-
-					if(strcmp(normalized_sugg,normalized_new_sugg)==0)
-						{
-							is_duplicate = 1;
-							g_free(normalized_sugg);
-							break;
-						}
-					g_free(normalized_sugg);
+					g_free (normalized_new_sugg);
+					g_free (new_suggs[i]);
 				}
-			g_free(normalized_new_sugg);
-
-			if(!is_duplicate)
+			else
 				{
-					suggs[n_suggs] = strdup (new_suggs[i]);
+					g_hash_table_add (seen, normalized_new_sugg);
+					suggs[n_suggs] = new_suggs[i];
 					++n_suggs;
 				}
+			new_suggs[i] = NULL;
 		}
 
 	return n_suggs;
 }
 
-static char **
-enchant_dict_get_good_suggestions(EnchantDict * dict,
-								char ** suggs,
-								size_t n_suggs,
-								size_t* out_n_filtered_suggs)
+/* Frees the empty, invalid and excluded items of @suggs and moves the others
+ * to its front; @suggs stays NULL-terminated.
+ *
+ * returns the number of items kept
+ */
+static size_t
+enchant_dict_keep_good_suggestions(EnchantDict * dict,
+				   char ** suggs,
+				   size_t n_suggs)
 {
 	EnchantSession * session;
 	size_t i, n_filtered_suggs;
-	char ** filtered_suggs;
 
 	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
 
-	filtered_suggs = g_new0 (char *, n_suggs + 1);
 	n_filtered_suggs = 0;
 
 	for(i = 0; i < n_suggs; i++)
 		{
 			size_t sugg_len = strlen(suggs[i]);
 
-			if (sugg_len == 0) continue;
-
-			if(g_utf8_validate(suggs[i], sugg_len, NULL) &&
+			if(sugg_len != 0 &&
+			   g_utf8_validate(suggs[i], sugg_len, NULL) &&
 			   !enchant_session_exclude(session, suggs[i], sugg_len) )
 				{
-					filtered_suggs[n_filtered_suggs] = strdup (suggs[i]);
+					suggs[n_filtered_suggs] = suggs[i];
 					++n_filtered_suggs;
 				}
+			else
+				g_free (suggs[i]);
 		}
 
-	if(out_n_filtered_suggs)
-		*out_n_filtered_suggs = n_filtered_suggs;
+	/* in case the list held more than its count said */
+	for(; suggs[i]; i++)
+		g_free (suggs[i]);
 
-	return filtered_suggs;
+	suggs[n_filtered_suggs] = NULL;
+
+	return n_filtered_suggs;
 }
 
 char **
@@ -574,8 +1134,12 @@ enchant_dict_suggest (EnchantDict * dict, const char *const word,
 			  ssize_t len, size_t * out_n_suggs)
 {
 	EnchantSession * session;
-	size_t n_suggs = 0, n_dict_suggs = 0, n_pwl_suggs = 0, n_suggsT = 0;
-	char **suggs, **dict_suggs = NULL, **pwl_suggs = NULL, **suggsT;
+	EnchantStats * stats;
+	gint64 start;
+	size_t n_suggs = 0, n_dict_suggs = 0, n_pwl_suggs = 0;
+	char **suggs, **dict_suggs = NULL, **pwl_suggs = NULL;
+	gpointer cached;
+	guint generation;
 
 	g_return_val_if_fail (dict, NULL);
 	g_return_val_if_fail (word, NULL);
@@ -586,89 +1150,303 @@ enchant_dict_suggest (EnchantDict * dict, const char *const word,
 	g_return_val_if_fail (len, NULL);
 	g_return_val_if_fail (g_utf8_validate(word, len, NULL), NULL);
 
+	stats = enchant_dict_get_collected_stats (dict);
+	start = enchant_stats_start (stats);
+
 	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
 	enchant_session_clear_error (session);
+	enchant_session_refresh (session);
+
+	generation = enchant_cache_get_generation (session->suggest_cache);
+	if (enchant_cache_lookup (session->suggest_cache, word, len, &cached))
+		{
+			suggs = (char **) cached;
+			if (out_n_suggs)
+				*out_n_suggs = suggs ? g_strv_length (suggs) : 0;
+			enchant_stats_record (stats, ENCHANT_STATS_SUGGEST, start);
+			return suggs;
+		}
+
 	/* Check for suggestions from provider dictionary */
 	if (dict->suggest)
 		{
+			EnchantTraceHooks * hooks = enchant_dict_get_trace_hooks (dict);
+			gint64 trace_start = enchant_dict_trace_begin (dict, hooks, "suggest", len);
+			gint64 provider_start = enchant_stats_start (stats);
+
+			enchant_dict_lock_provider (dict);
 			dict_suggs = (*dict->suggest) (dict, word, len,
 							&n_dict_suggs);
-			if(dict_suggs)
-				{
-					suggsT = enchant_dict_get_good_suggestions(dict, dict_suggs, n_dict_suggs, &n_suggsT);
-					enchant_free_string_list (dict_suggs);
-					dict_suggs = suggsT;
-					n_dict_suggs = n_suggsT;
-				}
+			enchant_dict_unlock_provider (dict);
+			enchant_stats_record (stats, ENCHANT_STATS_PROVIDER_SUGGEST, provider_start);
+			enchant_dict_trace_end (dict, hooks, "suggest", len, trace_start);
 		}
 
+	g_rw_lock_reader_lock (&session->lock);
+	if(dict_suggs)
+		n_dict_suggs = enchant_dict_keep_good_suggestions(dict, dict_suggs, n_dict_suggs);
+
 	/* Check for suggestions from personal dictionary */
 	if(session->personal)
 		{
-			pwl_suggs = enchant_pwl_suggest(session->personal, word, len, dict_suggs, &n_pwl_suggs);
+			pwl_suggs = enchant_pwl_suggest_loaded(session->personal, word, len, dict_suggs, &n_pwl_suggs);
 			if(pwl_suggs)
-				{
-					suggsT = enchant_dict_get_good_suggestions(dict, pwl_suggs, n_pwl_suggs, &n_suggsT);
-					enchant_free_string_list (pwl_suggs);
-					pwl_suggs = suggsT;
-					n_pwl_suggs = n_suggsT;
-				}
+				n_pwl_suggs = enchant_dict_keep_good_suggestions(dict, pwl_suggs, n_pwl_suggs);
 		}
-	/* Clone suggestions if there are any */
+	g_rw_lock_reader_unlock (&session->lock);
+
+	/* Merge suggestions if there are any */
 	n_suggs = n_pwl_suggs + n_dict_suggs;
 	if (n_suggs > 0)
 		{
+			GHashTable * seen;
+
 			suggs = g_new0 (char *, n_suggs + 1);
+			seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
-			/* Copy over suggestions from dict, if no dupes */
-			n_suggs = enchant_dict_merge_suggestions(suggs, 0,
+			/* Move over suggestions from dict, if no dupes */
+			n_suggs = enchant_dict_merge_suggestions(suggs, 0, seen,
 								 dict_suggs, n_dict_suggs);
 
-			/* Copy over suggestions from pwl, if no dupes */
-			n_suggs = enchant_dict_merge_suggestions(suggs, n_suggs,
+			/* Move over suggestions from pwl, if no dupes */
+			n_suggs = enchant_dict_merge_suggestions(suggs, n_suggs, seen,
 								 pwl_suggs, n_pwl_suggs);
-			if(n_suggs == 0)
-			{
-				g_free(suggs);
-				suggs = NULL;
-			}
+
+			g_hash_table_destroy (seen);
 		}
 	else
 		{
 			suggs = NULL;
 		}
 
-	g_strfreev(dict_suggs);
-	g_strfreev(pwl_suggs);
+	/* only the (emptied) lists are left */
+	g_free(dict_suggs);
+	g_free(pwl_suggs);
+
+	if (enchant_cache_is_enabled (session->suggest_cache))
+		enchant_cache_insert (session->suggest_cache, word, len, g_strdupv (suggs), generation);
 
 	if (out_n_suggs)
 		*out_n_suggs = n_suggs;
 
+	enchant_stats_record (stats, ENCHANT_STATS_SUGGEST, start);
+
 	return suggs;
 }
 
-void
-enchant_dict_add (EnchantDict * dict, const char *const word,
-			 ssize_t len)
+static void
+enchant_suggest_request_unref (EnchantSuggestRequest * request)
 {
-	EnchantSession * session;
-
-	g_return_if_fail (dict);
-	g_return_if_fail (word);
+	if (g_atomic_int_dec_and_test (&request->ref_count))
+		{
+			g_strfreev (request->suggs);
+			g_free (request->word);
+			g_free (request);
+		}
+}
 
-	if (len < 0)
-		len = strlen (word);
+/* Serves the queue of one dictionary, so that its provider is never used
+ * by two workers at once */
+static void
+enchant_dict_suggest_worker (gpointer data, gpointer user_data _GL_UNUSED_PARAMETER)
+{
+	EnchantDict * dict = (EnchantDict *) data;
+	EnchantDictPrivateData * dict_private_data = (EnchantDictPrivateData*)dict->enchant_private_data;
+	EnchantSuggestRequest * request;
 
-	g_return_if_fail (len);
-	g_return_if_fail (g_utf8_validate(word, len, NULL));
+	g_mutex_lock (&enchant_suggest_mutex);
+	while ((request = (EnchantSuggestRequest *) g_queue_pop_head (&dict_private_data->suggest_queue)) != NULL)
+		{
+			EnchantSuggestCallback callback = NULL;
+			char ** suggs;
+			size_t n_suggs = 0;
 
-	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
-	enchant_session_clear_error (session);
-	enchant_session_add_personal (session, word, len);
-	enchant_session_remove_exclude (session, word, len);
+			g_mutex_unlock (&enchant_suggest_mutex);
+			suggs = enchant_dict_suggest (dict, request->word, request->len, &n_suggs);
+			g_mutex_lock (&enchant_suggest_mutex);
 
-	if (dict->add_to_personal)
-		(*dict->add_to_personal) (dict, word, len);
+			request->done = TRUE;
+			if (request->cancelled)
+				g_strfreev (suggs);
+			else
+				{
+					request->suggs = suggs;
+					request->n_suggs = n_suggs;
+					callback = request->callback;
+				}
+			g_cond_broadcast (&enchant_suggest_cond);
+			g_mutex_unlock (&enchant_suggest_mutex);
+
+			if (callback)
+				(*callback) (request, request->user_data);
+			enchant_suggest_request_unref (request);
+
+			g_mutex_lock (&enchant_suggest_mutex);
+		}
+
+	dict_private_data->suggest_scheduled = FALSE;
+	g_cond_broadcast (&enchant_suggest_cond);
+	g_mutex_unlock (&enchant_suggest_mutex);
+}
+
+EnchantSuggestRequest *
+enchant_dict_suggest_async (EnchantDict * dict, const char *const word,
+			    ssize_t len, EnchantSuggestCallback callback,
+			    void * user_data)
+{
+	EnchantDictPrivateData * dict_private_data;
+	EnchantSuggestRequest * request;
+
+	g_return_val_if_fail (dict, NULL);
+	g_return_val_if_fail (word, NULL);
+
+	if (len < 0)
+		len = strlen (word);
+
+	g_return_val_if_fail (len, NULL);
+	g_return_val_if_fail (g_utf8_validate(word, len, NULL), NULL);
+
+	dict_private_data = (EnchantDictPrivateData*)dict->enchant_private_data;
+
+	request = g_new0 (EnchantSuggestRequest, 1);
+	request->dict = dict;
+	request->word = g_strndup (word, len);
+	request->len = len;
+	request->callback = callback;
+	request->user_data = user_data;
+	request->ref_count = 2;
+
+	g_mutex_lock (&enchant_suggest_mutex);
+	g_queue_push_tail (&dict_private_data->suggest_queue, request);
+	if (!dict_private_data->suggest_scheduled)
+		{
+			EnchantBroker * broker = dict_private_data->broker;
+
+			if (!broker->suggest_pool)
+				broker->suggest_pool = g_thread_pool_new (enchant_dict_suggest_worker, NULL,
+									  g_get_num_processors (), FALSE, NULL);
+			dict_private_data->suggest_scheduled = TRUE;
+			g_thread_pool_push (broker->suggest_pool, dict, NULL);
+		}
+	g_mutex_unlock (&enchant_suggest_mutex);
+
+	return request;
+}
+
+int
+enchant_suggest_request_is_done (EnchantSuggestRequest * request)
+{
+	int done;
+
+	g_return_val_if_fail (request, 0);
+
+	g_mutex_lock (&enchant_suggest_mutex);
+	done = request->done;
+	g_mutex_unlock (&enchant_suggest_mutex);
+
+	return done;
+}
+
+void
+enchant_suggest_request_wait (EnchantSuggestRequest * request)
+{
+	g_return_if_fail (request);
+
+	g_mutex_lock (&enchant_suggest_mutex);
+	while (!request->done)
+		g_cond_wait (&enchant_suggest_cond, &enchant_suggest_mutex);
+	g_mutex_unlock (&enchant_suggest_mutex);
+}
+
+char **
+enchant_suggest_request_get_suggestions (EnchantSuggestRequest * request,
+					 size_t * out_n_suggs)
+{
+	char ** suggs = NULL;
+	size_t n_suggs = 0;
+
+	g_return_val_if_fail (request, NULL);
+
+	g_mutex_lock (&enchant_suggest_mutex);
+	if (request->done)
+		{
+			suggs = request->suggs;
+			n_suggs = request->n_suggs;
+		}
+	g_mutex_unlock (&enchant_suggest_mutex);
+
+	if (out_n_suggs)
+		*out_n_suggs = n_suggs;
+
+	return suggs;
+}
+
+void
+enchant_suggest_request_cancel (EnchantSuggestRequest * request)
+{
+	EnchantDictPrivateData * dict_private_data;
+
+	g_return_if_fail (request);
+
+	g_mutex_lock (&enchant_suggest_mutex);
+	if (!request->done)
+		{
+			/* a running request is finished by its worker, which drops the result */
+			request->cancelled = TRUE;
+			request->done = TRUE;
+			g_cond_broadcast (&enchant_suggest_cond);
+
+			dict_private_data = (EnchantDictPrivateData*)request->dict->enchant_private_data;
+			if (g_queue_remove (&dict_private_data->suggest_queue, request))
+				enchant_suggest_request_unref (request);
+		}
+	g_mutex_unlock (&enchant_suggest_mutex);
+}
+
+void
+enchant_suggest_request_free (EnchantSuggestRequest * request)
+{
+	g_return_if_fail (request);
+
+	enchant_suggest_request_cancel (request);
+	enchant_suggest_request_unref (request);
+}
+
+void
+enchant_dict_add (EnchantDict * dict, const char *const word,
+			 ssize_t len)
+{
+	EnchantSession * session;
+	EnchantStats * stats;
+	gint64 start;
+
+	g_return_if_fail (dict);
+	g_return_if_fail (word);
+
+	if (len < 0)
+		len = strlen (word);
+
+	g_return_if_fail (len);
+	g_return_if_fail (g_utf8_validate(word, len, NULL));
+
+	stats = enchant_dict_get_collected_stats (dict);
+	start = enchant_stats_start (stats);
+
+	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	enchant_session_write_lock (session);
+	enchant_session_add_personal (session, word, len);
+	enchant_session_remove_exclude (session, word, len);
+	enchant_session_write_unlock (session);
+
+	if (dict->add_to_personal)
+		{
+			enchant_dict_lock_provider (dict);
+			(*dict->add_to_personal) (dict, word, len);
+			enchant_dict_unlock_provider (dict);
+		}
+
+	enchant_stats_record (stats, ENCHANT_STATS_ADD, start);
 }
 
 void
@@ -689,9 +1467,15 @@ enchant_dict_add_to_session (EnchantDict * dict, const char *const word,
 	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
 	enchant_session_clear_error (session);
 
+	enchant_session_write_lock (session);
 	enchant_session_add (session, word, len);
+	enchant_session_write_unlock (session);
 	if (dict->add_to_session)
-		(*dict->add_to_session) (dict, word, len);
+		{
+			enchant_dict_lock_provider (dict);
+			(*dict->add_to_session) (dict, word, len);
+			enchant_dict_unlock_provider (dict);
+		}
 }
 
 int
@@ -699,6 +1483,7 @@ enchant_dict_is_added (EnchantDict * dict, const char *const word,
 				ssize_t len)
 {
 	EnchantSession * session;
+	int result;
 
 	g_return_val_if_fail (dict, 0);
 	g_return_val_if_fail (word, 0);
@@ -711,8 +1496,13 @@ enchant_dict_is_added (EnchantDict * dict, const char *const word,
 
 	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
 	enchant_session_clear_error (session);
+	enchant_session_refresh (session);
+
+	g_rw_lock_reader_lock (&session->lock);
+	result = enchant_session_contains (session, word, len);
+	g_rw_lock_reader_unlock (&session->lock);
 
-	return enchant_session_contains (session, word, len);
+	return result;
 }
 
 void
@@ -720,6 +1510,8 @@ enchant_dict_remove (EnchantDict * dict, const char *const word,
 			 ssize_t len)
 {
 	EnchantSession * session;
+	EnchantStats * stats;
+	gint64 start;
 
 	g_return_if_fail (dict);
 	g_return_if_fail (word);
@@ -730,14 +1522,25 @@ enchant_dict_remove (EnchantDict * dict, const char *const word,
 	g_return_if_fail (len);
 	g_return_if_fail (g_utf8_validate(word, len, NULL));
 
+	stats = enchant_dict_get_collected_stats (dict);
+	start = enchant_stats_start (stats);
+
 	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
 	enchant_session_clear_error (session);
 
+	enchant_session_write_lock (session);
 	enchant_session_remove_personal (session, word, len);
 	enchant_session_add_exclude(session, word, len);
+	enchant_session_write_unlock (session);
 
 	if (dict->add_to_exclude)
-		(*dict->add_to_exclude) (dict, word, len);
+		{
+			enchant_dict_lock_provider (dict);
+			(*dict->add_to_exclude) (dict, word, len);
+			enchant_dict_unlock_provider (dict);
+		}
+
+	enchant_stats_record (stats, ENCHANT_STATS_REMOVE, start);
 }
 
 void
@@ -758,7 +1561,9 @@ enchant_dict_remove_from_session (EnchantDict * dict, const char *const word,
 	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
 	enchant_session_clear_error (session);
 
+	enchant_session_write_lock (session);
 	enchant_session_remove (session, word, len);
+	enchant_session_write_unlock (session);
 }
 
 int
@@ -766,6 +1571,7 @@ enchant_dict_is_removed (EnchantDict * dict, const char *const word,
 				ssize_t len)
 {
 	EnchantSession * session;
+	int result;
 
 	g_return_val_if_fail (dict, 0);
 	g_return_val_if_fail (word, 0);
@@ -778,8 +1584,13 @@ enchant_dict_is_removed (EnchantDict * dict, const char *const word,
 
 	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
 	enchant_session_clear_error (session);
+	enchant_session_refresh (session);
+
+	g_rw_lock_reader_lock (&session->lock);
+	result = enchant_session_exclude (session, word, len);
+	g_rw_lock_reader_unlock (&session->lock);
 
-	return enchant_session_exclude (session, word, len);
+	return result;
 }
 
 void
@@ -810,7 +1621,11 @@ enchant_dict_store_replacement (EnchantDict * dict,
 
 	/* if it's not implemented, it's not worth emulating */
 	if (dict->store_replacement)
-		(*dict->store_replacement) (dict, mis, mis_len, cor, cor_len);
+		{
+			enchant_dict_lock_provider (dict);
+			(*dict->store_replacement) (dict, mis, mis_len, cor, cor_len);
+			enchant_dict_unlock_provider (dict);
+		}
 }
 
 void
@@ -844,7 +1659,7 @@ enchant_dict_describe (EnchantDict * dict,
 
 	if (provider)
 		{
-			module = (GModule *) provider->enchant_private_data;
+			module = ((EnchantProviderPrivateData *) provider->enchant_private_data)->module;
 			file = g_module_name (module);
 			name = (*provider->identify) (provider);
 			desc = (*provider->describe) (provider);
@@ -860,24 +1675,103 @@ enchant_dict_describe (EnchantDict * dict,
 	(*fn) (tag, name, desc, file, user_data);
 }
 
+void
+enchant_dict_set_check_cache_size (EnchantDict * dict, size_t n_words)
+{
+	EnchantSession * session;
+
+	g_return_if_fail (dict);
+
+	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	enchant_cache_set_size (session->check_cache, n_words);
+}
+
+void
+enchant_dict_get_check_cache_stats (EnchantDict * dict, size_t * hits, size_t * misses)
+{
+	EnchantSession * session;
+
+	g_return_if_fail (dict);
+
+	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	enchant_cache_get_stats (session->check_cache, hits, misses);
+}
+
+void
+enchant_dict_set_suggest_cache_size (EnchantDict * dict, size_t n_words)
+{
+	EnchantSession * session;
+
+	g_return_if_fail (dict);
+
+	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	enchant_cache_set_size (session->suggest_cache, n_words);
+}
+
+void
+enchant_dict_get_suggest_cache_stats (EnchantDict * dict, size_t * hits, size_t * misses)
+{
+	EnchantSession * session;
+
+	g_return_if_fail (dict);
+
+	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	enchant_cache_get_stats (session->suggest_cache, hits, misses);
+}
+
+/* Calls @fn for each operation @stats counted */
+static void
+enchant_stats_report (const char * const provider_name, EnchantStats * stats,
+		      EnchantStatsFn fn, void * user_data)
+{
+	size_t histogram[ENCHANT_STATS_N_BUCKETS];
+	size_t count, total_usecs;
+	int operation;
+
+	for (operation = 0; operation < ENCHANT_STATS_N_OPERATIONS; operation++)
+		{
+			enchant_stats_get (stats, (EnchantStatsOperation) operation,
+					   &count, &total_usecs, histogram);
+			if (count)
+				(*fn) (provider_name, enchant_stats_operation_name ((EnchantStatsOperation) operation),
+				       count, total_usecs, histogram, ENCHANT_STATS_N_BUCKETS, user_data);
+		}
+}
+
+void
+enchant_dict_get_stats (EnchantDict * dict, EnchantStatsFn fn, void * user_data)
+{
+	EnchantSession * session;
+	EnchantStats * stats;
+
+	g_return_if_fail (dict);
+	g_return_if_fail (fn);
+
+	session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	stats = (EnchantStats *) g_atomic_pointer_get (&session->stats);
+	if (stats)
+		enchant_stats_report (enchant_session_get_provider_name (session), stats, fn, user_data);
+}
+
 /***********************************************************************************/
 /***********************************************************************************/
 
 static void
 enchant_broker_clear_error (EnchantBroker * broker)
 {
-	if (broker->error)
-		{
-			g_free (broker->error);
-			broker->error = NULL;
-		}
+	enchant_errors_unset (&broker->errors);
 }
 
 static void
 enchant_broker_set_error (EnchantBroker * broker, const char * const err)
 {
-	enchant_broker_clear_error (broker);
-	broker->error = strdup (err);
+	enchant_errors_set (&broker->errors, g_strdup (err));
 }
 
 static int
@@ -914,152 +1808,576 @@ enchant_provider_is_valid(EnchantProvider * provider)
 	return 1;
 }
 
-static void
-enchant_load_providers_in_dir (EnchantBroker * broker, const char *dir_name)
+/* Opens the module @dir_entry in @dir_name and returns its provider, or NULL
+ * if it has no valid one */
+static EnchantProvider *
+enchant_provider_load (EnchantBroker * broker, const char *dir_name, const char *dir_entry)
 {
 	GModule *module = NULL;
-	GDir *dir;
-	const char *dir_entry;
-	size_t entry_len, g_module_suffix_len;
-
 	char * filename;
 
-	EnchantProvider *provider;
+	EnchantProvider *provider = NULL;
 	EnchantProviderInitFunc init_func;
 	EnchantPreConfigureFunc conf_func;
 
-	dir = g_dir_open (dir_name, 0, NULL);
-	if (!dir)
-		return;
-
-	g_module_suffix_len = strlen (G_MODULE_SUFFIX);
-
-	while ((dir_entry = g_dir_read_name (dir)) != NULL)
-		{
-			provider = 0;
-
-			entry_len = strlen (dir_entry);
-			if ((entry_len > g_module_suffix_len) &&
-				!strcmp(dir_entry+(entry_len-g_module_suffix_len), G_MODULE_SUFFIX))
-				{
 #ifdef _WIN32
-					/* Suppress error popups for failing to load plugins */
-					UINT old_error_mode = SetErrorMode(SEM_FAILCRITICALERRORS);
+	/* Suppress error popups for failing to load plugins */
+	UINT old_error_mode = SetErrorMode(SEM_FAILCRITICALERRORS);
 #endif
-					filename = g_build_filename (dir_name, dir_entry, NULL);
-
-					module = g_module_open (filename, (GModuleFlags) 0);
-					if (module)
-						{
-							if (g_module_symbol
-								(module, "init_enchant_provider", (gpointer *) (&init_func))
-								&& init_func)
-								{
-									provider = init_func ();
-									if (!enchant_provider_is_valid(provider))
-										{
-											g_warning ("Error loading plugin: %s's init_enchant_provider returned invalid provider.\n", dir_entry);
-											if(provider)
-												{
-													if(provider->dispose)
-														provider->dispose(provider);
-
-													provider = NULL;
-												}
-											g_module_close (module);
-										}
-								}
-							else
-								{
-									g_module_close (module);
-								}
-						}
-					else
-						{
-							g_warning ("Error loading plugin: %s\n", g_module_error());
-						}
+	filename = g_build_filename (dir_name, dir_entry, NULL);
 
-					g_free (filename);
-#ifdef _WIN32
-					/* Restore the original error mode */
-					SetErrorMode(old_error_mode);
-#endif
-				}
-			if (provider)
+	module = g_module_open (filename, (GModuleFlags) 0);
+	if (module)
+		{
+			if (g_module_symbol
+				(module, "init_enchant_provider", (gpointer *) (&init_func))
+				&& init_func)
 				{
-					/* optional entry point to allow modules to look for associated files
-					 */
-					if (g_module_symbol
-						(module, "configure_enchant_provider", (gpointer *) (&conf_func))
-						&& conf_func)
+					provider = init_func ();
+					if (!enchant_provider_is_valid(provider))
 						{
-							conf_func (provider, dir_name);
-							if (!enchant_provider_is_valid(provider))
+							g_warning ("Error loading plugin: %s's init_enchant_provider returned invalid provider.\n", dir_entry);
+							if(provider)
 								{
-									g_warning ("Error loading plugin: %s's configure_enchant_provider modified provider and it is now invalid.\n", dir_entry);
 									if(provider->dispose)
 										provider->dispose(provider);
 
 									provider = NULL;
-									g_module_close (module);
 								}
+							g_module_close (module);
 						}
 				}
-			if (provider)
+			else
 				{
-					provider->enchant_private_data = (void *) module;
-					provider->owner = broker;
-					broker->provider_list = g_slist_append (broker->provider_list, (gpointer)provider);
+					g_module_close (module);
 				}
 		}
+	else
+		{
+			g_warning ("Error loading plugin: %s\n", g_module_error());
+		}
 
-	g_dir_close (dir);
+	g_free (filename);
+#ifdef _WIN32
+	/* Restore the original error mode */
+	SetErrorMode(old_error_mode);
+#endif
+
+	if (provider)
+		{
+			/* optional entry point to allow modules to look for associated files
+			 */
+			if (g_module_symbol
+				(module, "configure_enchant_provider", (gpointer *) (&conf_func))
+				&& conf_func)
+				{
+					conf_func (provider, dir_name);
+					if (!enchant_provider_is_valid(provider))
+						{
+							g_warning ("Error loading plugin: %s's configure_enchant_provider modified provider and it is now invalid.\n", dir_entry);
+							if(provider->dispose)
+								provider->dispose(provider);
+
+							provider = NULL;
+							g_module_close (module);
+						}
+				}
+		}
+	if (provider)
+		{
+			EnchantProviderPrivateData *provider_private_data;
+
+			provider_private_data = g_new0 (EnchantProviderPrivateData, 1);
+			provider_private_data->module = module;
+			g_mutex_init (&provider_private_data->lock);
+			provider->enchant_private_data = (void *) provider_private_data;
+			provider->owner = broker;
+		}
+
+	return provider;
 }
 
+/* Providers that don't take requests from several threads at once are
+ * called one thread at a time, as the broker may be unlocked meanwhile */
 static void
-enchant_load_providers (EnchantBroker * broker)
+enchant_provider_lock (EnchantProvider * provider)
 {
-	char *module_dir = enchant_relocate (PKGLIBDIR);
-	enchant_load_providers_in_dir (broker, module_dir);
-	free (module_dir);
+	if (!provider->concurrent_request_dict)
+		g_mutex_lock (&((EnchantProviderPrivateData *) provider->enchant_private_data)->lock);
 }
 
 static void
-enchant_load_ordering_from_file (EnchantBroker * broker, const char * file)
+enchant_provider_unlock (EnchantProvider * provider)
 {
-	char line[1024];
+	if (!provider->concurrent_request_dict)
+		g_mutex_unlock (&((EnchantProviderPrivateData *) provider->enchant_private_data)->lock);
+}
 
-	FILE * f = g_fopen (file, "r");
-	if (!f)
-		return;
+/* Returns the dictionaries @provider lists, NULL if it can't list them */
+static char **
+enchant_provider_list_tags (EnchantProvider * provider)
+{
+	size_t n_dicts = 0, i;
+	char ** dicts, ** tags;
 
-	while (NULL != fgets (line, sizeof(line), f)) {
-		size_t i, len;
+	if (!provider->list_dicts)
+		return NULL;
 
-		for (i = 0, len = strlen(line); i < len && line[i] != ':'; i++)
-			;
+	enchant_provider_lock (provider);
+	dicts = (*provider->list_dicts) (provider, &n_dicts);
+	enchant_provider_unlock (provider);
+	tags = g_new0 (char *, n_dicts + 1);
+	for (i = 0; i < n_dicts; i++)
+		tags[i] = g_strdup (dicts[i]);
+	enchant_free_string_list (dicts);
 
-		if (i < len)
-			{
-				char * tag = g_strndup (line, i);
-				char * ordering = g_strndup (line + (i + 1), len - i);
+	return tags;
+}
 
-				enchant_broker_set_ordering (broker, tag, ordering);
+static gboolean
+enchant_string_lists_equal (char ** a, char ** b)
+{
+	if (a == NULL || b == NULL)
+		return a == b;
 
-				g_free (tag);
-				g_free (ordering);
-			}
-	}
+	for (; *a && *b; a++, b++)
+		if (strcmp (*a, *b) != 0)
+			return FALSE;
 
-	fclose (f);
+	return *a == *b;
 }
 
-static void
-enchant_load_provider_ordering (EnchantBroker * broker)
+static EnchantProviderModule *
+enchant_provider_module_new (const char *dir_name, const char *dir_entry)
 {
-	GSList *conf_dirs, *iter;
+	EnchantProviderModule *module;
 
-	broker->provider_ordering = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	module = g_new0 (EnchantProviderModule, 1);
+	module->filename = g_build_filename (dir_name, dir_entry, NULL);
+	module->dir_name = g_strdup (dir_name);
+	module->dir_entry = g_strdup (dir_entry);
+
+	return module;
+}
+
+static void
+enchant_provider_dispose (EnchantProvider * provider)
+{
+	EnchantProviderPrivateData *provider_private_data = (EnchantProviderPrivateData *) provider->enchant_private_data;
+
+	if (provider->dispose)
+		(*provider->dispose) (provider);
+
+	/* close module only after invoking dispose */
+	g_module_close (provider_private_data->module);
+	g_mutex_clear (&provider_private_data->lock);
+	g_free (provider_private_data);
+}
+
+/* Called when the broker owning @provider is freed */
+static void
+enchant_provider_release (EnchantProvider * provider)
+{
+	gboolean in_use = FALSE;
+
+	g_mutex_lock (&enchant_shared_dicts_mutex);
+	if (enchant_shared_dict_providers &&
+	    g_hash_table_lookup (enchant_shared_dict_providers, provider) != NULL)
+		{
+			/* other brokers still use dicts it made */
+			provider->owner = NULL;
+			in_use = TRUE;
+		}
+	g_mutex_unlock (&enchant_shared_dicts_mutex);
+
+	if (!in_use)
+		enchant_provider_dispose (provider);
+}
+
+static char *
+enchant_shared_dict_key (EnchantProviderModule * module, const char * const tag)
+{
+	return g_strconcat (module->filename, "\n", tag, NULL);
+}
+
+/* Returns a new reference to the provider dict of @module for @tag that
+ * other brokers share, if any */
+static EnchantSharedDict *
+enchant_shared_dict_lookup (EnchantProviderModule * module, const char * const tag)
+{
+	EnchantSharedDict * shared = NULL;
+	char * key;
+
+	key = enchant_shared_dict_key (module, tag);
+	g_mutex_lock (&enchant_shared_dicts_mutex);
+	if (enchant_shared_dicts)
+		shared = (EnchantSharedDict *) g_hash_table_lookup (enchant_shared_dicts, key);
+	if (shared)
+		shared->ref_count++;
+	g_mutex_unlock (&enchant_shared_dicts_mutex);
+	g_free (key);
+
+	return shared;
+}
+
+/* Shares @dict, which @provider of @module just made for @tag, and returns
+ * a reference to it. If another broker shared one meanwhile, @dict is
+ * disposed of and that one is returned instead. */
+static EnchantSharedDict *
+enchant_shared_dict_add (EnchantProviderModule * module, const char * const tag,
+			 EnchantProvider * provider, EnchantDict * dict)
+{
+	EnchantSharedDict * shared;
+	char * key;
+	guint n_dicts;
+
+	key = enchant_shared_dict_key (module, tag);
+	g_mutex_lock (&enchant_shared_dicts_mutex);
+	if (!enchant_shared_dicts)
+		{
+			enchant_shared_dicts = g_hash_table_new (g_str_hash, g_str_equal);
+			enchant_shared_dict_providers = g_hash_table_new (g_direct_hash, g_direct_equal);
+		}
+
+	shared = (EnchantSharedDict *) g_hash_table_lookup (enchant_shared_dicts, key);
+	if (shared)
+		{
+			shared->ref_count++;
+			g_mutex_unlock (&enchant_shared_dicts_mutex);
+			g_free (key);
+
+			if (provider->dispose_dict)
+				{
+					enchant_provider_lock (provider);
+					(*provider->dispose_dict) (provider, dict);
+					enchant_provider_unlock (provider);
+				}
+			return shared;
+		}
+
+	shared = g_new0 (EnchantSharedDict, 1);
+	shared->key = key;
+	shared->provider = provider;
+	shared->dict = dict;
+	shared->ref_count = 1;
+	g_mutex_init (&shared->provider_lock);
+	g_hash_table_insert (enchant_shared_dicts, shared->key, shared);
+
+	n_dicts = GPOINTER_TO_UINT (g_hash_table_lookup (enchant_shared_dict_providers, provider));
+	g_hash_table_insert (enchant_shared_dict_providers, provider, GUINT_TO_POINTER (n_dicts + 1));
+	g_mutex_unlock (&enchant_shared_dicts_mutex);
+
+	return shared;
+}
+
+static void
+enchant_shared_dict_unref (EnchantSharedDict * shared)
+{
+	EnchantProvider * provider = shared->provider;
+	gboolean dispose_provider = FALSE;
+	guint n_dicts;
+
+	g_mutex_lock (&enchant_shared_dicts_mutex);
+	if (--shared->ref_count > 0)
+		{
+			g_mutex_unlock (&enchant_shared_dicts_mutex);
+			return;
+		}
+	g_hash_table_remove (enchant_shared_dicts, shared->key);
+	g_mutex_unlock (&enchant_shared_dicts_mutex);
+
+	/* the provider stays counted until its dict is disposed of, so that
+	 * its broker can't dispose of it meanwhile */
+	if (provider->dispose_dict)
+		{
+			enchant_provider_lock (provider);
+			(*provider->dispose_dict) (provider, shared->dict);
+			enchant_provider_unlock (provider);
+		}
+
+	g_mutex_lock (&enchant_shared_dicts_mutex);
+	n_dicts = GPOINTER_TO_UINT (g_hash_table_lookup (enchant_shared_dict_providers, provider)) - 1;
+	if (n_dicts > 0)
+		g_hash_table_insert (enchant_shared_dict_providers, provider, GUINT_TO_POINTER (n_dicts));
+	else
+		{
+			g_hash_table_remove (enchant_shared_dict_providers, provider);
+			dispose_provider = provider->owner == NULL;
+		}
+	g_mutex_unlock (&enchant_shared_dicts_mutex);
+
+	if (dispose_provider)
+		enchant_provider_dispose (provider);
+
+	g_mutex_clear (&shared->provider_lock);
+	g_free (shared->key);
+	g_free (shared);
+}
+
+static void
+enchant_provider_module_free (gpointer data)
+{
+	EnchantProviderModule *module;
+
+	g_return_if_fail (data);
+
+	module = (EnchantProviderModule *) data;
+
+	if (module->provider)
+		enchant_provider_release (module->provider);
+
+	g_free (module->filename);
+	g_free (module->dir_name);
+	g_free (module->dir_entry);
+	g_free (module->identifier);
+	g_free (module->description);
+	g_strfreev (module->tags);
+	g_free (module);
+}
+
+static void
+enchant_provider_module_set_provider (EnchantProviderModule * module, EnchantProvider * provider)
+{
+	module->provider = provider;
+	if (!provider)
+		module->failed = TRUE;
+	/* once set, these don't change, so they may be read without locking */
+	else if (!module->identifier)
+		{
+			module->identifier = g_strdup ((*provider->identify) (provider));
+			module->description = g_strdup ((*provider->describe) (provider));
+		}
+}
+
+/* The manifest has a group per module, named after its file. A module
+ * without an identifier is not a provider. */
+static gboolean
+enchant_provider_module_read_manifest (EnchantProviderModule * module, GKeyFile * manifest)
+{
+	const char * group = module->filename;
+
+	if (!g_key_file_has_group (manifest, group) ||
+	    g_key_file_get_int64 (manifest, group, "mtime", NULL) != module->mtime ||
+	    g_key_file_get_int64 (manifest, group, "size", NULL) != module->size)
+		return FALSE;
+
+	if (g_key_file_has_key (manifest, group, "identifier", NULL))
+		{
+			char * identifier, * description;
+
+			identifier = g_key_file_get_string (manifest, group, "identifier", NULL);
+			description = g_key_file_get_string (manifest, group, "description", NULL);
+			if (identifier == NULL || description == NULL)
+				{
+					g_free (identifier);
+					g_free (description);
+					return FALSE;
+				}
+
+			module->identifier = identifier;
+			module->description = description;
+			if (g_key_file_has_key (manifest, group, "dictionaries", NULL))
+				module->tags = g_key_file_get_string_list (manifest, group, "dictionaries", NULL, NULL);
+		}
+
+	return TRUE;
+}
+
+static void
+enchant_provider_module_write_manifest (EnchantProviderModule * module, GKeyFile * manifest)
+{
+	const char * group = module->filename;
+
+	g_key_file_remove_group (manifest, group, NULL);
+	g_key_file_set_int64 (manifest, group, "mtime", module->mtime);
+	g_key_file_set_int64 (manifest, group, "size", module->size);
+	if (module->provider)
+		{
+			g_key_file_set_string (manifest, group, "identifier", module->identifier);
+			g_key_file_set_string (manifest, group, "description", module->description);
+			if (module->tags)
+				g_key_file_set_string_list (manifest, group, "dictionaries",
+							    (const gchar * const *) module->tags,
+							    g_strv_length (module->tags));
+		}
+}
+
+static void
+enchant_broker_save_manifest (EnchantBroker * broker)
+{
+	char * data, * dir;
+	gsize length;
+
+	dir = g_path_get_dirname (broker->manifest_file);
+	enchant_ensure_dir_exists (dir);
+	g_free (dir);
+
+	/* the manifest only saves time, so not being able to write it is no error */
+	data = g_key_file_to_data (broker->manifest, &length, NULL);
+	if (data)
+		g_file_set_contents (broker->manifest_file, data, length, NULL);
+	g_free (data);
+}
+
+/* Returns the provider of @module, loading the module if need be. Must be
+ * called with the broker locked. */
+static EnchantProvider *
+enchant_provider_module_get_provider (EnchantBroker * broker, EnchantProviderModule * module)
+{
+	char ** tags;
+
+	if (module->provider || module->failed)
+		return module->provider;
+
+	enchant_provider_module_set_provider (module,
+					      enchant_provider_load (broker, module->dir_name, module->dir_entry));
+	if (!module->provider)
+		return NULL;
+
+	/* dictionaries may have come or gone since the manifest was written */
+	tags = enchant_provider_list_tags (module->provider);
+	if (!enchant_string_lists_equal (tags, module->tags))
+		{
+			g_strfreev (module->tags);
+			module->tags = tags;
+			enchant_provider_module_write_manifest (module, broker->manifest);
+			enchant_broker_save_manifest (broker);
+		}
+	else
+		g_strfreev (tags);
+
+	return module->provider;
+}
+
+/* Whether @module may provide @tag. For lazy brokers, a module that is not
+ * loaded yet may not if the provider didn't list @tag when last loaded. */
+static gboolean
+enchant_provider_module_may_provide (EnchantProviderModule * module, const char * const tag)
+{
+	size_t i;
+
+	if (module->provider || !module->tags)
+		return TRUE;
+
+	for (i = 0; module->tags[i]; i++)
+		if (!strcmp (module->tags[i], tag))
+			return TRUE;
+
+	return FALSE;
+}
+
+/* Whether any of the modules in @list may provide @tag */
+static gboolean
+enchant_provider_modules_may_provide (GSList * list, const char * const tag)
+{
+	for (; list != NULL; list = g_slist_next (list))
+		if (enchant_provider_module_may_provide ((EnchantProviderModule *) list->data, tag))
+			return TRUE;
+
+	return FALSE;
+}
+
+static void
+enchant_load_providers_in_dir (EnchantBroker * broker, const char *dir_name)
+{
+	GDir *dir;
+	const char *dir_entry;
+	size_t entry_len, g_module_suffix_len;
+	gboolean manifest_changed = FALSE;
+
+	EnchantProviderModule *module;
+	GStatBuf st;
+
+	dir = g_dir_open (dir_name, 0, NULL);
+	if (!dir)
+		return;
+
+	g_module_suffix_len = strlen (G_MODULE_SUFFIX);
+
+	while ((dir_entry = g_dir_read_name (dir)) != NULL)
+		{
+			entry_len = strlen (dir_entry);
+			if ((entry_len <= g_module_suffix_len) ||
+				strcmp(dir_entry+(entry_len-g_module_suffix_len), G_MODULE_SUFFIX))
+				continue;
+
+			module = enchant_provider_module_new (dir_name, dir_entry);
+
+			if (broker->manifest && g_stat (module->filename, &st) == 0)
+				{
+					module->mtime = st.st_mtime;
+					module->size = st.st_size;
+
+					if (!enchant_provider_module_read_manifest (module, broker->manifest))
+						{
+							enchant_provider_module_set_provider (module,
+											      enchant_provider_load (broker, dir_name, dir_entry));
+							if (module->provider)
+								module->tags = enchant_provider_list_tags (module->provider);
+							enchant_provider_module_write_manifest (module, broker->manifest);
+							manifest_changed = TRUE;
+						}
+				}
+			else
+				enchant_provider_module_set_provider (module,
+								      enchant_provider_load (broker, dir_name, dir_entry));
+
+			if (module->identifier)
+				broker->provider_modules = g_slist_append (broker->provider_modules, module);
+			else
+				enchant_provider_module_free (module);
+		}
+
+	g_dir_close (dir);
+
+	if (manifest_changed)
+		enchant_broker_save_manifest (broker);
+}
+
+static void
+enchant_load_providers (EnchantBroker * broker)
+{
+	char *module_dir = enchant_relocate (PKGLIBDIR);
+	enchant_load_providers_in_dir (broker, module_dir);
+	free (module_dir);
+}
+
+static void
+enchant_load_ordering_from_file (EnchantBroker * broker, const char * file)
+{
+	char line[1024];
+
+	FILE * f = g_fopen (file, "r");
+	if (!f)
+		return;
+
+	while (NULL != fgets (line, sizeof(line), f)) {
+		size_t i, len;
+
+		for (i = 0, len = strlen(line); i < len && line[i] != ':'; i++)
+			;
+
+		if (i < len)
+			{
+				char * tag = g_strndup (line, i);
+				char * ordering = g_strndup (line + (i + 1), len - i);
+
+				enchant_broker_set_ordering (broker, tag, ordering);
+
+				g_free (tag);
+				g_free (ordering);
+			}
+	}
+
+	fclose (f);
+}
+
+static void
+enchant_load_provider_ordering (EnchantBroker * broker)
+{
+	GSList *conf_dirs, *iter;
+
+	broker->provider_ordering = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
 	conf_dirs = enchant_get_conf_dirs ();
 	for (iter = conf_dirs; iter; iter = iter->next)
@@ -1073,11 +2391,12 @@ enchant_load_provider_ordering (EnchantBroker * broker)
 	g_slist_free_full (conf_dirs, g_free);
 }
 
+/* Returns the EnchantProviderModules in the order they are to be asked for @tag */
 static GSList *
 enchant_get_ordered_providers (EnchantBroker * broker,
 				   const char * const tag)
 {
-	EnchantProvider *provider;
+	EnchantProviderModule *module;
 	GSList * list = NULL, * iter = NULL;
 
 	char * ordering = NULL, ** tokens, *token;
@@ -1090,7 +2409,8 @@ enchant_get_ordered_providers (EnchantBroker * broker,
 	if (!ordering)
 		{
 			/* return an unordered copy of the list */
-			for (iter = broker->provider_list; iter != NULL; iter = g_slist_next (iter))
+			for (iter = broker->provider_modules; iter != NULL; iter = g_slist_next (iter))
+				if (!((EnchantProviderModule *) iter->data)->failed)
 					list = g_slist_append (list, iter->data);
 			return list;
 		}
@@ -1102,12 +2422,12 @@ enchant_get_ordered_providers (EnchantBroker * broker,
 				{
 					token = g_strstrip(tokens[i]);
 
-					for (iter = broker->provider_list; iter != NULL; iter = g_slist_next (iter))
+					for (iter = broker->provider_modules; iter != NULL; iter = g_slist_next (iter))
 						{
-							provider = (EnchantProvider*)iter->data;
+							module = (EnchantProviderModule*)iter->data;
 
-							if (provider && !strcmp (token, (*provider->identify)(provider)))
-								list = g_slist_append (list, (gpointer)provider);
+							if (!module->failed && !strcmp (token, module->identifier))
+								list = g_slist_append (list, (gpointer)module);
 						}
 				}
 
@@ -1115,15 +2435,68 @@ enchant_get_ordered_providers (EnchantBroker * broker,
 		}
 
 	/* providers not in the list need to be appended at the end */
-	for (iter = broker->provider_list; iter != NULL; iter = g_slist_next (iter))
+	for (iter = broker->provider_modules; iter != NULL; iter = g_slist_next (iter))
 		{
-			if (!g_slist_find (list, iter->data))
+			if (!((EnchantProviderModule *) iter->data)->failed && !g_slist_find (list, iter->data))
 				list = g_slist_append (list, iter->data);
 		}
 
 	return list;
 }
 
+static EnchantDictPrivateData *
+enchant_dict_private_data_new (EnchantBroker * broker, EnchantSession * session)
+{
+	EnchantDictPrivateData *enchant_dict_private_data;
+
+	enchant_dict_private_data = g_new0 (EnchantDictPrivateData, 1);
+	enchant_dict_private_data->reference_count = 1;
+	enchant_dict_private_data->session = session;
+	enchant_dict_private_data->broker = broker;
+	g_mutex_init (&enchant_dict_private_data->provider_lock);
+	enchant_dict_private_data->provider_mutex = &enchant_dict_private_data->provider_lock;
+	g_queue_init (&enchant_dict_private_data->suggest_queue);
+
+	return enchant_dict_private_data;
+}
+
+/* Cancels the suggestion requests that have not started yet and waits
+ * for the one being worked on, if any */
+static void
+enchant_dict_cancel_suggestions (EnchantDictPrivateData * dict_private_data)
+{
+	EnchantSuggestRequest * request;
+
+	g_mutex_lock (&enchant_suggest_mutex);
+	while ((request = (EnchantSuggestRequest *) g_queue_pop_head (&dict_private_data->suggest_queue)) != NULL)
+		{
+			request->cancelled = TRUE;
+			request->done = TRUE;
+			enchant_suggest_request_unref (request);
+		}
+	g_cond_broadcast (&enchant_suggest_cond);
+
+	while (dict_private_data->suggest_scheduled)
+		g_cond_wait (&enchant_suggest_cond, &enchant_suggest_mutex);
+	g_mutex_unlock (&enchant_suggest_mutex);
+}
+
+/* must be called with the broker locked */
+static EnchantStats *
+enchant_broker_get_provider_stats (EnchantBroker * broker, const char * const provider_name)
+{
+	EnchantStats * stats;
+
+	stats = (EnchantStats *) g_hash_table_lookup (broker->provider_stats, provider_name);
+	if (stats == NULL)
+		{
+			stats = enchant_stats_new ();
+			g_hash_table_insert (broker->provider_stats, g_strdup (provider_name), stats);
+		}
+
+	return stats;
+}
+
 static void
 enchant_dict_destroyed (gpointer data)
 {
@@ -1139,192 +2512,637 @@ enchant_dict_destroyed (gpointer data)
 	session = enchant_dict_private_data->session;
 	owner = session->provider;
 
-	if (owner && owner->dispose_dict)
-		(*owner->dispose_dict) (owner, dict);
+	enchant_dict_cancel_suggestions (enchant_dict_private_data);
+
+	/* the broker keeps counting what its freed dicts did */
+	if (session->stats && !enchant_dict_private_data->shared_dict)
+		enchant_stats_merge (enchant_broker_get_provider_stats (enchant_dict_private_data->broker,
+									enchant_session_get_provider_name (session)),
+				     session->stats);
+
+	if (enchant_dict_private_data->shared_provider_dict)
+		{
+			g_free (dict);
+			enchant_shared_dict_unref (enchant_dict_private_data->shared_provider_dict);
+		}
+	else if (owner && owner->dispose_dict)
+		{
+			enchant_provider_lock (owner);
+			(*owner->dispose_dict) (owner, dict);
+			enchant_provider_unlock (owner);
+		}
 	else if(session->is_pwl)
 		g_free (dict);
 
-	g_free(enchant_dict_private_data);
+	g_mutex_clear (&enchant_dict_private_data->provider_lock);
 
-	enchant_session_destroy (session);
+	/* the session of a per-thread dict belongs to its shared dict */
+	if (!enchant_dict_private_data->shared_dict)
+		enchant_session_destroy (session);
+
+	g_free (enchant_dict_private_data->thread_key);
+	g_free (enchant_dict_private_data);
 }
 
 static void
-enchant_provider_free (gpointer data)
+enchant_preload_free (gpointer data)
 {
-	EnchantProvider *provider;
-	GModule *module;
+	EnchantPreload * preload = (EnchantPreload *) data;
 
-	g_return_if_fail (data);
+	g_free (preload->tag);
+	g_free (preload->dict_tag);
+	g_free (preload);
+}
 
-	provider = (EnchantProvider *) data;
-	module = (GModule *) provider->enchant_private_data;
+static void enchant_broker_free_dict_locked (EnchantBroker * broker, EnchantDict * dict);
 
-	if (provider->dispose)
-		(*provider->dispose) (provider);
+/* must be called with the broker locked */
+static void
+enchant_broker_ref_dict (EnchantBroker * broker, EnchantDict * dict)
+{
+	EnchantDictPrivateData * dict_private_data = (EnchantDictPrivateData*)dict->enchant_private_data;
 
-	/* close module only after invoking dispose */
-	g_module_close (module);
+	/* a dict kept for the memory budget is in use again */
+	if (dict_private_data->reference_count == 0)
+		g_queue_remove (&broker->unused_dicts, dict);
+	dict_private_data->reference_count++;
 }
 
-EnchantBroker *
-enchant_broker_init (void)
+/* What a dict counts for against the memory budget when its provider cannot
+ * estimate it; a mid-sized dictionary, so that such dicts cannot pile up */
+#define ENCHANT_DICT_UNKNOWN_MEMORY_USAGE (4 * 1024 * 1024)
+
+static size_t
+enchant_dict_budget_usage (EnchantDictPrivateData * dict_private_data)
 {
-	EnchantBroker *broker = NULL;
+	return dict_private_data->memory_usage ? dict_private_data->memory_usage : ENCHANT_DICT_UNKNOWN_MEMORY_USAGE;
+}
 
-	g_return_val_if_fail (g_module_supported (), NULL);
+/* must be called with the broker locked. Frees the least recently used of
+ * the dicts nobody uses until the provider dicts fit in the budget. */
+static void
+enchant_broker_trim_dicts (EnchantBroker * broker)
+{
+	GHashTableIter iter;
+	gpointer value;
+	size_t total = 0;
+
+	g_hash_table_iter_init (&iter, broker->dict_map);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		total += enchant_dict_budget_usage ((EnchantDictPrivateData*)((EnchantDict *) value)->enchant_private_data);
+
+	while (!g_queue_is_empty (&broker->unused_dicts) &&
+	       (total > broker->dict_memory_budget || broker->dict_memory_budget == 0))
+		{
+			EnchantDict * dict = (EnchantDict *) g_queue_pop_tail (&broker->unused_dicts);
+			EnchantDictPrivateData * dict_private_data = (EnchantDictPrivateData*)dict->enchant_private_data;
+
+			total -= enchant_dict_budget_usage (dict_private_data);
+			g_hash_table_remove (broker->dict_map, dict_private_data->session->language_tag);
+		}
+}
+
+static EnchantBroker *
+enchant_broker_new (gboolean lazy)
+{
+	EnchantBroker *broker = NULL;
 
 	broker = g_new0 (EnchantBroker, 1);
+	g_mutex_init (&broker->lock);
+	enchant_errors_init (&broker->errors);
 
 	broker->dict_map = g_hash_table_new_full (g_str_hash, g_str_equal,
 						  g_free, enchant_dict_destroyed);
+	/* keys are owned by the dicts' private data */
+	broker->thread_dict_map = g_hash_table_new_full (g_str_hash, g_str_equal,
+							 NULL, enchant_dict_destroyed);
+	broker->provider_stats = g_hash_table_new_full (g_str_hash, g_str_equal,
+							g_free, (GDestroyNotify) enchant_stats_free);
+	/* keys are owned by the preloads */
+	broker->preloads = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  NULL, enchant_preload_free);
+	g_cond_init (&broker->preload_cond);
+
+	if (lazy)
+		{
+			char * config_dir = enchant_get_user_config_dir ();
+
+			broker->manifest_file = g_build_filename (config_dir, "providers.cache", NULL);
+			broker->manifest = g_key_file_new ();
+			/* a missing or unreadable manifest is rebuilt */
+			g_key_file_load_from_file (broker->manifest, broker->manifest_file, G_KEY_FILE_NONE, NULL);
+			g_free (config_dir);
+		}
+
 	enchant_load_providers (broker);
 	enchant_load_provider_ordering (broker);
 
 	return broker;
 }
 
+EnchantBroker *
+enchant_broker_init (void)
+{
+	g_return_val_if_fail (g_module_supported (), NULL);
+
+	return enchant_broker_new (FALSE);
+}
+
+EnchantBroker *
+enchant_broker_init_lazy (void)
+{
+	g_return_val_if_fail (g_module_supported (), NULL);
+
+	return enchant_broker_new (TRUE);
+}
+
 void
 enchant_broker_free (EnchantBroker * broker)
 {
+	GHashTableIter iter;
+	gpointer value;
 	guint n_remaining;
 
 	g_return_if_fail (broker);
 
+	/* preloads that have not started are dropped, and the dicts of the
+	 * others released */
+	if (broker->preload_pool)
+		g_thread_pool_free (broker->preload_pool, TRUE, TRUE);
+	g_hash_table_iter_init (&iter, broker->preloads);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		{
+			EnchantPreload * preload = (EnchantPreload *) value;
+
+			if (preload->dict)
+				enchant_broker_free_dict_locked (broker, preload->dict);
+		}
+	g_hash_table_destroy (broker->preloads);
+	g_cond_clear (&broker->preload_cond);
+
+	broker->dict_memory_budget = 0;
+	enchant_broker_trim_dicts (broker);
+
 	n_remaining = g_hash_table_size (broker->dict_map);
 	if (n_remaining)
 		{
 			g_warning ("%u dictionaries weren't free'd.\n", n_remaining);
 		}
 
-	/* will destroy any remaining dictionaries for us */
+	/* will destroy any remaining dictionaries for us, the per-thread ones
+	 * first as they use the sessions of the shared ones */
+	g_hash_table_destroy (broker->thread_dict_map);
 	g_hash_table_destroy (broker->dict_map);
 	g_hash_table_destroy (broker->provider_ordering);
+	g_hash_table_destroy (broker->provider_stats);
+	g_free (broker->trace_hooks);
+	g_slist_free_full (broker->old_trace_hooks, g_free);
+
+	if (broker->suggest_pool)
+		g_thread_pool_free (broker->suggest_pool, FALSE, TRUE);
+
+	g_slist_free_full (broker->provider_modules, enchant_provider_module_free);
+	if (broker->manifest)
+		g_key_file_free (broker->manifest);
+	g_free (broker->manifest_file);
+
+	enchant_errors_clear (&broker->errors);
+	g_mutex_clear (&broker->lock);
+
+	g_free (broker);
+}
+
+EnchantDict *
+enchant_broker_request_pwl_dict (EnchantBroker * broker, const char *const pwl)
+{
+	EnchantSession *session;
+	EnchantDictPrivateData *enchant_dict_private_data;
+	EnchantDict *dict = NULL;
+
+	g_return_val_if_fail (broker, NULL);
+	g_return_val_if_fail (pwl && strlen(pwl), NULL);
+
+	enchant_broker_clear_error (broker);
+
+	g_mutex_lock (&broker->lock);
+	dict = (EnchantDict*)g_hash_table_lookup (broker->dict_map, (gpointer) pwl);
+	if (dict) {
+		((EnchantDictPrivateData*)dict->enchant_private_data)->reference_count++;
+		g_mutex_unlock (&broker->lock);
+		return dict;
+	}
+
+	/* since the broker pwl file is a read/write file (there is no readonly dictionary associated)
+	 * there is no need for complementary exclude file to add a word to. The word just needs to be
+	 * removed from the broker pwl file
+	 */
+	session = enchant_session_new_with_pwl (NULL, pwl, NULL, "Personal Wordlist", TRUE);
+	if (!session)
+		{
+			g_mutex_unlock (&broker->lock);
+			enchant_errors_set (&broker->errors,
+					    g_strdup_printf ("Couldn't open personal wordlist '%s'", pwl));
+			return NULL;
+		}
+
+	session->is_pwl = 1;
+	enchant_session_set_refresh_interval (session, broker->pwl_refresh_interval);
+
+	dict = g_new0 (EnchantDict, 1);
+	enchant_dict_private_data = enchant_dict_private_data_new (broker, session);
+	dict->enchant_private_data = (void *)enchant_dict_private_data;
+
+	g_hash_table_insert (broker->dict_map, (gpointer)strdup (pwl), dict);
+	g_mutex_unlock (&broker->lock);
+
+	return dict;
+}
+
+/* must be called with the broker locked. The provider is asked with the
+ * broker unlocked, so that other requests, and loads from other providers,
+ * go on meanwhile; providers that don't take requests from several threads
+ * at once are locked instead. @provider_mutex, if given, is held as well, for
+ * a provider shared with other brokers. */
+static EnchantDict *
+enchant_provider_request_dict (EnchantBroker * broker, EnchantProvider * provider,
+			       GMutex * provider_mutex, const char *const tag)
+{
+	EnchantDict * dict;
+	gboolean collect_stats;
+	gint64 start;
+
+	collect_stats = g_atomic_int_get (&broker->collect_stats);
+	start = collect_stats ? g_get_monotonic_time () : 0;
+
+	g_mutex_unlock (&broker->lock);
+	if (provider_mutex)
+		g_mutex_lock (provider_mutex);
+	enchant_provider_lock (provider);
+	dict = (*provider->request_dict) (provider, tag);
+	enchant_provider_unlock (provider);
+	if (provider_mutex)
+		g_mutex_unlock (provider_mutex);
+	g_mutex_lock (&broker->lock);
+
+	if (collect_stats)
+		enchant_stats_record (enchant_broker_get_provider_stats (broker, (*provider->identify) (provider)),
+				      ENCHANT_STATS_REQUEST_DICT, start);
+
+	return dict;
+}
+
+static EnchantDict *
+_enchant_broker_request_dict (EnchantBroker * broker, const char *const tag)
+{
+	EnchantDict * dict;
+	GSList * list;
+	GSList * listIter;
+	int pass;
+
+	dict = (EnchantDict*)g_hash_table_lookup (broker->dict_map, (gpointer) tag);
+	if (dict) {
+		enchant_broker_ref_dict (broker, dict);
+		return dict;
+	}
+
+	/* lazy brokers first load only the providers that listed the tag, then
+	 * the others in case they take tags they don't list */
+	list = enchant_get_ordered_providers (broker, tag);
+	for (pass = 0; pass < 2 && !dict; pass++)
+		{
+			for (listIter = list; listIter != NULL; listIter = g_slist_next (listIter))
+				{
+					EnchantProviderModule * module;
+					EnchantProvider * provider;
+					EnchantSharedDict * shared = NULL;
+					EnchantDict * existing;
+					EnchantSession *session;
+					EnchantDictPrivateData *enchant_dict_private_data;
+
+					module = (EnchantProviderModule *) listIter->data;
+
+					/* dictionaries may have been installed since the manifest
+					 * was written, so a module is loaded, and its dictionaries
+					 * listed again, before one it is preferred to is chosen */
+					if (pass == 0 && !enchant_provider_module_may_provide (module, tag) &&
+					    enchant_provider_modules_may_provide (g_slist_next (listIter), tag))
+						enchant_provider_module_get_provider (broker, module);
+
+					if (enchant_provider_module_may_provide (module, tag) != (pass == 0))
+						continue;
+
+					if (broker->share_dicts)
+						shared = enchant_shared_dict_lookup (module, tag);
+
+					if (shared)
+						provider = shared->provider;
+					else
+						{
+							provider = enchant_provider_module_get_provider (broker, module);
+							if (!provider || !provider->request_dict)
+								continue;
+
+							dict = enchant_provider_request_dict (broker, provider, NULL, tag);
+							if (!dict)
+								continue;
+
+							/* another thread may have loaded it meanwhile */
+							existing = (EnchantDict*)g_hash_table_lookup (broker->dict_map, (gpointer) tag);
+							if (existing)
+								{
+									if (provider->dispose_dict)
+										{
+											enchant_provider_lock (provider);
+											(*provider->dispose_dict) (provider, dict);
+											enchant_provider_unlock (provider);
+										}
+									enchant_broker_ref_dict (broker, existing);
+									dict = existing;
+									break;
+								}
+
+							if (broker->share_dicts)
+								shared = enchant_shared_dict_add (module, tag, provider, dict);
+						}
+
+					/* each broker has a copy of a shared dict, with its own session */
+					if (shared)
+						{
+							dict = g_new (EnchantDict, 1);
+							*dict = *shared->dict;
+						}
+
+					session = enchant_session_new (provider, tag);
+					if (session)
+						enchant_session_set_refresh_interval (session, broker->pwl_refresh_interval);
+					enchant_dict_private_data = enchant_dict_private_data_new (broker, session);
+					if (shared)
+						{
+							enchant_dict_private_data->shared_provider_dict = shared;
+							enchant_dict_private_data->provider_mutex = &shared->provider_lock;
+						}
+					if (dict->get_memory_usage)
+						enchant_dict_private_data->memory_usage = (*dict->get_memory_usage) (dict);
+					dict->enchant_private_data = (void *)enchant_dict_private_data;
+					g_hash_table_insert (broker->dict_map, (gpointer)strdup (tag), dict);
+					if (broker->dict_memory_budget)
+						enchant_broker_trim_dicts (broker);
+					break;
+				}
+		}
+
+	g_slist_free (list);
+
+	return dict;
+}
+
+/* must be called with the broker locked */
+static EnchantDict *
+enchant_broker_request_dict_locked (EnchantBroker * broker, const char *const tag)
+{
+	EnchantDict *dict = NULL;
+	char * normalized_tag;
+
+	normalized_tag = enchant_normalize_dictionary_tag (tag);
+	if(!enchant_is_valid_dictionary_tag(normalized_tag))
+		{
+			enchant_broker_set_error (broker, "invalid tag character found");
+		}
+	else if ((dict = _enchant_broker_request_dict (broker, normalized_tag)) == NULL)
+		{
+			char * iso_639_only_tag;
+
+			iso_639_only_tag = enchant_iso_639_from_tag (normalized_tag);
+
+			dict = _enchant_broker_request_dict (broker, iso_639_only_tag);
+
+			free (iso_639_only_tag);
+		}
+
+	free (normalized_tag);
+
+	return dict;
+}
+
+EnchantDict *
+enchant_broker_request_dict (EnchantBroker * broker, const char *const tag)
+{
+	EnchantDict *dict;
 
-	g_slist_free_full (broker->provider_list, enchant_provider_free);
+	g_return_val_if_fail (broker, NULL);
+	g_return_val_if_fail (tag && strlen(tag), NULL);
 
 	enchant_broker_clear_error (broker);
 
-	g_free (broker);
+	g_mutex_lock (&broker->lock);
+	dict = enchant_broker_request_dict_locked (broker, tag);
+	g_mutex_unlock (&broker->lock);
+
+	return dict;
 }
 
 EnchantDict *
-enchant_broker_request_pwl_dict (EnchantBroker * broker, const char *const pwl)
+enchant_broker_request_dict_for_thread (EnchantBroker * broker, const char *const tag)
 {
+	EnchantDict *shared_dict, *dict;
 	EnchantSession *session;
+	EnchantSharedDict *shared_provider_dict;
 	EnchantDictPrivateData *enchant_dict_private_data;
-	EnchantDict *dict = NULL;
+	char * thread_key;
 
 	g_return_val_if_fail (broker, NULL);
-	g_return_val_if_fail (pwl && strlen(pwl), NULL);
+	g_return_val_if_fail (tag && strlen(tag), NULL);
 
 	enchant_broker_clear_error (broker);
 
-	dict = (EnchantDict*)g_hash_table_lookup (broker->dict_map, (gpointer) pwl);
-	if (dict) {
-		((EnchantDictPrivateData*)dict->enchant_private_data)->reference_count++;
-		return dict;
-	}
-
-	/* since the broker pwl file is a read/write file (there is no readonly dictionary associated)
-	 * there is no need for complementary exclude file to add a word to. The word just needs to be
-	 * removed from the broker pwl file
-	 */
-	session = enchant_session_new_with_pwl (NULL, pwl, NULL, "Personal Wordlist", TRUE);
-	if (!session)
+	g_mutex_lock (&broker->lock);
+	shared_dict = enchant_broker_request_dict_locked (broker, tag);
+	if (!shared_dict)
 		{
-			broker->error = g_strdup_printf ("Couldn't open personal wordlist '%s'", pwl);
+			g_mutex_unlock (&broker->lock);
 			return NULL;
 		}
 
-	session->is_pwl = 1;
-
-	dict = g_new0 (EnchantDict, 1);
-	enchant_dict_private_data = g_new0 (EnchantDictPrivateData, 1);
-	enchant_dict_private_data->reference_count = 1;
-	enchant_dict_private_data->session = session;
-	dict->enchant_private_data = (void *)enchant_dict_private_data;
+	session = ((EnchantDictPrivateData*)shared_dict->enchant_private_data)->session;
+	thread_key = g_strdup_printf ("%s:%p", session->language_tag, (void *) g_thread_self ());
 
-	g_hash_table_insert (broker->dict_map, (gpointer)strdup (pwl), dict);
+	dict = (EnchantDict*)g_hash_table_lookup (broker->thread_dict_map, thread_key);
+	if (dict)
+		{
+			((EnchantDictPrivateData*)dict->enchant_private_data)->reference_count++;
+			enchant_broker_free_dict_locked (broker, shared_dict);
+			g_free (thread_key);
+		}
+	else
+		{
+			/* the per-thread dict keeps the reference to the shared dict
+			 * taken above. If the provider can't open another dict, the
+			 * shared one is all this thread gets. */
+			shared_provider_dict = ((EnchantDictPrivateData*)shared_dict->enchant_private_data)->shared_provider_dict;
+			dict = enchant_provider_request_dict (broker, session->provider,
+							      shared_provider_dict ? &shared_provider_dict->provider_lock : NULL,
+							      session->language_tag);
+			if (dict)
+				{
+					enchant_dict_private_data = enchant_dict_private_data_new (broker, session);
+					enchant_dict_private_data->shared_dict = shared_dict;
+					enchant_dict_private_data->thread_key = thread_key;
+					dict->enchant_private_data = (void *)enchant_dict_private_data;
+					g_hash_table_insert (broker->thread_dict_map, thread_key, dict);
+				}
+			else
+				{
+					dict = shared_dict;
+					g_free (thread_key);
+				}
+		}
+	g_mutex_unlock (&broker->lock);
 
 	return dict;
 }
 
-static EnchantDict *
-_enchant_broker_request_dict (EnchantBroker * broker, const char *const tag)
+/* must be called with the broker locked. Hands the dict of @preload over
+ * to the unused dicts the memory budget keeps, so that it can be unloaded
+ * like them. */
+static void
+enchant_broker_release_preload (EnchantBroker * broker, EnchantPreload * preload)
 {
-	EnchantDict * dict;
-	GSList * list;
-	GSList * listIter;
+	EnchantDictPrivateData * dict_private_data;
 
-	dict = (EnchantDict*)g_hash_table_lookup (broker->dict_map, (gpointer) tag);
-	if (dict) {
-		((EnchantDictPrivateData*)dict->enchant_private_data)->reference_count++;
-		return dict;
-	}
+	if (!preload->dict)
+		return;
 
-	list = enchant_get_ordered_providers (broker, tag);
-	for (listIter = list; listIter != NULL; listIter = g_slist_next (listIter))
-		{
-			EnchantProvider * provider;
+	dict_private_data = (EnchantDictPrivateData*)preload->dict->enchant_private_data;
+	g_free (preload->dict_tag);
+	preload->dict_tag = g_strdup (dict_private_data->session->language_tag);
+	enchant_broker_free_dict_locked (broker, preload->dict);
+	preload->dict = NULL;
+}
+
+/* must be called with the broker locked */
+static gboolean
+enchant_broker_preload_is_loaded (EnchantBroker * broker, EnchantPreload * preload)
+{
+	return preload->dict ||
+	       (preload->dict_tag && g_hash_table_lookup (broker->dict_map, preload->dict_tag));
+}
+
+static void
+enchant_broker_preload_worker (gpointer data, gpointer user_data)
+{
+	EnchantPreload * preload = (EnchantPreload *) data;
+	EnchantBroker * broker = (EnchantBroker *) user_data;
+
+	/* the broker is unlocked while the provider loads the dict */
+	g_mutex_lock (&broker->lock);
+	preload->dict = enchant_broker_request_dict_locked (broker, preload->tag);
+	preload->done = TRUE;
+	if (broker->dict_memory_budget)
+		enchant_broker_release_preload (broker, preload);
+	g_cond_broadcast (&broker->preload_cond);
+	g_mutex_unlock (&broker->lock);
+}
+
+void
+enchant_broker_preload (EnchantBroker * broker, const char *const *const tags, size_t n_tags)
+{
+	size_t i;
 
-			provider = (EnchantProvider *) listIter->data;
+	g_return_if_fail (broker);
+	g_return_if_fail (tags || !n_tags);
+	for (i = 0; i < n_tags; i++)
+		g_return_if_fail (tags[i] && strlen(tags[i]));
+
+	enchant_broker_clear_error (broker);
+
+	g_mutex_lock (&broker->lock);
+	for (i = 0; i < n_tags; i++)
+		{
+			EnchantPreload * preload;
+			char * normalized_tag;
 
-			if (provider->request_dict)
+			normalized_tag = enchant_normalize_dictionary_tag (tags[i]);
+			if (!enchant_is_valid_dictionary_tag (normalized_tag))
 				{
-					dict = (*provider->request_dict) (provider, tag);
+					enchant_broker_set_error (broker, "invalid tag character found");
+					free (normalized_tag);
+					continue;
+				}
 
-					if (dict)
-						{
-							EnchantSession *session;
-							EnchantDictPrivateData *enchant_dict_private_data;
-
-							session = enchant_session_new (provider, tag);
-							enchant_dict_private_data = g_new0 (EnchantDictPrivateData, 1);
-							enchant_dict_private_data->reference_count = 1;
-							enchant_dict_private_data->session = session;
-							dict->enchant_private_data = (void *)enchant_dict_private_data;
-							g_hash_table_insert (broker->dict_map, (gpointer)strdup (tag), dict);
-							break;
-						}
+			/* a tag is loaded again only if no dict was found last time,
+			 * or the memory budget unloaded it since */
+			preload = (EnchantPreload *) g_hash_table_lookup (broker->preloads, normalized_tag);
+			if (preload && (!preload->done || enchant_broker_preload_is_loaded (broker, preload)))
+				{
+					free (normalized_tag);
+					continue;
 				}
-		}
 
-	g_slist_free (list);
+			if (!preload)
+				{
+					preload = g_new0 (EnchantPreload, 1);
+					preload->tag = g_strdup (normalized_tag);
+					g_hash_table_insert (broker->preloads, preload->tag, preload);
+				}
+			preload->done = FALSE;
+			free (normalized_tag);
 
-	return dict;
+			if (!broker->preload_pool)
+				broker->preload_pool = g_thread_pool_new (enchant_broker_preload_worker, broker,
+									  g_get_num_processors (), FALSE, NULL);
+			g_thread_pool_push (broker->preload_pool, preload, NULL);
+		}
+	g_mutex_unlock (&broker->lock);
 }
 
-EnchantDict *
-enchant_broker_request_dict (EnchantBroker * broker, const char *const tag)
+int
+enchant_broker_dict_is_ready (EnchantBroker * broker, const char *const tag)
 {
-	EnchantDict *dict = NULL;
+	EnchantPreload * preload;
 	char * normalized_tag;
+	int ready;
 
-	g_return_val_if_fail (broker, NULL);
-	g_return_val_if_fail (tag && strlen(tag), NULL);
+	g_return_val_if_fail (broker, -1);
+	g_return_val_if_fail (tag && strlen(tag), -1);
 
 	enchant_broker_clear_error (broker);
 
 	normalized_tag = enchant_normalize_dictionary_tag (tag);
-	if(!enchant_is_valid_dictionary_tag(normalized_tag))
-		{
-			enchant_broker_set_error (broker, "invalid tag character found");
-		}
-	else if ((dict = _enchant_broker_request_dict (broker, normalized_tag)) == NULL)
-		{
-			char * iso_639_only_tag;
 
-			iso_639_only_tag = enchant_iso_639_from_tag (normalized_tag);
+	g_mutex_lock (&broker->lock);
+	preload = (EnchantPreload *) g_hash_table_lookup (broker->preloads, normalized_tag);
+	if (g_hash_table_lookup (broker->dict_map, normalized_tag))
+		ready = 1;
+	else if (preload)
+		ready = !preload->done ? 0 : enchant_broker_preload_is_loaded (broker, preload) ? 1 : -1;
+	else
+		ready = -1;
+	g_mutex_unlock (&broker->lock);
 
-			dict = _enchant_broker_request_dict (broker, iso_639_only_tag);
+	free (normalized_tag);
 
-			free (iso_639_only_tag);
-		}
+	return ready;
+}
 
-	free (normalized_tag);
+static gboolean
+enchant_preload_is_pending (gpointer key _GL_UNUSED_PARAMETER, gpointer value,
+			    gpointer user_data _GL_UNUSED_PARAMETER)
+{
+	return !((EnchantPreload *) value)->done;
+}
 
-	return dict;
+void
+enchant_broker_preload_wait (EnchantBroker * broker)
+{
+	g_return_if_fail (broker);
+
+	enchant_broker_clear_error (broker);
+
+	/* preloads may be added while waiting, so look again after each wake */
+	g_mutex_lock (&broker->lock);
+	while (g_hash_table_find (broker->preloads, enchant_preload_is_pending, NULL))
+		g_cond_wait (&broker->preload_cond, &broker->lock);
+	g_mutex_unlock (&broker->lock);
 }
 
 void
@@ -1332,28 +3150,28 @@ enchant_broker_describe (EnchantBroker * broker,
 			 EnchantBrokerDescribeFn fn,
 			 void * user_data)
 {
-	GSList *list;
-	EnchantProvider *provider;
-	GModule *module;
-
-	const char * name, * desc, * file;
+	GSList *list, *modules = NULL;
+	EnchantProviderModule *module;
 
 	g_return_if_fail (broker);
 	g_return_if_fail (fn);
 
 	enchant_broker_clear_error (broker);
 
-	for (list = broker->provider_list; list != NULL; list = g_slist_next (list))
-		{
-			provider = (EnchantProvider *) list->data;
-			module = (GModule *) provider->enchant_private_data;
-
-			name = (*provider->identify) (provider);
-			desc = (*provider->describe) (provider);
-			file = g_module_name (module);
+	/* lazy brokers describe the modules they haven't loaded from the manifest */
+	g_mutex_lock (&broker->lock);
+	for (list = broker->provider_modules; list != NULL; list = g_slist_next (list))
+		if (!((EnchantProviderModule *) list->data)->failed)
+			modules = g_slist_prepend (modules, list->data);
+	g_mutex_unlock (&broker->lock);
 
-			(*fn) (name, desc, file, user_data);
+	modules = g_slist_reverse (modules);
+	for (list = modules; list != NULL; list = g_slist_next (list))
+		{
+			module = (EnchantProviderModule *) list->data;
+			(*fn) (module->identifier, module->description, module->filename, user_data);
 		}
+	g_slist_free (modules);
 }
 
 void
@@ -1362,7 +3180,7 @@ enchant_broker_list_dicts (EnchantBroker * broker,
 			   void * user_data)
 {
 	GSList *list;
-	GHashTable *tags;
+	GHashTable *tags, *orderings;
 	GHashTableIter iter;
 	gpointer key, value;
 
@@ -1370,21 +3188,28 @@ enchant_broker_list_dicts (EnchantBroker * broker,
 	g_return_if_fail (fn);
 
 	tags = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	/* several providers usually list the same tags */
+	orderings = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_slist_free);
 
 	enchant_broker_clear_error (broker);
 
-	for (list = broker->provider_list; list != NULL; list = g_slist_next (list))
+	g_mutex_lock (&broker->lock);
+	for (list = broker->provider_modules; list != NULL; list = g_slist_next (list))
 		{
+			EnchantProviderModule *module;
 			EnchantProvider *provider;
 
-			provider = (EnchantProvider *) list->data;
+			module = (EnchantProviderModule *) list->data;
+			provider = enchant_provider_module_get_provider (broker, module);
 
-			if (provider->list_dicts)
+			if (provider && provider->list_dicts)
 				{
 					size_t n_dicts, i;
 					char ** dicts;
 
+					enchant_provider_lock (provider);
 					dicts = (*provider->list_dicts) (provider, &n_dicts);
+					enchant_provider_unlock (provider);
 
 					for (i = 0; i < n_dicts; i++)
 						{
@@ -1396,8 +3221,13 @@ enchant_broker_list_dicts (EnchantBroker * broker,
 								GSList *providers;
 								gint this_priority;
 
-								providers = enchant_get_ordered_providers (broker, tag);
-								this_priority = g_slist_index (providers, provider);
+								providers = (GSList *) g_hash_table_lookup (orderings, tag);
+								if (providers == NULL)
+									{
+										providers = enchant_get_ordered_providers (broker, tag);
+										g_hash_table_insert (orderings, g_strdup (tag), providers);
+									}
+								this_priority = g_slist_index (providers, module);
 								if (this_priority != -1) {
 									gint min_priority;
 
@@ -1406,65 +3236,82 @@ enchant_broker_list_dicts (EnchantBroker * broker,
 									if (ptr != NULL)
 										min_priority = g_slist_index (providers, ptr);
 									if (this_priority < min_priority)
-										g_hash_table_insert (tags, strdup (tag), provider);
+										g_hash_table_insert (tags, strdup (tag), module);
 								}
-								g_slist_free (providers);
 							}
 						}
 
 					enchant_free_string_list (dicts);
 				}
 		}
+	g_mutex_unlock (&broker->lock);
+	g_hash_table_destroy (orderings);
 
 	g_hash_table_iter_init (&iter, tags);
 	while (g_hash_table_iter_next (&iter, &key, &value))
 		{
-			const char * tag, * name, * desc, * file;
-			EnchantProvider * provider;
-			GModule *module;
+			EnchantProviderModule * module;
 
-			tag = (const char *) key;
-			provider = (EnchantProvider *) value;
-			module = (GModule *) provider->enchant_private_data;
-			name = (*provider->identify) (provider);
-			desc = (*provider->describe) (provider);
-			file = g_module_name (module);
-			(*fn) (tag, name, desc, file, user_data);
+			module = (EnchantProviderModule *) value;
+			(*fn) ((const char *) key, module->identifier, module->description,
+			       module->filename, user_data);
 		}
 
 	g_hash_table_destroy (tags);
 }
 
-void
-enchant_broker_free_dict (EnchantBroker * broker, EnchantDict * dict)
+/* must be called with the broker locked */
+static void
+enchant_broker_free_dict_locked (EnchantBroker * broker, EnchantDict * dict)
 {
 	EnchantSession * session;
+	EnchantDict * shared_dict;
 	EnchantDictPrivateData * dict_private_data;
 
-	g_return_if_fail (broker);
-	g_return_if_fail (dict);
-
-	enchant_broker_clear_error (broker);
-
 	dict_private_data = (EnchantDictPrivateData*)dict->enchant_private_data;
 	dict_private_data->reference_count--;
 	if(dict_private_data->reference_count == 0)
 		{
 			session = dict_private_data->session;
+			shared_dict = dict_private_data->shared_dict;
 
-			if (session->provider)
+			if (shared_dict)
+				{
+					g_hash_table_remove (broker->thread_dict_map, dict_private_data->thread_key);
+					enchant_broker_free_dict_locked (broker, shared_dict);
+				}
+			else if (session->provider && broker->dict_memory_budget)
+				{
+					g_queue_push_head (&broker->unused_dicts, dict);
+					enchant_broker_trim_dicts (broker);
+				}
+			else if (session->provider)
 				g_hash_table_remove (broker->dict_map, session->language_tag);
 			else
 				g_hash_table_remove (broker->dict_map, session->personal_filename);
 		}
 }
 
+void
+enchant_broker_free_dict (EnchantBroker * broker, EnchantDict * dict)
+{
+	g_return_if_fail (broker);
+	g_return_if_fail (dict);
+
+	enchant_broker_clear_error (broker);
+
+	g_mutex_lock (&broker->lock);
+	enchant_broker_free_dict_locked (broker, dict);
+	g_mutex_unlock (&broker->lock);
+}
+
 static int
 enchant_provider_dictionary_exists (EnchantProvider * provider,
 					 const char * const tag)
 {
 	int exists = 0;
 
+	enchant_provider_lock (provider);
 	if (provider->dictionary_exists)
 		{
 			exists = (*provider->dictionary_exists) (provider, tag);
@@ -1496,6 +3343,7 @@ enchant_provider_dictionary_exists (EnchantProvider * provider,
 					exists = 1;
 				}
 		}
+	enchant_provider_unlock (provider);
 
 	return exists;
 }
@@ -1505,6 +3353,7 @@ _enchant_broker_dict_exists (EnchantBroker * broker,
 				 const char * const tag)
 {
 	GSList * list;
+	int pass;
 
 	/* don't query the providers if it is an empty string */
 	if (tag == NULL || *tag == '\0') {
@@ -1516,15 +3365,23 @@ _enchant_broker_dict_exists (EnchantBroker * broker,
 		return 1;
 	}
 
-	for (list = broker->provider_list; list != NULL; list = g_slist_next (list))
+	/* as for _enchant_broker_request_dict */
+	for (pass = 0; pass < 2; pass++)
 		{
-			EnchantProvider * provider;
+			for (list = broker->provider_modules; list != NULL; list = g_slist_next (list))
+				{
+					EnchantProviderModule * module;
+					EnchantProvider * provider;
 
-			provider = (EnchantProvider *) list->data;
+					module = (EnchantProviderModule *) list->data;
+					if (enchant_provider_module_may_provide (module, tag) != (pass == 0))
+						continue;
 
-			if (enchant_provider_dictionary_exists (provider, tag))
-				{
-					return 1;
+					provider = enchant_provider_module_get_provider (broker, module);
+					if (provider && enchant_provider_dictionary_exists (provider, tag))
+						{
+							return 1;
+						}
 				}
 		}
 
@@ -1545,6 +3402,7 @@ enchant_broker_dict_exists (EnchantBroker * broker,
 
 	normalized_tag = enchant_normalize_dictionary_tag (tag);
 
+	g_mutex_lock (&broker->lock);
 	if(!enchant_is_valid_dictionary_tag(normalized_tag))
 		{
 			enchant_broker_set_error (broker, "invalid tag character found");
@@ -1562,6 +3420,7 @@ enchant_broker_dict_exists (EnchantBroker * broker,
 
 			free (iso_639_only_tag);
 		}
+	g_mutex_unlock (&broker->lock);
 
 	free (normalized_tag);
 	return exists;
@@ -1590,8 +3449,10 @@ enchant_broker_set_ordering (EnchantBroker * broker,
 		ordering_dupl && strlen(ordering_dupl))
 		{
 			/* we will free ordering_dupl && tag_dupl when the hash is destroyed */
+			g_mutex_lock (&broker->lock);
 			g_hash_table_insert (broker->provider_ordering, (gpointer)tag_dupl,
 					     (gpointer)(ordering_dupl));
+			g_mutex_unlock (&broker->lock);
 		}
 	else
 		{
@@ -1600,6 +3461,221 @@ enchant_broker_set_ordering (EnchantBroker * broker,
 		}
 }
 
+static void
+enchant_dict_set_refresh_interval (gpointer key, gpointer value, gpointer user_data)
+{
+	EnchantDict * dict = (EnchantDict *) value;
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	int msecs = *(int *) user_data;
+
+	if (session)
+		{
+			enchant_session_write_lock (session);
+			enchant_session_set_refresh_interval (session, msecs);
+			enchant_session_write_unlock (session);
+		}
+}
+
+void
+enchant_broker_set_pwl_refresh_interval (EnchantBroker * broker, int msecs)
+{
+	g_return_if_fail (broker);
+	g_return_if_fail (msecs >= 0);
+
+	enchant_broker_clear_error (broker);
+
+	g_mutex_lock (&broker->lock);
+	broker->pwl_refresh_interval = msecs;
+	g_hash_table_foreach (broker->dict_map, enchant_dict_set_refresh_interval, &msecs);
+	g_mutex_unlock (&broker->lock);
+}
+
+void
+enchant_broker_set_dict_sharing (EnchantBroker * broker, int enabled)
+{
+	g_return_if_fail (broker);
+
+	enchant_broker_clear_error (broker);
+
+	g_mutex_lock (&broker->lock);
+	broker->share_dicts = enabled != 0;
+	g_mutex_unlock (&broker->lock);
+}
+
+void
+enchant_broker_set_dict_memory_budget (EnchantBroker * broker, size_t n_bytes)
+{
+	g_return_if_fail (broker);
+
+	enchant_broker_clear_error (broker);
+
+	g_mutex_lock (&broker->lock);
+	broker->dict_memory_budget = n_bytes;
+	if (n_bytes)
+		{
+			GHashTableIter iter;
+			gpointer value;
+
+			g_hash_table_iter_init (&iter, broker->preloads);
+			while (g_hash_table_iter_next (&iter, NULL, &value))
+				enchant_broker_release_preload (broker, (EnchantPreload *) value);
+		}
+	enchant_broker_trim_dicts (broker);
+	g_mutex_unlock (&broker->lock);
+}
+
+typedef struct
+{
+	char * tag;
+	size_t memory_usage;
+	gboolean in_use;
+} EnchantDictMemory;
+
+void
+enchant_broker_describe_dict_memory (EnchantBroker * broker,
+				     EnchantDictMemoryFn fn,
+				     void * user_data)
+{
+	GHashTableIter iter;
+	gpointer value;
+	GSList *list, *dicts = NULL;
+
+	g_return_if_fail (broker);
+	g_return_if_fail (fn);
+
+	enchant_broker_clear_error (broker);
+
+	/* the callback may use the broker, so it is called unlocked */
+	g_mutex_lock (&broker->lock);
+	g_hash_table_iter_init (&iter, broker->dict_map);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		{
+			EnchantDictPrivateData * dict_private_data;
+			EnchantDictMemory * memory;
+
+			dict_private_data = (EnchantDictPrivateData*)((EnchantDict *) value)->enchant_private_data;
+			if (!dict_private_data->session->provider)
+				continue;
+
+			memory = g_new (EnchantDictMemory, 1);
+			memory->tag = g_strdup (dict_private_data->session->language_tag);
+			memory->memory_usage = dict_private_data->memory_usage;
+			memory->in_use = dict_private_data->reference_count > 0;
+			dicts = g_slist_prepend (dicts, memory);
+		}
+	g_mutex_unlock (&broker->lock);
+
+	for (list = dicts; list != NULL; list = g_slist_next (list))
+		{
+			EnchantDictMemory * memory = (EnchantDictMemory *) list->data;
+
+			(*fn) (memory->tag, memory->memory_usage, memory->in_use, user_data);
+			g_free (memory->tag);
+			g_free (memory);
+		}
+	g_slist_free (dicts);
+}
+
+void
+enchant_broker_set_stats_enabled (EnchantBroker * broker, int enabled)
+{
+	g_return_if_fail (broker);
+
+	enchant_broker_clear_error (broker);
+
+	g_mutex_lock (&broker->lock);
+	g_atomic_int_set (&broker->collect_stats, enabled != 0);
+	g_mutex_unlock (&broker->lock);
+}
+
+void
+enchant_broker_get_stats (EnchantBroker * broker,
+			  EnchantStatsFn fn,
+			  void * user_data)
+{
+	GHashTable * totals;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_return_if_fail (broker);
+	g_return_if_fail (fn);
+
+	enchant_broker_clear_error (broker);
+
+	/* add the dicts still in use to copies of the totals of the freed ones,
+	 * and call back unlocked, as the callback may use the broker */
+	totals = g_hash_table_new_full (g_str_hash, g_str_equal,
+					g_free, (GDestroyNotify) enchant_stats_free);
+
+	g_mutex_lock (&broker->lock);
+	g_hash_table_iter_init (&iter, broker->provider_stats);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		{
+			EnchantStats * stats = enchant_stats_new ();
+
+			enchant_stats_merge (stats, (EnchantStats *) value);
+			g_hash_table_insert (totals, g_strdup ((const char *) key), stats);
+		}
+
+	g_hash_table_iter_init (&iter, broker->dict_map);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		{
+			EnchantSession * session;
+			EnchantStats * session_stats, * stats;
+			const char * provider_name;
+
+			session = ((EnchantDictPrivateData*)((EnchantDict *) value)->enchant_private_data)->session;
+			session_stats = (EnchantStats *) g_atomic_pointer_get (&session->stats);
+			if (session_stats == NULL)
+				continue;
+
+			provider_name = enchant_session_get_provider_name (session);
+			stats = (EnchantStats *) g_hash_table_lookup (totals, provider_name);
+			if (stats == NULL)
+				{
+					stats = enchant_stats_new ();
+					g_hash_table_insert (totals, g_strdup (provider_name), stats);
+				}
+			enchant_stats_merge (stats, session_stats);
+		}
+	g_mutex_unlock (&broker->lock);
+
+	g_hash_table_iter_init (&iter, totals);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		enchant_stats_report ((const char *) key, (EnchantStats *) value, fn, user_data);
+
+	g_hash_table_destroy (totals);
+}
+
+void
+enchant_broker_set_trace_hooks (EnchantBroker * broker,
+				EnchantTraceBeginFn begin,
+				EnchantTraceEndFn end,
+				void * user_data)
+{
+	EnchantTraceHooks * hooks = NULL;
+
+	g_return_if_fail (broker);
+
+	enchant_broker_clear_error (broker);
+
+	if (begin || end)
+		{
+			hooks = g_new (EnchantTraceHooks, 1);
+			hooks->begin = begin;
+			hooks->end = end;
+			hooks->user_data = user_data;
+		}
+
+	/* the old hooks are kept until the broker is freed, as other threads
+	 * may be calling them */
+	g_mutex_lock (&broker->lock);
+	if (broker->trace_hooks)
+		broker->old_trace_hooks = g_slist_prepend (broker->old_trace_hooks, broker->trace_hooks);
+	g_atomic_pointer_set (&broker->trace_hooks, hooks);
+	g_mutex_unlock (&broker->lock);
+}
+
 void
 enchant_provider_set_error (EnchantProvider * provider, const char * const err)
 {
@@ -1609,10 +3685,11 @@ enchant_provider_set_error (EnchantProvider * provider, const char * const err)
 	g_return_if_fail (err);
 	g_return_if_fail (g_utf8_validate(err, -1, NULL));
 
+	/* a provider kept for dicts shared with other brokers after its own
+	 * broker was freed has nowhere to report to */
 	broker = provider->owner;
-	g_return_if_fail (broker);
-
-	enchant_broker_set_error (broker, err);
+	if (broker)
+		enchant_broker_set_error (broker, err);
 }
 
 const char *
@@ -1620,7 +3697,7 @@ enchant_broker_get_error (EnchantBroker * broker)
 {
 	g_return_val_if_fail (broker, NULL);
 
-	return broker->error;
+	return enchant_errors_get (&broker->errors);
 }
 
 char *
@@ -33,11 +33,11 @@
  *  type EnchantPWL.
  *
  *  Under the hood, a PWL is stored as a Trie.  Checking strings for
- *  correctness and making suggestions is done by traversing the Trie
- *  while allowing a certain number of miss-steps.  Due to the prefix
- *  compression of the Trie, this allows all strings in the PWL within
- *  a given edit distance of the target word to be enumerated quite
- *  efficiently.
+ *  correctness is a simple walk down the Trie; suggestions are made by
+ *  traversing the Trie while computing the edit distance to the target
+ *  word incrementally.  Due to the prefix compression of the Trie, this
+ *  allows all strings in the PWL within a given edit distance of the
+ *  target word to be enumerated quite efficiently.
  *
  *  Ideas for the future:
  *
@@ -46,9 +46,6 @@
  *       at the front of the list.  Would need a "soundex" that is
  *       general enough to handle languages other than English.
  *
- *     - iterative deepending to find suggestions, rather than a straight
- *       search to depth three.
- *
  */
 
 #include "config.h"
@@ -59,53 +56,179 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/file.h>
+#include <unistd.h>
 #include <fcntl.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
 #include "enchant-provider.h"
-#include "unused-parameter.h"
 
 #include "pwl.h"
 
 #define ENCHANT_PWL_MAX_ERRORS 3
 #define ENCHANT_PWL_MAX_SUGGS 15
 
+/* Words up to this many characters are compared without allocating */
+#define ENCHANT_PWL_EDIT_DIST_MAX_CHARS 64
+
+/* Word lists at least this large are also saved in compiled form */
+#define ENCHANT_PWL_INDEX_MIN_WORDS 10000
+#define ENCHANT_PWL_INDEX_SUFFIX ".idx"
+#define ENCHANT_PWL_INDEX_VERSION 4
+#define ENCHANT_PWL_INDEX_BYTE_ORDER 0x01020304
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/* The bytes just before the end of what was read of a word list, which
+ * must be unchanged for the file to count as merely appended to */
+#define ENCHANT_PWL_SIGNATURE_LEN 64
+
+/* Lists of up to this many words keep a Bloom filter of their words, with
+ * about this many bits per word and probes per lookup */
+#define ENCHANT_PWL_BLOOM_MAX_WORDS 4096
+#define ENCHANT_PWL_BLOOM_BITS_PER_WORD 16
+#define ENCHANT_PWL_BLOOM_MIN_BITS 512
+#define ENCHANT_PWL_BLOOM_PROBES 3
+
+/* Removing a word appends a line of this prefix followed by the word.
+ * Being a comment, it is skipped by readers that don't know about it. */
+#define ENCHANT_PWL_REMOVED_PREFIX "#!remove "
+
 /*  A PWL dictionary is stored as a Trie-like data structure EnchantTrie.
- *  The EnchantTrie datatype is completely recursive - all child nodes
- *  are simply EnchantTrie pointers.  This means that all functions 
- *  that potentially modify a trie need to return the modified trie,
- *  as additional memory may have been allocated.
+ *  All nodes of the trie live in one growable array owned by the trie
+ *  and refer to each other by index rather than by pointer, so a trie
+ *  costs a single allocation for its nodes plus one for its strings.
+ *
+ *  Nodes use the "first child, next sibling" representation: every node
+ *  records the character leading to it, the index of its first child
+ *  and the index of its next sibling.  Siblings are kept sorted by
+ *  character.  Node 0 is the root; since the root is never anybody's
+ *  child or sibling, index 0 doubles as "no node".
  *
- *  The empty trie is simply the null pointer.  If a trie contains
- *  a single string, it is recorded in the "value" attribute and
- *  "subtries" is set to NULL.  When two or more strings are contained,
- *  "value" is NULL and "subtries" is a GHashTable mapping the first
- *  character of each string to the subtrie containing the remainder of
- *  that string.
+ *  The original (non-normalized) spelling of every word is kept in a
+ *  separate string arena, and the node at which a word ends records the
+ *  offset of that spelling.  Nodes released by removals are kept on a
+ *  free list for reuse, and the string arena is compacted once the
+ *  strings of removed words outweigh the live ones.
  *
- *  All strings stored in the Trie are assumed to be in UTF format.
- *  Branching is done on unicode characters, not individual bytes.
+ *  All strings stored in the Trie are assumed to be in UTF format and
+ *  NFD-normalized.  Branching is done on unicode characters, not
+ *  individual bytes.
+ *
+ *  Small tries also keep a Bloom filter of their words, so that looking
+ *  up a word that is not there, by far the most common case for exclude
+ *  lists, usually takes neither an allocation nor a walk down the trie.
+ *  Words are hashed with their letters folded to one case and their
+ *  combining marks left out, so that a word and the case variants and
+ *  normalization forms enchant_pwl_check looks for all hash alike.  The
+ *  bits of removed words stay set until the trie is cleared.
  */
+typedef guint32 EnchantTrieIndex;
+
+typedef struct str_enchant_trie_node EnchantTrieNode;
+struct str_enchant_trie_node
+{
+	gunichar ch;                   /* character on the edge leading to this node */
+	EnchantTrieIndex first_child;  /* 0 if the node has no children */
+	EnchantTrieIndex next_sibling; /* 0 if last; links the free list once released */
+	guint32 word;                  /* 1 + offset of the word ending here in strings, or 0 */
+};
+
 typedef struct str_enchant_trie EnchantTrie;
 struct str_enchant_trie
 {
-	char* value;           /* final string found under this node */
-	GHashTable* subtries;  /* Maps characters to subtries */
+	EnchantTrieNode* nodes;
+	guint32 n_nodes;		/* nodes handed out so far, including released ones */
+	guint32 nodes_size;		/* allocated size of nodes */
+	EnchantTrieIndex free_nodes;	/* head of the list of released nodes */
+
+	char* strings;			/* NUL-terminated original spellings */
+	gsize strings_len;
+	gsize strings_size;
+	gsize strings_garbage;	/* bytes of strings belonging to removed words */
+
+	guint32 n_words;
+
+	GMappedFile* mapped;	/* set while nodes and strings point into a compiled index */
+
+	guint64* bloom;		/* NULL if the trie is too large to have one */
+	guint32 bloom_bits;	/* a power of two */
+};
+
+/*  A compiled index (FILE.idx next to the word list FILE) holds the
+ *  trie of a word list exactly as it is laid out in memory: this header,
+ *  followed by the node array and then the string arena.  The index is
+ *  mapped read-only and used in place, so startup does not depend on the
+ *  size of the list and the pages are shared between processes.  The
+ *  first modification copies the trie into memory of its own.
+ *
+ *  The index records the size, inode and change times of the text file
+ *  it was built from and is ignored once any of them no longer matches;
+ *  the text file is always the authoritative copy.  It also records how
+ *  far complete lines of the text were read, so that lines appended while
+ *  the list is open are read on top of the index as they would be on top
+ *  of the text.  Indexes are written in native byte order and are not
+ *  meant to be portable between machines.
+ *
+ *  Since an index may still be truncated, stale or tampered with, every
+ *  node and string offset is checked when it is loaded, and an index
+ *  that fails the check is ignored in favour of the text.
+ */
+typedef struct str_enchant_pwl_file_stamp EnchantPWLFileStamp;
+struct str_enchant_pwl_file_stamp
+{
+	guint64 size;
+	guint64 inode;
+	gint64 mtime;
+	gint64 mtime_nsec;
+	gint64 ctime;
+	gint64 ctime_nsec;
+};
+
+typedef struct str_enchant_pwl_index_header EnchantPWLIndexHeader;
+struct str_enchant_pwl_index_header
+{
+	char magic[8];
+	guint32 version;
+	guint32 byte_order;
+	EnchantPWLFileStamp source;
+	guint64 source_read;	/* end of the last complete line */
+	guint32 source_lines;	/* number of complete lines */
+	guint32 tail_word;	/* string offset + 1 of the word of an
+				 * unterminated last line, or 0 */
+	guint64 dead_lines;
+	guint32 n_nodes;
+	guint32 n_words;
+	guint64 strings_len;
 };
 
+static const char enchant_pwl_index_magic[8] = "EPWLIDX";
+
 struct str_enchant_pwl
 {
-	EnchantTrie* trie;
+	EnchantTrie trie;
 	char * filename;
-	time_t file_changed;
-	GHashTable *words_in_trie;
+	EnchantPWLFileStamp file_stamp;	/* of the file when it was last looked at */
+	gint64 file_stamp_time;		/* real time in seconds at which file_stamp was taken */
+	gint64 refresh_interval;	/* in microseconds, 0 to check on every use */
+	gint64 last_refresh;		/* monotonic time of the last check */
+
+	/* How much of which file has been read, so that lines appended to
+	 * it later can be read on their own */
+	dev_t file_dev;
+	ino_t file_ino;
+	gint64 read_offset;		/* end of the last complete line, -1 if unknown */
+	size_t read_lines;		/* number of complete lines */
+	char read_signature[ENCHANT_PWL_SIGNATURE_LEN];
+	size_t read_signature_len;
+	char * tail_word;		/* word added from an unterminated last line */
+	size_t dead_lines;		/* lines that no longer add a word */
+
+	EnchantStats * stats;		/* where to count reads and rewrites of the file, or NULL */
 };
 
-/* Special Trie node indicating the end of a string */
-static EnchantTrie n_EOSTrie;
-static EnchantTrie* EOSTrie = &n_EOSTrie;
-
 /* mode for searching trie */
 typedef enum enum_matcher_mode EnchantTrieMatcherMode;
 enum enum_matcher_mode
@@ -115,31 +238,42 @@ enum enum_matcher_mode
 };
 
 /*  The EnchantTrieMatcher structure maintains the state necessary to
- *  search for matching strings within an EnchantTrie.  It includes a
- *  callback function which will be called with each matching string
+ *  search for matching strings within an EnchantTrie.
+ *
+ *  The search walks the trie depth first and carries the dynamic
+ *  programming table of the (restricted Damerau-Levenshtein) edit
+ *  distance down with it: the row for a node at depth i holds the
+ *  distance between the i characters on the path to that node and each
+ *  prefix of the word, and is computed from the rows of its parent and
+ *  grandparent.  Only entries within max_errors of the diagonal are
+ *  computed, and a subtree is skipped as soon as no entry of its row is
+ *  within the limit.  The rows live in one block allocated per search.
+ *
+ *  It includes a callback function which will be called with each matching string
  *  as it is found.  The arguments to this function are:
  *
- *      - a freshly-allocated copy of the matching string, which must
- *        be freed by external code
+ *      - the original spelling of the matching word, which is owned
+ *        by the trie and must be copied if it is to be kept
  *      - the EnchantTrieMatcher object, giving the context of the match
  *        (e.g. number of errors)
  */
 typedef struct str_enchant_trie_matcher EnchantTrieMatcher;
 struct str_enchant_trie_matcher
 {
-	int num_errors;		/* Num errors encountered so far. */
-	int max_errors;		/* Max errors before search should terminate */
+	int num_errors;		/* Num errors of the current match */
+	int max_errors;		/* Max errors of matches still of interest */
+	int band;		/* Max errors when the search started */
+	int n_matches;
 
-	char* word;	/* Word being searched for */
-	ssize_t word_pos;	/* Current position in the word */
+	gunichar* word;	/* Word being searched for */
+	gunichar* word_upper;	/* Upper case word in case insensitive mode, else word */
+	glong word_len;	/* Length of the word in characters */
 
-	char* path;		    /* Path taken through the trie so far */
-	ssize_t path_len;	/* Length of allocated path string */
-	ssize_t path_pos;	/* Current end pos of path string */
+	int* rows;		/* (word_len + band + 1) rows of word_len + 1 entries */
 
 	EnchantTrieMatcherMode mode;
 
-	void (*cbfunc)(char*,EnchantTrieMatcher*); /* callback func */
+	void (*cbfunc)(const char*,EnchantTrieMatcher*); /* callback func */
 	void* cbdata;		/* Private data for use by callback func */
 };
 
@@ -157,27 +291,39 @@ typedef struct str_enchant_sugg_list
  *   Function Prototypes
  */
 
-static void enchant_pwl_add_to_trie(EnchantPWL *pwl,
+static gboolean enchant_pwl_add_to_trie(EnchantPWL *pwl,
+					const char *const word, size_t len);
+static gboolean enchant_pwl_remove_from_trie(EnchantPWL *pwl,
 					const char *const word, size_t len);
 static void enchant_pwl_refresh_from_file(EnchantPWL* pwl);
-static void enchant_pwl_check_cb(char* match,EnchantTrieMatcher* matcher);
-static void enchant_pwl_suggest_cb(char* match,EnchantTrieMatcher* matcher);
-static void enchant_trie_free(EnchantTrie* trie);
-static void enchant_trie_free_cb(void*,void*,void*);
-static EnchantTrie* enchant_trie_insert(EnchantTrie* trie,const char *const word);
-static void enchant_trie_remove(EnchantTrie* trie,const char *const word);
-static void enchant_trie_find_matches(EnchantTrie* trie,EnchantTrieMatcher *matcher);
-static void enchant_trie_find_matches_cb(void* keyV,void* subtrieV,void* matcherV);
+static void enchant_pwl_read_all(EnchantPWL* pwl, FILE* f, const GStatBuf* stats);
+static int enchant_pwl_contains(EnchantPWL *pwl, const char *const word, size_t len);
+static gboolean enchant_pwl_is_appended(EnchantPWL* pwl, FILE* f, const GStatBuf* stats);
+static void enchant_pwl_read_appended(EnchantPWL* pwl, FILE* f, const GStatBuf* stats);
+static void enchant_pwl_refresh_if_due(EnchantPWL* pwl);
+static void enchant_pwl_suggest_cb(const char* match,EnchantTrieMatcher* matcher);
+static void enchant_trie_clear(EnchantTrie* trie);
+static void enchant_pwl_get_file_stamp(const GStatBuf* stats, EnchantPWLFileStamp* stamp);
+static gboolean enchant_pwl_file_stamp_equal(const EnchantPWLFileStamp* a, const EnchantPWLFileStamp* b);
+static void enchant_pwl_set_file_stamp(EnchantPWL* pwl, const GStatBuf* stats);
+static gboolean enchant_pwl_file_is_unchanged(EnchantPWL* pwl, const GStatBuf* stats);
+static gboolean enchant_pwl_load_index(EnchantPWL* pwl, const GStatBuf* stats);
+static void enchant_pwl_write_index(EnchantPWL* pwl, const GStatBuf* stats);
+static gboolean enchant_trie_insert(EnchantTrie* trie,const char *const normalized_word,
+				    const char *const word, size_t len);
+static gboolean enchant_trie_remove(EnchantTrie* trie,const char *const normalized_word);
+static guint32 enchant_trie_lookup(const EnchantTrie* trie,const char *const normalized_word);
+static gboolean enchant_trie_contains(const EnchantTrie* trie,const char *const normalized_word);
+static gboolean enchant_trie_may_contain(const EnchantTrie* trie, const char *const word, size_t len);
+static void enchant_trie_find_matches(const EnchantTrie* trie,EnchantTrieMatcher *matcher);
 static EnchantTrieMatcher* enchant_trie_matcher_init(const char* const word, size_t len,
 				int maxerrs,
 				EnchantTrieMatcherMode mode,
-				void(*cbfunc)(char*,EnchantTrieMatcher*),
+				void(*cbfunc)(const char*,EnchantTrieMatcher*),
 				void* cbdata);
 static void enchant_trie_matcher_free(EnchantTrieMatcher* matcher);
-static void enchant_trie_matcher_pushpath(EnchantTrieMatcher* matcher,char* newchars);
-static void enchant_trie_matcher_poppath(EnchantTrieMatcher* matcher,int num);
 
-static int edit_dist(const char* word1, const char* word2);
+static int edit_dist(const char* word1, const char* word2, int max);
 
 #define enchant_lock_file(f) flock (fileno (f), LOCK_EX)
 #define enchant_unlock_file(f) flock (fileno (f), LOCK_UN)
@@ -192,7 +338,7 @@ EnchantPWL* enchant_pwl_init(void)
 	EnchantPWL *pwl;
 
 	pwl = g_new0(EnchantPWL, 1);
-	pwl->words_in_trie = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	pwl->read_offset = -1;
 
 	return pwl;
 }
@@ -218,7 +364,6 @@ EnchantPWL* enchant_pwl_init_with_file(const char * file)
 	fclose(fd);
 	pwl = enchant_pwl_init();
 	pwl->filename = g_strdup(file);
-	pwl->file_changed = 0;
 
 	enchant_pwl_refresh_from_file(pwl);
 	return pwl;
@@ -226,37 +371,107 @@ EnchantPWL* enchant_pwl_init_with_file(const char * file)
 
 static void enchant_pwl_refresh_from_file(EnchantPWL* pwl)
 {
-	char buffer[BUFSIZ + 1];
-	char* line;
-	size_t line_number = 1;
 	FILE *f;
 	GStatBuf stats;
+	gint64 start;
 
 	if(!pwl->filename)
 		return;
 
+	if(pwl->refresh_interval > 0)
+		pwl->last_refresh = g_get_monotonic_time();
+
 	if(g_stat(pwl->filename, &stats)!=0)
 		return;    /*presumably I won't be able to open the file either*/
 	
-	if(pwl->file_changed == stats.st_mtime)
+	if(enchant_pwl_file_is_unchanged(pwl, &stats))
 		return;  /*nothing changed since last read*/
 
-	enchant_trie_free(pwl->trie);
-	pwl->trie = NULL;
-	g_hash_table_destroy (pwl->words_in_trie);
-	pwl->words_in_trie = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
-
+	start = g_get_monotonic_time();
 	f = g_fopen(pwl->filename, "rb");
-	if (!f) 
-		return;
+	if (f)
+		enchant_lock_file (f);
 
-	pwl->file_changed = stats.st_mtime;
+	/* Lines appended by others are simply added to what is already known */
+	if (f && enchant_pwl_is_appended(pwl, f, &stats))
+		{
+			enchant_pwl_set_file_stamp(pwl, &stats);
+			enchant_pwl_read_appended(pwl, f, &stats);
+			enchant_unlock_file (f);
+			fclose (f);
+			enchant_stats_record(g_atomic_pointer_get(&pwl->stats), ENCHANT_STATS_PWL_REFRESH, start);
+			return;
+		}
 
-	enchant_lock_file (f);
+	enchant_trie_clear(&pwl->trie);
+	pwl->read_offset = 0;
+	pwl->read_lines = 0;
+	pwl->dead_lines = 0;
+	g_free(pwl->tail_word);
+	pwl->tail_word = NULL;
+
+	if(enchant_pwl_load_index(pwl, &stats))
+		{
+			enchant_pwl_set_file_stamp(pwl, &stats);
+			if (f && pwl->read_offset >= 0)
+				enchant_pwl_read_appended(pwl, f, &stats);
+		}
+	else if (f)
+		{
+			enchant_pwl_set_file_stamp(pwl, &stats);
+			enchant_pwl_read_all(pwl, f, &stats);
+		}
+
+	if (f)
+		{
+			enchant_unlock_file (f);
+			fclose (f);
+		}
+
+	enchant_stats_record(g_atomic_pointer_get(&pwl->stats), ENCHANT_STATS_PWL_REFRESH, start);
+}
+
+/* Build the trie from the whole text of the file, and save it as the
+ * compiled index if the list is large */
+static void enchant_pwl_read_all(EnchantPWL* pwl, FILE* f, const GStatBuf* stats)
+{
+	enchant_trie_clear(&pwl->trie);
+	pwl->read_offset = 0;
+	pwl->read_lines = 0;
+	pwl->dead_lines = 0;
+	g_free(pwl->tail_word);
+	pwl->tail_word = NULL;
+
+	enchant_pwl_read_appended(pwl, f, stats);
+
+	if(pwl->trie.n_words >= ENCHANT_PWL_INDEX_MIN_WORDS)
+		{
+			GStatBuf read_stats;
+			EnchantPWLFileStamp stamp, read_stamp;
+
+			/* only if nobody changed the file between g_stat and reading it */
+			enchant_pwl_get_file_stamp(stats, &stamp);
+			if(g_stat(pwl->filename, &read_stats) == 0)
+				{
+					enchant_pwl_get_file_stamp(&read_stats, &read_stamp);
+					if(enchant_pwl_file_stamp_equal(&stamp, &read_stamp))
+						enchant_pwl_write_index(pwl, stats);
+				}
+		}
+}
+
+/* Add the words of the lines from read_offset on, keeping track of how
+ * far complete lines have been read */
+static void enchant_pwl_read_lines(EnchantPWL* pwl, FILE* f)
+{
+	char buffer[BUFSIZ + 1];
+	char* line;
+	size_t line_number;
 	
-	for (;NULL != (fgets (buffer, sizeof (buffer), f));++line_number)
+	for (line_number = pwl->read_lines + 1; NULL != (fgets (buffer, sizeof (buffer), f)); ++line_number)
 		{
 			const gunichar BOM = 0xfeff;
+			gboolean complete = TRUE;
 			size_t l;
 
 			line = buffer;
@@ -271,199 +486,595 @@ static void enchant_pwl_refresh_from_file(EnchantPWL* pwl)
 					g_warning ("Line too long (ignored) in %s at line:%zu\n", pwl->filename, line_number);
 					while (NULL != (fgets (buffer, sizeof (buffer), f)))
 						{
-							if (line[strlen(buffer)-1]=='\n') 
-								break;
+							if (buffer[strlen(buffer)-1]=='\n') 
+								{
+									pwl->read_offset = ftell(f);
+									pwl->read_lines = line_number;
+									break;
+								}
 						}
 					continue;
 				}
+			else
+				complete = FALSE;
 						
 			if( line[0] && line[0] != '#')
 				{
-					if(g_utf8_validate(line, -1, NULL))
-						enchant_pwl_add_to_trie(pwl, line, strlen(line));
-					else
+					if(!g_utf8_validate(line, -1, NULL))
 						g_warning ("Bad UTF-8 sequence in %s at line:%zu\n", pwl->filename, line_number);
+					else if(enchant_pwl_add_to_trie(pwl, line, strlen(line)))
+						{
+							if(!complete)
+								pwl->tail_word = g_strdup(line);
+						}
+					else if(complete)
+						pwl->dead_lines++;
+				}
+			else if(complete && g_str_has_prefix(line, ENCHANT_PWL_REMOVED_PREFIX))
+				{
+					/* the removal and the line that added the word are both dead now */
+					line += strlen(ENCHANT_PWL_REMOVED_PREFIX);
+					pwl->dead_lines++;
+					if(g_utf8_validate(line, -1, NULL) &&
+					   enchant_pwl_remove_from_trie(pwl, line, strlen(line)))
+						pwl->dead_lines++;
+				}
+
+			if (complete)
+				{
+					pwl->read_offset = ftell(f);
+					pwl->read_lines = line_number;
 				}
 		}
-	
-	enchant_unlock_file (f);
-	fclose (f);
+}
+
+/* Whether the file is the one read before, with at most lines appended to
+ * what was read of it */
+static gboolean enchant_pwl_is_appended(EnchantPWL* pwl, FILE* f, const GStatBuf* stats)
+{
+	char signature[ENCHANT_PWL_SIGNATURE_LEN];
+	size_t len = pwl->read_signature_len;
+
+	if(pwl->read_offset < 0 || stats->st_dev != pwl->file_dev || stats->st_ino != pwl->file_ino ||
+	   stats->st_size < pwl->read_offset)
+		return FALSE;
+
+	return fseek(f, pwl->read_offset - len, SEEK_SET) == 0 &&
+		fread(signature, 1, len, f) == len &&
+		memcmp(signature, pwl->read_signature, len) == 0;
+}
+
+/* Read the file from read_offset on, and remember where it ends */
+static void enchant_pwl_read_appended(EnchantPWL* pwl, FILE* f, const GStatBuf* stats)
+{
+	/* An unterminated last line may have been completed since */
+	if(pwl->tail_word)
+		{
+			enchant_pwl_remove_from_trie(pwl, pwl->tail_word, strlen(pwl->tail_word));
+			g_free(pwl->tail_word);
+			pwl->tail_word = NULL;
+		}
+
+	if(fseek(f, pwl->read_offset, SEEK_SET) == 0)
+		enchant_pwl_read_lines(pwl, f);
+
+	pwl->file_dev = stats->st_dev;
+	pwl->file_ino = stats->st_ino;
+	pwl->read_signature_len = MIN(pwl->read_offset, ENCHANT_PWL_SIGNATURE_LEN);
+	if(fseek(f, pwl->read_offset - pwl->read_signature_len, SEEK_SET) != 0 ||
+	   fread(pwl->read_signature, 1, pwl->read_signature_len, f) != pwl->read_signature_len)
+		pwl->read_offset = -1;
+}
+
+/* Look for changes made to the file by others, unless it was already
+ * looked at less than refresh_interval ago */
+static void enchant_pwl_refresh_if_due(EnchantPWL* pwl)
+{
+	if(pwl->refresh_interval > 0 &&
+	   g_get_monotonic_time() - pwl->last_refresh < pwl->refresh_interval)
+		return;
+
+	enchant_pwl_refresh_from_file(pwl);
+}
+
+void enchant_pwl_set_refresh_interval(EnchantPWL *pwl, int msecs)
+{
+	g_return_if_fail (pwl);
+	g_return_if_fail (msecs >= 0);
+
+	pwl->refresh_interval = (gint64)msecs * 1000;
+	pwl->last_refresh = 0;
+}
+
+void enchant_pwl_set_stats(EnchantPWL *pwl, EnchantStats *stats)
+{
+	g_return_if_fail (pwl);
+
+	g_atomic_pointer_set(&pwl->stats, stats);
+}
+
+/* Check that the nodes reachable from the root form a tree whose child,
+ * sibling and word references all stay within the index, so that no walk
+ * of a loaded trie can leave it or loop */
+static gboolean enchant_pwl_index_is_valid(const EnchantTrieNode* nodes, guint32 n_nodes,
+					   const char* strings, gsize strings_len, guint32 n_words)
+{
+	guint8* referenced;
+	guint32 i, words = 0;
+	gsize start, end;
+	gboolean valid = TRUE;
+
+	if(strings_len == 0 || strings[strings_len - 1] != '\0')
+		return FALSE;
+
+	/* Every node but the root must be referenced at most once, so the
+	 * nodes reachable from the root form a tree and walks terminate. */
+	referenced = g_new0(guint8, n_nodes / 8 + 1);
+	for(i = 0; valid && i < n_nodes; i++)
+		{
+			EnchantTrieIndex child = nodes[i].first_child;
+			EnchantTrieIndex sibling = nodes[i].next_sibling;
+			guint32 word = nodes[i].word;
+
+			if(child != 0)
+				{
+					valid = child < n_nodes && !(referenced[child / 8] & (1 << (child % 8)));
+					if(valid)
+						referenced[child / 8] |= 1 << (child % 8);
+				}
+			if(valid && sibling != 0)
+				{
+					valid = sibling < n_nodes && !(referenced[sibling / 8] & (1 << (sibling % 8))) &&
+						nodes[sibling].ch > nodes[i].ch;
+					if(valid)
+						referenced[sibling / 8] |= 1 << (sibling % 8);
+				}
+			if(valid && word != 0)
+				{
+					valid = word - 1 < strings_len && (word == 1 || strings[word - 2] == '\0');
+					words++;
+				}
+		}
+	g_free(referenced);
+
+	for(start = 0; valid && start < strings_len; start = end + 1)
+		{
+			end = start + strlen(strings + start);
+			valid = g_utf8_validate(strings + start, end - start, NULL);
+		}
+
+	return valid && words == n_words;
+}
+
+/* The stamp of the file @stats describes; any change to the file, or
+ * another file renamed over it, gives a different one */
+static void enchant_pwl_get_file_stamp(const GStatBuf* stats, EnchantPWLFileStamp* stamp)
+{
+	memset(stamp, 0, sizeof(*stamp));
+	stamp->size = stats->st_size;
+	stamp->inode = stats->st_ino;
+	stamp->mtime = stats->st_mtime;
+	stamp->ctime = stats->st_ctime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+	stamp->mtime_nsec = stats->st_mtim.tv_nsec;
+	stamp->ctime_nsec = stats->st_ctim.tv_nsec;
+#endif
+}
+
+static gboolean enchant_pwl_file_stamp_equal(const EnchantPWLFileStamp* a, const EnchantPWLFileStamp* b)
+{
+	return a->size == b->size && a->inode == b->inode &&
+	       a->mtime == b->mtime && a->mtime_nsec == b->mtime_nsec &&
+	       a->ctime == b->ctime && a->ctime_nsec == b->ctime_nsec;
+}
+
+/* Remember the stamp of the file as it is about to be read */
+static void enchant_pwl_set_file_stamp(EnchantPWL* pwl, const GStatBuf* stats)
+{
+	enchant_pwl_get_file_stamp(stats, &pwl->file_stamp);
+	pwl->file_stamp_time = g_get_real_time() / G_USEC_PER_SEC;
+}
+
+/* Whether the file is as it was when it was last looked at.  A stamp
+ * taken in the second the file last changed may not tell a change made
+ * right after it, if the file system gave that the same times and the
+ * size stayed the same, so then the end of what was read is compared
+ * as well. */
+static gboolean enchant_pwl_file_is_unchanged(EnchantPWL* pwl, const GStatBuf* stats)
+{
+	EnchantPWLFileStamp stamp;
+	gboolean unchanged;
+	FILE* f;
+
+	enchant_pwl_get_file_stamp(stats, &stamp);
+	if(!enchant_pwl_file_stamp_equal(&stamp, &pwl->file_stamp))
+		return FALSE;
+
+	if(pwl->file_stamp_time > MAX(stamp.mtime, stamp.ctime))
+		return TRUE;
+
+	f = g_fopen(pwl->filename, "rb");
+	if(f == NULL)
+		return FALSE;
+	unchanged = enchant_pwl_is_appended(pwl, f, stats);
+	fclose(f);
+
+	if(unchanged)
+		pwl->file_stamp_time = g_get_real_time() / G_USEC_PER_SEC;
+	return unchanged;
+}
+
+/* Use the compiled index of the word list if it is up to date */
+static gboolean enchant_pwl_load_index(EnchantPWL* pwl, const GStatBuf* stats)
+{
+	char* index_filename;
+	GMappedFile* mapped;
+	const EnchantPWLIndexHeader* header;
+	const char* contents;
+	gsize length, nodes_len;
+	EnchantPWLFileStamp source;
+
+	enchant_pwl_get_file_stamp(stats, &source);
+
+	index_filename = g_strconcat(pwl->filename, ENCHANT_PWL_INDEX_SUFFIX, NULL);
+	mapped = g_mapped_file_new(index_filename, FALSE, NULL);
+	g_free(index_filename);
+	if(mapped == NULL)
+		return FALSE;
+
+	contents = g_mapped_file_get_contents(mapped);
+	length = g_mapped_file_get_length(mapped);
+	header = (const EnchantPWLIndexHeader*) contents;
+
+	if(length < sizeof(EnchantPWLIndexHeader) ||
+	   memcmp(header->magic, enchant_pwl_index_magic, sizeof(header->magic)) != 0 ||
+	   header->version != ENCHANT_PWL_INDEX_VERSION ||
+	   header->byte_order != ENCHANT_PWL_INDEX_BYTE_ORDER ||
+	   !enchant_pwl_file_stamp_equal(&header->source, &source) ||
+	   header->n_nodes == 0 ||
+	   header->n_nodes > (length - sizeof(EnchantPWLIndexHeader)) / sizeof(EnchantTrieNode))
+		{
+			g_mapped_file_unref(mapped);
+			return FALSE;
+		}
+
+	nodes_len = header->n_nodes * sizeof(EnchantTrieNode);
+	if(header->strings_len != length - sizeof(EnchantPWLIndexHeader) - nodes_len ||
+	   !enchant_pwl_index_is_valid((const EnchantTrieNode*)(contents + sizeof(EnchantPWLIndexHeader)),
+				       header->n_nodes,
+				       contents + sizeof(EnchantPWLIndexHeader) + nodes_len,
+				       header->strings_len, header->n_words))
+		{
+			g_mapped_file_unref(mapped);
+			return FALSE;
+		}
+
+	/* The mapping is read-only; the trie is copied before any change. */
+	pwl->trie.mapped = mapped;
+	pwl->trie.nodes = (EnchantTrieNode*)(contents + sizeof(EnchantPWLIndexHeader));
+	pwl->trie.n_nodes = pwl->trie.nodes_size = header->n_nodes;
+	pwl->trie.free_nodes = 0;
+	pwl->trie.strings = (char*)(contents + sizeof(EnchantPWLIndexHeader) + nodes_len);
+	pwl->trie.strings_len = pwl->trie.strings_size = header->strings_len;
+	pwl->trie.strings_garbage = 0;
+	pwl->trie.n_words = header->n_words;
+
+	/* Lines appended to the file later are read as they would have been
+	 * after reading the text */
+	if(header->source_read <= header->source.size)
+		{
+			pwl->read_offset = header->source_read;
+			pwl->read_lines = header->source_lines;
+		}
+	else
+		pwl->read_offset = -1;
+
+	pwl->dead_lines = header->dead_lines;
+
+	if(header->tail_word != 0 && header->tail_word <= header->strings_len &&
+	   (header->tail_word == 1 || pwl->trie.strings[header->tail_word - 2] == '\0'))
+		pwl->tail_word = g_strdup(pwl->trie.strings + header->tail_word - 1);
+
+	return TRUE;
+}
+
+/* Save the trie of a freshly read word list as its compiled index.
+ * The index is written to a temporary file and renamed into place, so
+ * readers never see a partial one.  Failure is not an error: the word
+ * list is simply read from text again next time. */
+static void enchant_pwl_write_index(EnchantPWL* pwl, const GStatBuf* stats)
+{
+	EnchantPWLIndexHeader header;
+	char* index_filename, * tmp_filename;
+	gboolean written = FALSE;
+	FILE* f;
+	int fd;
+
+	/* a freshly read trie has neither released nodes nor dead strings */
+	g_return_if_fail(pwl->trie.free_nodes == 0 && pwl->trie.strings_garbage == 0);
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, enchant_pwl_index_magic, sizeof(header.magic));
+	header.version = ENCHANT_PWL_INDEX_VERSION;
+	header.byte_order = ENCHANT_PWL_INDEX_BYTE_ORDER;
+	enchant_pwl_get_file_stamp(stats, &header.source);
+	header.source_read = pwl->read_offset;
+	header.source_lines = pwl->read_lines;
+	header.dead_lines = pwl->dead_lines;
+	if(pwl->tail_word)
+		{
+			char* normalized_word = g_utf8_normalize(pwl->tail_word, -1, G_NORMALIZE_NFD);
+			header.tail_word = enchant_trie_lookup(&pwl->trie, normalized_word);
+			g_free(normalized_word);
+		}
+	header.n_nodes = pwl->trie.n_nodes;
+	header.n_words = pwl->trie.n_words;
+	header.strings_len = pwl->trie.strings_len;
+
+	index_filename = g_strconcat(pwl->filename, ENCHANT_PWL_INDEX_SUFFIX, NULL);
+	tmp_filename = g_strconcat(index_filename, ".XXXXXX", NULL);
+
+	fd = g_mkstemp_full(tmp_filename, O_WRONLY | O_BINARY, 0666);
+	if(fd != -1)
+		{
+			f = fdopen(fd, "wb");
+			if(f == NULL)
+				close(fd);
+			else
+				{
+					written = fwrite(&header, sizeof(header), 1, f) == 1 &&
+						fwrite(pwl->trie.nodes, sizeof(EnchantTrieNode), pwl->trie.n_nodes, f) == pwl->trie.n_nodes &&
+						fwrite(pwl->trie.strings, 1, pwl->trie.strings_len, f) == pwl->trie.strings_len;
+					written = (fclose(f) == 0) && written;
+				}
+
+			if(!written || g_rename(tmp_filename, index_filename) != 0)
+				g_remove(tmp_filename);
+		}
+
+	g_free(tmp_filename);
+	g_free(index_filename);
 }
 
 void enchant_pwl_free(EnchantPWL *pwl)
 {
-	enchant_trie_free(pwl->trie);
+	enchant_trie_clear(&pwl->trie);
 	g_free(pwl->filename);
-	g_hash_table_destroy (pwl->words_in_trie);
+	g_free(pwl->tail_word);
 	g_free(pwl);
 }
 
-static void enchant_pwl_add_to_trie(EnchantPWL *pwl,
+static gboolean enchant_pwl_add_to_trie(EnchantPWL *pwl,
 					const char *const word, size_t len)
 {
 	char * normalized_word;
+	gboolean added;
 
 	normalized_word = g_utf8_normalize (word, len, G_NORMALIZE_NFD);
-	if(NULL != g_hash_table_lookup (pwl->words_in_trie, normalized_word)) {
-		g_free (normalized_word);
-		return;
-	}
-	
-	g_hash_table_insert (pwl->words_in_trie, normalized_word, g_strndup(word,len));
+	added = enchant_trie_insert(&pwl->trie, normalized_word, word, len);
+	g_free (normalized_word);
 
-	pwl->trie = enchant_trie_insert(pwl->trie, normalized_word);
+	return added;
 }
 
-static void enchant_pwl_remove_from_trie(EnchantPWL *pwl,
+static gboolean enchant_pwl_remove_from_trie(EnchantPWL *pwl,
 					const char *const word, size_t len)
 {
 	char * normalized_word = g_utf8_normalize (word, len, G_NORMALIZE_NFD);
+	gboolean removed;
 
-	if( g_hash_table_remove (pwl->words_in_trie, normalized_word) )
-		{
-			enchant_trie_remove(pwl->trie, normalized_word);
-			if(pwl->trie && pwl->trie->subtries == NULL && pwl->trie->value == NULL) {
-				enchant_trie_free (pwl->trie);
-				pwl->trie = NULL; /* make trie empty if has no content */
-			}
-		}
-	
+	removed = enchant_trie_remove(&pwl->trie, normalized_word);
 	g_free(normalized_word);
+
+	return removed;
 }
 
-void enchant_pwl_add(EnchantPWL *pwl,
-			 const char *const word, size_t len)
+/* Append a line to the word list, after ending its last line if it is
+ * unterminated. */
+static void enchant_pwl_append_line(FILE *f, const char *const prefix,
+				    const char *const word, size_t len)
 {
-	enchant_pwl_refresh_from_file(pwl);
+	int c = EOF;
 
-	enchant_pwl_add_to_trie(pwl, word, len);
+	if (fseek (f, -1, SEEK_END) == 0)
+		c = getc (f);
+	/* ISO C requires positioning between read and write. */
+	if (fseek (f, 0L, SEEK_END) != 0)
+		return;
 
-	if (pwl->filename != NULL)
-	{
-		FILE *f;
-		
-		f = g_fopen(pwl->filename, "a+b");
-		if (f)
-			{
-				GStatBuf stats;
-
-				/* Since this function does not signal I/O
-				   errors, only use return values to avoid
-				   doing things that seem futile. */
-
-				enchant_lock_file (f);
-				if(g_stat(pwl->filename, &stats)==0)
-					pwl->file_changed = stats.st_mtime;
-
-				/* Add a newline if the file doesn't end with one. */
-				if (fseek (f, -1, SEEK_END) == 0)
-					{
-						int c = getc (f);
-						fseek (f, 0L, SEEK_CUR); /* ISO C requires positioning between read and write. */
-						if (c != '\n')
-							putc ('\n', f);
-					}
-
-				if (fwrite (word, sizeof(char), len, f) == len)
-					{
-						putc ('\n', f);
-					}
-				enchant_unlock_file (f);
-				fclose (f);
-			}	
-	}
+	/* Add a newline if the file doesn't end with one. */
+	if (c != EOF && c != '\n')
+		putc ('\n', f);
+
+	fputs (prefix, f);
+	if (fwrite (word, sizeof(char), len, f) == len)
+		{
+			putc ('\n', f);
+		}
 }
 
-void enchant_pwl_remove(EnchantPWL *pwl,
-			 const char *const word, size_t len)
+/* Rewrite the word list without the lines that no longer add a word:
+ * removed words, the lines recording their removal and repeated words.
+ * Comments, and lines that are skipped when reading, are kept as they
+ * are.  f must be locked and open for update. */
+static void enchant_pwl_compact(EnchantPWL *pwl, FILE *f)
 {
-	if(enchant_pwl_check(pwl, word, len) == 1)
+	const gunichar BOM = 0xfeff;
+	char *contents, *line, *next, *end;
+	gsize length;
+	GPtrArray *lines;
+	GHashTable *words;
+	GStatBuf stats;
+	guint i;
+	gint64 start = g_get_monotonic_time();
+
+	if(!g_file_get_contents(pwl->filename, &contents, &length, NULL))
 		return;
 
-	enchant_pwl_refresh_from_file(pwl);
+	lines = g_ptr_array_new();
+	words = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
-	enchant_pwl_remove_from_trie(pwl, word, len);
-
-	if (pwl->filename)
+	for(line = contents; line < contents + length; line = next)
 		{
-			char * contents;
-			size_t length;
-
-			FILE *f;
+			char *text = line, *normalized_word;
+			gpointer added_by;
 
-			if(!g_file_get_contents(pwl->filename, &contents, &length, NULL))
-				return;
+			end = memchr(line, '\n', contents + length - line);
+			next = end ? end + 1 : contents + length;
+			if(end)
+				*end = '\0';
 
-			f = g_fopen(pwl->filename, "wb"); /*binary because g_file_get_contents reads binary*/
-			if (f)
-				{
-					const gunichar BOM = 0xfeff;
-					char * filestart, *searchstart, *needle;
-					char * key;
-					GStatBuf stats;
+			if(line == contents && BOM == g_utf8_get_char(line))
+				text = g_utf8_next_char(line);
 
-					enchant_lock_file (f);
-					key = g_strndup(word, len);
+			if(*text == '\0' && text == line)
+				continue;
 
-					if(BOM == g_utf8_get_char(contents))
+			if(strlen(line) >= BUFSIZ || !g_utf8_validate(text, -1, NULL))
+				;
+			else if(g_str_has_prefix(text, ENCHANT_PWL_REMOVED_PREFIX))
+				{
+					normalized_word = g_utf8_normalize(text + strlen(ENCHANT_PWL_REMOVED_PREFIX), -1, G_NORMALIZE_NFD);
+					if(g_hash_table_lookup_extended(words, normalized_word, NULL, &added_by))
 						{
-							filestart = g_utf8_next_char(contents);
-							fwrite (contents, sizeof(char), filestart-contents, f);
+							g_ptr_array_index(lines, GPOINTER_TO_UINT(added_by)) = NULL;
+							g_hash_table_remove(words, normalized_word);
 						}
-					else
-						filestart = contents;
-
-					searchstart = filestart;
-					for(;;)
+					g_free(normalized_word);
+					continue;
+				}
+			else if(*text != '#' && *text != '\0')
+				{
+					normalized_word = g_utf8_normalize(text, -1, G_NORMALIZE_NFD);
+					if(g_hash_table_lookup_extended(words, normalized_word, NULL, NULL))
 						{
-							/*find word*/
-							needle = strstr(searchstart, key);
-							if(needle == NULL)
-								{
-									fwrite (searchstart, sizeof(char), length - (searchstart - contents), f);
-									break;
-								}
-							else 
-								{
-									char* foundend = needle+len;
-									if((needle == filestart || contents[needle-contents-1] == '\n' || contents[needle-contents-1] == '\r') &&
-										(foundend == contents + length || *foundend == '\n' || *foundend == '\r'))
-										{
-											fwrite (searchstart, sizeof(char), needle - searchstart, f);
-											searchstart = foundend;
-											while (*searchstart == '\n' || *searchstart == '\r')
-												++searchstart;
-										}
-									else {
-										fwrite (searchstart, sizeof(char), needle - searchstart+1, f);
-										searchstart = needle+1;
-									}
-								}
+							g_free(normalized_word);
+							continue;
 						}
-					g_free(key);
-					
-					if(g_stat(pwl->filename, &stats)==0)
-						pwl->file_changed = stats.st_mtime;
+					g_hash_table_insert(words, normalized_word, GUINT_TO_POINTER(lines->len));
+				}
+
+			g_ptr_array_add(lines, line);
+		}
 
-					enchant_unlock_file (f);
+	rewind(f);
+	for(i = 0; i < lines->len; i++)
+		{
+			line = g_ptr_array_index(lines, i);
+			if(line != NULL)
+				{
+					fputs(line, f);
+					putc('\n', f);
+				}
+		}
 
-					fclose (f);
-				}	
-			g_free(contents);
+	if(fflush(f) == 0 && ftruncate(fileno(f), ftell(f)) == 0 &&
+	   g_stat(pwl->filename, &stats) == 0)
+		{
+			enchant_pwl_set_file_stamp(pwl, &stats);
+			enchant_pwl_read_all(pwl, f, &stats);
 		}
+	else
+		pwl->read_offset = -1;
+
+	g_hash_table_destroy(words);
+	g_ptr_array_free(lines, TRUE);
+	g_free(contents);
+
+	enchant_stats_record(g_atomic_pointer_get(&pwl->stats), ENCHANT_STATS_PWL_REWRITE, start);
+}
+
+/* Append a line to the word list and read it back.  Adding and removing
+ * words only ever appends to the file, so that it costs the same however
+ * long the list is. */
+static void enchant_pwl_append_to_file(EnchantPWL *pwl, const char *const prefix,
+				       const char *const word, size_t len)
+{
+	FILE *f;
+	GStatBuf stats;
+	gboolean appended = FALSE;
+
+	/* Since this function does not signal I/O
+	   errors, only use return values to avoid
+	   doing things that seem futile. */
+
+	f = g_fopen(pwl->filename, "r+b");
+	if (!f && (f = g_fopen(pwl->filename, "a+b")) != NULL)
+		{
+			/* recreate a deleted file, but write to it in update mode */
+			fclose (f);
+			f = g_fopen(pwl->filename, "r+b");
+		}
+	if (!f)
+		return;
+
+	enchant_lock_file (f);
+	if(g_stat(pwl->filename, &stats)==0)
+		{
+			enchant_pwl_set_file_stamp(pwl, &stats);
+
+			/* Catch up with lines appended since the last look,
+			   so the line written below is all that is left */
+			appended = enchant_pwl_is_appended(pwl, f, &stats);
+			if (appended)
+				enchant_pwl_read_appended(pwl, f, &stats);
+		}
+
+	enchant_pwl_append_line(f, prefix, word, len);
+
+	if (appended && fflush (f) == 0 && g_stat(pwl->filename, &stats) == 0)
+		{
+			enchant_pwl_set_file_stamp(pwl, &stats);
+			enchant_pwl_read_appended(pwl, f, &stats);
+
+			/* Keep the file from growing without bound */
+			if (pwl->dead_lines > 0 && pwl->dead_lines >= pwl->trie.n_words)
+				enchant_pwl_compact(pwl, f);
+		}
+	else
+		pwl->read_offset = -1;
+
+	enchant_unlock_file (f);
+	fclose (f);
+}
+
+void enchant_pwl_add(EnchantPWL *pwl,
+			 const char *const word, size_t len)
+{
+	enchant_pwl_refresh_from_file(pwl);
+
+	if (pwl->filename != NULL)
+		enchant_pwl_append_to_file(pwl, "", word, len);
+
+	/* reading the line back normally added it already */
+	enchant_pwl_add_to_trie(pwl, word, len);
+}
+
+void enchant_pwl_remove(EnchantPWL *pwl,
+			 const char *const word, size_t len)
+{
+	enchant_pwl_refresh_from_file(pwl);
+
+	if(!enchant_pwl_contains(pwl, word, len))
+		return;
+
+	if (pwl->filename != NULL)
+		enchant_pwl_append_to_file(pwl, ENCHANT_PWL_REMOVED_PREFIX, word, len);
+
+	/* reading the line back normally removed it already */
+	enchant_pwl_remove_from_trie(pwl, word, len);
 }
 
 static int enchant_pwl_contains(EnchantPWL *pwl, const char *const word, size_t len)
 {
-	EnchantTrieMatcher* matcher;
-	int count = 0;
-	
-	matcher = enchant_trie_matcher_init(word,len,0,case_sensitive,enchant_pwl_check_cb,
-						&count);
-	enchant_trie_find_matches(pwl->trie,matcher);
-	enchant_trie_matcher_free(matcher);
+	char * normalized_word;
+	gboolean found;
 
-	return (count == 0 ? 0 : 1);
+	normalized_word = g_utf8_normalize (word, len, G_NORMALIZE_NFD);
+	found = enchant_trie_contains(&pwl->trie, normalized_word);
+	g_free(normalized_word);
+
+	return (found ? 1 : 0);
 }
 
 static int enchant_is_all_caps(const char*const word, size_t len)
@@ -574,12 +1185,52 @@ static gchar* enchant_utf8_strtitle(const gchar*str, gssize len)
 	return result;
 }
 
+int enchant_pwl_refresh_is_due(EnchantPWL *pwl)
+{
+	GStatBuf stats;
+
+	g_return_val_if_fail (pwl, 0);
+
+	if(!pwl->filename)
+		return 0;
+
+	if(pwl->refresh_interval > 0)
+		{
+			gint64 now = g_get_monotonic_time();
+
+			if(now - pwl->last_refresh < pwl->refresh_interval)
+				return 0;
+			pwl->last_refresh = now;
+		}
+
+	if(g_stat(pwl->filename, &stats)!=0)
+		return 0;
+
+	return !enchant_pwl_file_is_unchanged(pwl, &stats);
+}
+
+void enchant_pwl_refresh(EnchantPWL *pwl)
+{
+	g_return_if_fail (pwl);
+
+	enchant_pwl_refresh_from_file(pwl);
+}
+
 int enchant_pwl_check(EnchantPWL *pwl, const char *const word, size_t len)
+{
+	enchant_pwl_refresh_if_due(pwl);
+
+	return enchant_pwl_check_loaded(pwl, word, len);
+}
+
+int enchant_pwl_check_loaded(EnchantPWL *pwl, const char *const word, size_t len)
 {
 	int exists = 0;
 	int isAllCaps = 0;
 
-	enchant_pwl_refresh_from_file(pwl);
+	/* neither the word nor any of its case variants */
+	if(!enchant_trie_may_contain(&pwl->trie, word, len))
+		return 1;
 
 	exists = enchant_pwl_contains(pwl, word, len);
 	
@@ -607,16 +1258,8 @@ int enchant_pwl_check(EnchantPWL *pwl, const char *const word, size_t len)
 	return 1; /* not found */
 }
 
-/* matcher callback when a match is found*/
-static void enchant_pwl_check_cb(char* match,EnchantTrieMatcher* matcher)
-{
-	g_free(match);
-	(*((int*)(matcher->cbdata)))++;
-}
-
-static void enchant_pwl_case_and_denormalize_suggestions(EnchantPWL *pwl, 
-							 const char *const word, size_t len, 
-							 EnchantSuggList* suggs_list)
+static void enchant_pwl_case_suggestions(const char *const word, size_t len,
+					 EnchantSuggList* suggs_list)
 {
 	size_t i;
 	gchar* (*utf8_case_convert_function)(const gchar*str, gssize len);
@@ -626,7 +1269,7 @@ static void enchant_pwl_case_and_denormalize_suggestions(EnchantPWL *pwl,
 	else if (enchant_is_all_caps(word, len))
 		utf8_case_convert_function = g_utf8_strup;
 	else
-		utf8_case_convert_function = NULL;
+		return;
 	
 	for(i = 0; i < suggs_list->n_suggs; ++i)
 		{
@@ -634,19 +1277,13 @@ static void enchant_pwl_case_and_denormalize_suggestions(EnchantPWL *pwl,
 			gchar* suggestion;
 			size_t suggestion_len;
 
-			suggestion = g_hash_table_lookup (pwl->words_in_trie, suggs_list->suggs[i]);
+			suggestion = suggs_list->suggs[i];
 			suggestion_len = strlen(suggestion);
 
-			if(utf8_case_convert_function &&
-					!enchant_is_all_caps(suggestion, suggestion_len))
-				{
-					 cased_suggestion = utf8_case_convert_function(suggestion, suggestion_len);
-				}
-			else
-				{
-					 cased_suggestion = g_strndup(suggestion, suggestion_len);
-				}
-			
+			if(enchant_is_all_caps(suggestion, suggestion_len))
+				continue;
+
+			cased_suggestion = utf8_case_convert_function(suggestion, suggestion_len);
 			g_free(suggs_list->suggs[i]);
 			suggs_list->suggs[i] = cased_suggestion;
 		}
@@ -670,7 +1307,7 @@ static int best_distance(char** suggs, const char *const word, size_t len)
 
 					normalized_sugg = g_utf8_normalize (*sugg_it, -1, G_NORMALIZE_NFD);
 
-					dist = edit_dist(normalized_word, normalized_sugg);
+					dist = edit_dist(normalized_word, normalized_sugg, best_dist - 1);
 					g_free(normalized_sugg);
 					if (dist < best_dist)
 						best_dist = dist;
@@ -685,6 +1322,14 @@ static int best_distance(char** suggs, const char *const word, size_t len)
  * given suggs (if suggs == NULL just best from pwl) */
 char** enchant_pwl_suggest(EnchantPWL *pwl, const char *const word,
 			   size_t len, char** suggs, size_t* out_n_suggs)
+{
+	enchant_pwl_refresh_if_due(pwl);
+
+	return enchant_pwl_suggest_loaded(pwl, word, len, suggs, out_n_suggs);
+}
+
+char** enchant_pwl_suggest_loaded(EnchantPWL *pwl, const char *const word,
+				  size_t len, char** suggs, size_t* out_n_suggs)
 {
 	EnchantTrieMatcher* matcher;
 	EnchantSuggList sugg_list;
@@ -694,8 +1339,6 @@ char** enchant_pwl_suggest(EnchantPWL *pwl, const char *const word,
 	if(max_dist > ENCHANT_PWL_MAX_ERRORS)
 		max_dist = ENCHANT_PWL_MAX_ERRORS;
 
-	enchant_pwl_refresh_from_file(pwl);
-
 	sugg_list.suggs = g_new0(char*,ENCHANT_PWL_MAX_SUGGS+1);
 	sugg_list.sugg_errs = g_new0(int,ENCHANT_PWL_MAX_SUGGS);
 	sugg_list.n_suggs = 0;
@@ -704,20 +1347,20 @@ char** enchant_pwl_suggest(EnchantPWL *pwl, const char *const word,
 						case_insensitive,
 						enchant_pwl_suggest_cb,
 						&sugg_list);
-	enchant_trie_find_matches(pwl->trie,matcher);
+	enchant_trie_find_matches(&pwl->trie,matcher);
 	enchant_trie_matcher_free(matcher);
 
 	g_free(sugg_list.sugg_errs);
 	sugg_list.suggs[sugg_list.n_suggs] = NULL;
 	(*out_n_suggs) = sugg_list.n_suggs;
 
-	enchant_pwl_case_and_denormalize_suggestions(pwl, word, len, &sugg_list);
+	enchant_pwl_case_suggestions(word, len, &sugg_list);
 	
 	return sugg_list.suggs;
 }
 
 /* matcher callback when a match is found*/
-static void enchant_pwl_suggest_cb(char* match,EnchantTrieMatcher* matcher)
+static void enchant_pwl_suggest_cb(const char* match,EnchantTrieMatcher* matcher)
 {
 	EnchantSuggList* sugg_list;
 	size_t loc, i;
@@ -739,13 +1382,11 @@ static void enchant_pwl_suggest_cb(char* match,EnchantTrieMatcher* matcher)
 		}
 		/* Already in the list with better score, just return */
 		if(strcmp(match,sugg_list->suggs[loc])==0) {
-			g_free(match);
 			return;
 		}
 	}
 	/* If it's not going to fit, just throw it away */
 	if(loc >= ENCHANT_PWL_MAX_SUGGS) {
-		g_free(match);
 		return;
 	}
 
@@ -757,308 +1398,488 @@ static void enchant_pwl_suggest_cb(char* match,EnchantTrieMatcher* matcher)
 		changes--;
 	}
 
-	sugg_list->suggs[loc] = match;
+	sugg_list->suggs[loc] = g_strdup(match);
 	sugg_list->sugg_errs[loc] = matcher->num_errors;
 	sugg_list->n_suggs = sugg_list->n_suggs + changes;
 
 }
 
-static void enchant_trie_free(EnchantTrie* trie)
+static void enchant_trie_clear(EnchantTrie* trie)
 {
-	/* Don't try to free NULL or the EOSTrie pointer */
-	if(trie == NULL || trie == EOSTrie) {
-		return;
+	if (trie->mapped != NULL)
+		g_mapped_file_unref(trie->mapped);
+	else {
+		g_free(trie->nodes);
+		g_free(trie->strings);
 	}
+	g_free(trie->bloom);
+	memset(trie, 0, sizeof(EnchantTrie));
+}
 
-	/* Because we have not set a destroy function for the hashtable
-	 * (to make code cleaner below), we need to explicitly free all
-	 * subtries with a callback function.
-	 */
-	if (trie->subtries != NULL) {
-		g_hash_table_foreach(trie->subtries,enchant_trie_free_cb,NULL);
-		g_hash_table_destroy(trie->subtries);
-	}
+static guint64 enchant_trie_bloom_hash(const char *const word, size_t len)
+{
+	guint64 hash = G_GUINT64_CONSTANT(14695981039346656037); /* FNV-1a */
+	const char* it;
+
+	for (it = word; it < word + len; it = g_utf8_next_char(it))
+		{
+			gunichar decomposition[G_UNICHAR_MAX_DECOMPOSITION_LENGTH];
+			gsize i, n;
+
+			if ((guchar)*it < 0x80)
+				{
+					decomposition[0] = *it;
+					n = 1;
+				}
+			else
+				n = g_unichar_fully_decompose(g_utf8_get_char(it), FALSE,
+							      decomposition, G_UNICHAR_MAX_DECOMPOSITION_LENGTH);
+
+			for (i = 0; i < n; i++)
+				{
+					gunichar ch = decomposition[i];
+
+					if (ch < 0x80)
+						ch = g_ascii_tolower(ch);
+					/* the order of combining marks is not fixed */
+					else if (g_unichar_combining_class(ch) != 0)
+						continue;
+					else
+						ch = g_unichar_tolower(g_unichar_toupper(ch));
+
+					hash ^= ch;
+					hash *= G_GUINT64_CONSTANT(1099511628211);
+				}
+		}
 
-	g_free(trie->value);
-	g_free(trie);
+	/* spread the low bits over the high ones, which the probes also use */
+	hash ^= hash >> 33;
+	hash *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+	hash ^= hash >> 33;
+
+	return hash;
 }
 
-static void enchant_trie_free_cb(void* key _GL_UNUSED_PARAMETER,
-				 void* value,
-				 void* data _GL_UNUSED_PARAMETER)
+static void enchant_trie_bloom_add(EnchantTrie* trie, const char *const word, size_t len)
 {
-	enchant_trie_free((EnchantTrie*) value);
+	guint64 hash = enchant_trie_bloom_hash(word, len);
+	guint32 h1 = (guint32)hash, h2 = (guint32)(hash >> 32) | 1;
+	int i;
+
+	for (i = 0; i < ENCHANT_PWL_BLOOM_PROBES; i++)
+		{
+			guint32 bit = (h1 + i * h2) & (trie->bloom_bits - 1);
+			trie->bloom[bit / 64] |= G_GUINT64_CONSTANT(1) << (bit % 64);
+		}
 }
 
-static EnchantTrie* enchant_trie_insert(EnchantTrie* trie,const char *const word)
+/* Sizes the filter for twice the current number of words and adds them */
+static void enchant_trie_bloom_rebuild(EnchantTrie* trie)
 {
-	char *tmpWord;
-	ssize_t nxtCh = 0;
-	EnchantTrie* subtrie;
+	EnchantTrieIndex node;
 
-	if (trie == NULL) {
-		trie = g_new0(EnchantTrie, 1);
-	}
+	g_free(trie->bloom);
+	trie->bloom = NULL;
+	trie->bloom_bits = 0;
 
-	if (trie->value == NULL) {
-		if (trie->subtries == NULL) {
-			/*  When single word, store in trie->value */
-			trie->value = g_strdup(word);
-		} else {
-			/* Store multiple words in subtries */
-			if (word[0] == '\0') {
-				/* Mark end-of-string with special node */
-				tmpWord = g_strdup("");
-				g_hash_table_insert(trie->subtries, tmpWord, EOSTrie);
-			} else {
-				nxtCh = (ssize_t)(g_utf8_next_char(word)-word);
-				tmpWord = g_strndup(word,nxtCh);
-				subtrie = g_hash_table_lookup(trie->subtries, tmpWord);
-				subtrie = enchant_trie_insert(subtrie, word + nxtCh);
-				g_hash_table_insert(trie->subtries, tmpWord, subtrie);
+	if (trie->n_words > ENCHANT_PWL_BLOOM_MAX_WORDS)
+		return;
+
+	trie->bloom_bits = ENCHANT_PWL_BLOOM_MIN_BITS;
+	while (trie->bloom_bits < 2 * trie->n_words * ENCHANT_PWL_BLOOM_BITS_PER_WORD)
+		trie->bloom_bits *= 2;
+	trie->bloom = g_new0(guint64, trie->bloom_bits / 64);
+
+	for (node = 0; node < trie->n_nodes; node++)
+		if (trie->nodes[node].word != 0)
+			{
+				const char* word = trie->strings + trie->nodes[node].word - 1;
+				enchant_trie_bloom_add(trie, word, strlen(word));
 			}
+}
+
+/* Returns FALSE if neither the word nor its case variants can be in the trie */
+static gboolean enchant_trie_may_contain(const EnchantTrie* trie, const char *const word, size_t len)
+{
+	guint64 hash;
+	guint32 h1, h2;
+	int i;
+
+	if (trie->n_words == 0)
+		return FALSE;
+	if (trie->bloom == NULL)
+		return TRUE;
+
+	hash = enchant_trie_bloom_hash(word, len);
+	h1 = (guint32)hash;
+	h2 = (guint32)(hash >> 32) | 1;
+	for (i = 0; i < ENCHANT_PWL_BLOOM_PROBES; i++)
+		{
+			guint32 bit = (h1 + i * h2) & (trie->bloom_bits - 1);
+			if (!(trie->bloom[bit / 64] & (G_GUINT64_CONSTANT(1) << (bit % 64))))
+				return FALSE;
 		}
-	} else {
-		/* Create new hash table for subtries, and reinsert */
-		trie->subtries = g_hash_table_new_full(g_str_hash, 
-						       g_str_equal, g_free, NULL);
-		tmpWord = trie->value;
-		trie->value = NULL;
-		enchant_trie_insert(trie, tmpWord);
-		enchant_trie_insert(trie, word);
-		g_free(tmpWord);
-	}
 
-	return trie;
+	return TRUE;
 }
 
-static void enchant_trie_remove(EnchantTrie* trie,const char *const word)
+/* Copy a trie that lives in a mapped index into memory of its own,
+ * so that it can be modified. */
+static void enchant_trie_unshare(EnchantTrie* trie)
 {
-	char *tmpWord;
-	ssize_t nxtCh = 0;
-	EnchantTrie* subtrie;
+	EnchantTrieNode* nodes;
+	char* strings;
 
-	if (trie == NULL)
+	if (trie->mapped == NULL)
 		return;
 
-	if (trie->value == NULL) {
-		if (trie->subtries != NULL) {
-			/* Store multiple words in subtries */
-			if (word[0] == '\0') {
-				/* End-of-string is marked with special node */
-				g_hash_table_remove(trie->subtries, "");
-			} else {
-				nxtCh = (ssize_t)(g_utf8_next_char(word) - word);
-				tmpWord = g_strndup(word, nxtCh);
-				subtrie = g_hash_table_lookup(trie->subtries, tmpWord);
-				enchant_trie_remove(subtrie, word + nxtCh);
-
-				if(subtrie->subtries == NULL && subtrie->value == NULL) {
-					g_hash_table_remove(trie->subtries, tmpWord);
-					enchant_trie_free (subtrie);
-				}
-
-				g_free(tmpWord);
-			}
-
-			if(g_hash_table_size(trie->subtries) == 1)
-				{
-					char* key;
-					GList* keys = g_hash_table_get_keys(trie->subtries);
-					key = (char*) keys->data;
-					subtrie = g_hash_table_lookup(trie->subtries, key);
+	nodes = g_new(EnchantTrieNode, trie->n_nodes);
+	memcpy(nodes, trie->nodes, trie->n_nodes * sizeof(EnchantTrieNode));
+	strings = g_new(char, trie->strings_len);
+	memcpy(strings, trie->strings, trie->strings_len);
+
+	g_mapped_file_unref(trie->mapped);
+	trie->mapped = NULL;
+	trie->nodes = nodes;
+	trie->nodes_size = trie->n_nodes;
+	trie->strings = strings;
+	trie->strings_size = trie->strings_len;
+}
 
-					/* only remove trie nodes that have values by propagating these up */
-					if(subtrie->value)
-						{
-							trie->value = g_strconcat(key, subtrie->value, NULL);
-							enchant_trie_free(subtrie);
-							g_hash_table_destroy(trie->subtries);
-							trie->subtries = NULL;
-						}
+static EnchantTrieIndex enchant_trie_new_node(EnchantTrie* trie, gunichar ch)
+{
+	EnchantTrieIndex node;
 
-					g_list_free(keys);
-				}
-		}
+	if (trie->free_nodes != 0) {
+		node = trie->free_nodes;
+		trie->free_nodes = trie->nodes[node].next_sibling;
 	} else {
-		if(strcmp(trie->value, word) == 0)
-		{
-			g_free(trie->value);
-			trie->value = NULL;
+		if (trie->n_nodes == trie->nodes_size) {
+			trie->nodes_size = trie->nodes_size ? 2 * trie->nodes_size : 64;
+			trie->nodes = g_renew(EnchantTrieNode, trie->nodes, trie->nodes_size);
 		}
+		node = trie->n_nodes++;
 	}
+
+	trie->nodes[node].ch = ch;
+	trie->nodes[node].first_child = 0;
+	trie->nodes[node].next_sibling = 0;
+	trie->nodes[node].word = 0;
+	return node;
 }
 
-static EnchantTrie* enchant_trie_get_subtrie(EnchantTrie* trie, 
-					     EnchantTrieMatcher* matcher,
-					     char** nxtChS)
+static void enchant_trie_release_node(EnchantTrie* trie, EnchantTrieIndex node)
 {
-	EnchantTrie* subtrie;
+	trie->nodes[node].first_child = 0;
+	trie->nodes[node].word = 0;
+	trie->nodes[node].next_sibling = trie->free_nodes;
+	trie->free_nodes = node;
+}
 
-	if(trie->subtries == NULL || *nxtChS == NULL)
-		return NULL;
+/* Returns the child of node reached through ch, or 0 if there is none. */
+static EnchantTrieIndex enchant_trie_get_child(const EnchantTrie* trie, EnchantTrieIndex node,
+					       gunichar ch)
+{
+	EnchantTrieIndex child;
 
-	subtrie = g_hash_table_lookup(trie->subtries,*nxtChS);
-	if(subtrie == NULL && matcher->mode == case_insensitive) {
-		char* nxtChSUp = g_utf8_strup(*nxtChS, -1); /* we ignore the title case scenario since that will give us an edit_distance of one which is acceptable since this mode is used for suggestions*/
-		g_free(*nxtChS);
-		*nxtChS = nxtChSUp;
-		subtrie = g_hash_table_lookup(trie->subtries,nxtChSUp);
-	}
-	return subtrie;
+	for (child = trie->nodes[node].first_child;
+	     child != 0 && trie->nodes[child].ch < ch;
+	     child = trie->nodes[child].next_sibling)
+		;
+	if (child != 0 && trie->nodes[child].ch == ch)
+		return child;
+
+	return 0;
 }
 
-static void enchant_trie_find_matches(EnchantTrie* trie,EnchantTrieMatcher *matcher)
+static EnchantTrieIndex enchant_trie_add_child(EnchantTrie* trie, EnchantTrieIndex node, gunichar ch)
 {
-	int errs = 0;
-	ssize_t nxtChI = 0, oldPos = 0;
-	char* nxtChS = NULL;
-	EnchantTrie* subtrie = NULL;
+	EnchantTrieIndex prev = 0, next, child;
+
+	for (next = trie->nodes[node].first_child;
+	     next != 0 && trie->nodes[next].ch < ch;
+	     next = trie->nodes[next].next_sibling)
+		prev = next;
+	if (next != 0 && trie->nodes[next].ch == ch)
+		return next;
+
+	/* may move the node array, so no pointers into it are held here */
+	child = enchant_trie_new_node(trie, ch);
+	trie->nodes[child].next_sibling = next;
+	if (prev != 0)
+		trie->nodes[prev].next_sibling = child;
+	else
+		trie->nodes[node].first_child = child;
+	return child;
+}
 
-	g_return_if_fail(matcher);
+static guint32 enchant_trie_store_string(EnchantTrie* trie, const char *const word, size_t len)
+{
+	gsize offset = trie->strings_len;
 
-	/* Can't match in the empty trie */
-	if(trie == NULL) {
-		return;
+	if (trie->strings_len + len + 1 > trie->strings_size) {
+		trie->strings_size = MAX(2 * trie->strings_size, trie->strings_len + len + 1);
+		trie->strings = g_renew(char, trie->strings, trie->strings_size);
 	}
+	memcpy(trie->strings + offset, word, len);
+	trie->strings[offset + len] = '\0';
+	trie->strings_len += len + 1;
 
-	/* Bail out if over the error limits */
-	if(matcher->num_errors > matcher->max_errors){
-		return;
-	}
+	return (guint32)(offset + 1);
+}
 
-	/* If the end of a string has been reached, no point recursing */
-	if (trie == EOSTrie) {
-		size_t word_len = strlen(matcher->word);
-		errs = matcher->num_errors;
-		if((ssize_t)word_len > matcher->word_pos) {
-			matcher->num_errors = errs + word_len - matcher->word_pos;
-		}
-		if (matcher->num_errors <= matcher->max_errors) {
-			matcher->cbfunc(g_strdup(matcher->path),matcher);
+/* Drop the strings of removed words by moving the live ones together */
+static void enchant_trie_compact_strings(EnchantTrie* trie)
+{
+	char* strings;
+	gsize len = 0;
+	guint32 i;
+
+	strings = g_new(char, trie->strings_len - trie->strings_garbage);
+	for (i = 0; i < trie->n_nodes; i++) {
+		if (trie->nodes[i].word != 0) {
+			const char* word = trie->strings + trie->nodes[i].word - 1;
+			size_t word_len = strlen(word) + 1;
+
+			memcpy(strings + len, word, word_len);
+			trie->nodes[i].word = (guint32)(len + 1);
+			len += word_len;
 		}
-		matcher->num_errors = errs;
-		return;
 	}
 
-	/* If there is a value, just check it, no recursion */
-	if (trie->value != NULL) {
-		gchar* value;
-		errs = matcher->num_errors;
-		value = trie->value;
-		if(matcher->mode == case_insensitive)
-			{
-				value = g_utf8_strdown(value, -1);
-			}
-		matcher->num_errors = errs + edit_dist(value, 
-					   &(matcher->word[matcher->word_pos]));
-		if(matcher->mode == case_insensitive)
-			{
-				g_free(value);
-			}
+	g_free(trie->strings);
+	trie->strings = strings;
+	trie->strings_len = trie->strings_size = len;
+	trie->strings_garbage = 0;
+}
 
-		if (matcher->num_errors <= matcher->max_errors) {
-			matcher->cbfunc(g_strconcat(matcher->path,
-							trie->value,NULL),
-					matcher);
-		}
-		matcher->num_errors = errs;
-		return;
-	}
+/* Adds normalized_word, remembering word as its original spelling.
+ * Returns FALSE if the word was already present, in which case the
+ * spelling seen first is kept. */
+static gboolean enchant_trie_insert(EnchantTrie* trie,const char *const normalized_word,
+				    const char *const word, size_t len)
+{
+	EnchantTrieIndex node;
+	const char* it;
 
-	nxtChI = (ssize_t)(g_utf8_next_char(&matcher->word[matcher->word_pos]) - matcher->word);
-	nxtChS = g_strndup(&matcher->word[matcher->word_pos],
-			(nxtChI - matcher->word_pos));
+	if (trie->mapped != NULL && enchant_trie_contains(trie, normalized_word))
+		return FALSE;
+	enchant_trie_unshare(trie);
 
-	/* Precisely match the first character, and recurse */
-	subtrie = enchant_trie_get_subtrie(trie, matcher, &nxtChS);
+	if (trie->n_nodes == 0)
+		enchant_trie_new_node(trie, 0);
 
-	if (subtrie != NULL) {
-		enchant_trie_matcher_pushpath(matcher,nxtChS);
-		oldPos = matcher->word_pos;
-		matcher->word_pos = nxtChI;
-		enchant_trie_find_matches(subtrie,matcher);
-		matcher->word_pos = oldPos;
-		enchant_trie_matcher_poppath(matcher,strlen(nxtChS));
+	node = 0;
+	for (it = normalized_word; *it; it = g_utf8_next_char(it))
+		node = enchant_trie_add_child(trie, node, g_utf8_get_char(it));
+
+	if (trie->nodes[node].word != 0)
+		return FALSE;
+
+	trie->nodes[node].word = enchant_trie_store_string(trie, word, len);
+	trie->n_words++;
+
+	if (trie->bloom != NULL &&
+	    trie->n_words * ENCHANT_PWL_BLOOM_BITS_PER_WORD <= trie->bloom_bits)
+		enchant_trie_bloom_add(trie, word, len);
+	else if (trie->bloom != NULL || trie->n_words == 1)
+		enchant_trie_bloom_rebuild(trie);
+	return TRUE;
+}
+
+static gboolean enchant_trie_remove_below(EnchantTrie* trie, EnchantTrieIndex node,
+					  const char *const normalized_word)
+{
+	EnchantTrieIndex prev = 0, child;
+	gunichar ch;
+
+	if (*normalized_word == '\0') {
+		if (trie->nodes[node].word == 0)
+			return FALSE;
+
+		trie->strings_garbage += strlen(trie->strings + trie->nodes[node].word - 1) + 1;
+		trie->nodes[node].word = 0;
+		return TRUE;
+	}
+
+	ch = g_utf8_get_char(normalized_word);
+	for (child = trie->nodes[node].first_child;
+	     child != 0 && trie->nodes[child].ch < ch;
+	     child = trie->nodes[child].next_sibling)
+		prev = child;
+	if (child == 0 || trie->nodes[child].ch != ch)
+		return FALSE;
+
+	if (!enchant_trie_remove_below(trie, child, g_utf8_next_char(normalized_word)))
+		return FALSE;
+
+	/* only release nodes which no longer lead to any word */
+	if (trie->nodes[child].word == 0 && trie->nodes[child].first_child == 0) {
+		if (prev != 0)
+			trie->nodes[prev].next_sibling = trie->nodes[child].next_sibling;
+		else
+			trie->nodes[node].first_child = trie->nodes[child].next_sibling;
+		enchant_trie_release_node(trie, child);
 	}
+	return TRUE;
+}
+
+static gboolean enchant_trie_remove(EnchantTrie* trie,const char *const normalized_word)
+{
+	if (trie->mapped != NULL && !enchant_trie_contains(trie, normalized_word))
+		return FALSE;
+	enchant_trie_unshare(trie);
+
+	if (trie->n_nodes == 0 || !enchant_trie_remove_below(trie, 0, normalized_word))
+		return FALSE;
+
+	trie->n_words--;
+	if (trie->n_words == 0)
+		enchant_trie_clear(trie); /* make trie empty if has no content */
+	else if (trie->strings_garbage > trie->strings_len - trie->strings_garbage)
+		enchant_trie_compact_strings(trie);
+	return TRUE;
+}
+
+/* Returns the string offset + 1 of the spelling of a word, or 0 if the
+ * word is not in the trie. */
+static guint32 enchant_trie_lookup(const EnchantTrie* trie,const char *const normalized_word)
+{
+	EnchantTrieIndex node = 0;
+	const char* it;
 
-	g_free(nxtChS);
+	if (trie->n_nodes == 0)
+		return 0;
 
-	matcher->num_errors++;
-	if (matcher->word[matcher->word_pos] != '\0') {
-		/* Match on inserting word[0] */
-		oldPos = matcher->word_pos;
-		matcher->word_pos = nxtChI;
-		enchant_trie_find_matches(trie,matcher);
-		matcher->word_pos = oldPos;
+	for (it = normalized_word; *it; it = g_utf8_next_char(it)) {
+		node = enchant_trie_get_child(trie, node, g_utf8_get_char(it));
+		if (node == 0)
+			return 0;
 	}
-	/* for each subtrie, match on delete or substitute word[0] or transpose word[0] and word[1] */
-	g_hash_table_foreach(trie->subtries,
-				enchant_trie_find_matches_cb,
-				matcher);
-	matcher->num_errors--;
+	return trie->nodes[node].word;
 }
 
-static void enchant_trie_find_matches_cb(void* keyV,void* subtrieV,void* matcherV)
+static gboolean enchant_trie_contains(const EnchantTrie* trie,const char *const normalized_word)
 {
-	char* key, *key2;
-	EnchantTrie* subtrie, *subtrie2;
-	EnchantTrieMatcher* matcher;
-	ssize_t nxtChI, oldPos;
+	return enchant_trie_lookup(trie, normalized_word) != 0;
+}
 
-	key = (char*) keyV;
-	subtrie = (EnchantTrie*) subtrieV;
-	matcher = (EnchantTrieMatcher*) matcherV;
+/* Whether the trie character ch matches character pos of the word */
+static gboolean enchant_trie_matcher_matches(const EnchantTrieMatcher* matcher, gunichar ch, glong pos)
+{
+	return ch == matcher->word[pos] || ch == matcher->word_upper[pos];
+}
 
-	nxtChI = (ssize_t) (g_utf8_next_char(&matcher->word[matcher->word_pos]) - matcher->word);
+/* Compute the row for a node at the given depth, reached through ch from
+ * a parent reached through parent_ch, from the rows of its parent and
+ * grandparent.  Only the band of the row within max distance of the
+ * diagonal is computed; the entries just outside it are set to a value
+ * above the limit.  Returns the smallest entry of the row. */
+static int enchant_trie_matcher_next_row(EnchantTrieMatcher* matcher, glong depth,
+					 gunichar ch, gunichar parent_ch)
+{
+	const glong n = matcher->word_len;
+	const int limit = matcher->band + 1;
+	int* row = matcher->rows + depth * (n + 1);
+	const int* prev = row - (n + 1);
+	const int* prev2 = depth >= 2 ? prev - (n + 1) : NULL;
+	glong j, lo, hi;
+	int best;
+
+	lo = MAX(1, depth - matcher->band);
+	hi = MIN(n, depth + matcher->band);
+
+	row[0] = depth;
+	best = (lo == 1) ? row[0] : limit;
+	if (lo > 1)
+		row[lo - 1] = limit;
+
+	for (j = lo; j <= hi; j++) {
+		int cost = enchant_trie_matcher_matches(matcher, ch, j - 1) ? 0 : 1;
+		int d = MIN(prev[j], row[j - 1]) + 1;
+
+		d = MIN(d, prev[j - 1] + cost);
+		/* a transposition never beats a match */
+		if (cost != 0 && prev2 != NULL && j >= 2 &&
+		    enchant_trie_matcher_matches(matcher, ch, j - 2) &&
+		    enchant_trie_matcher_matches(matcher, parent_ch, j - 1))
+			d = MIN(d, prev2[j - 2] + 1);
+
+		row[j] = MIN(d, limit);
+		best = MIN(best, row[j]);
+	}
 
-	/* Dont handle actual matches, that's already done */
-	if (strncmp(key,&matcher->word[matcher->word_pos],nxtChI-matcher->word_pos) == 0) {
+	if (hi < n)
+		row[hi + 1] = limit;
+	return best;
+}
+
+static void enchant_trie_find_matches_below(const EnchantTrie* trie, EnchantTrieIndex node,
+					    glong depth, EnchantTrieMatcher *matcher)
+{
+	const glong n = matcher->word_len;
+	const int* row = matcher->rows + depth * (n + 1);
+	EnchantTrieIndex child;
+
+	/* If a word ends here, its distance is in the last column */
+	if (trie->nodes[node].word != 0 && n >= depth - matcher->band && n <= depth + matcher->band &&
+	    row[n] <= matcher->max_errors) {
+		matcher->num_errors = row[n];
+		matcher->n_matches++;
+		matcher->cbfunc(trie->strings + trie->nodes[node].word - 1, matcher);
+	}
+
+	/* Deeper words are all farther away than allowed */
+	if (depth >= n + matcher->band)
 		return;
+
+	for (child = trie->nodes[node].first_child; child != 0; child = trie->nodes[child].next_sibling) {
+		/* Only descend while some prefix of the word is still close enough */
+		if (enchant_trie_matcher_next_row(matcher, depth + 1, trie->nodes[child].ch,
+						  trie->nodes[node].ch) <= matcher->max_errors)
+			enchant_trie_find_matches_below(trie, child, depth + 1, matcher);
 	}
+}
 
-	enchant_trie_matcher_pushpath(matcher,key);
+static void enchant_trie_find_matches(const EnchantTrie* trie,EnchantTrieMatcher *matcher)
+{
+	glong j, hi;
+	int band, max_errors;
 
-	/* Match on deleting word[0] */
-	enchant_trie_find_matches(subtrie,matcher);
-	/* Match on substituting word[0] */
-	oldPos = matcher->word_pos;
-	matcher->word_pos = nxtChI;
-	enchant_trie_find_matches(subtrie,matcher);
+	g_return_if_fail(matcher);
 
-	enchant_trie_matcher_poppath(matcher,strlen(key));
+	/* Can't match in the empty trie */
+	if(trie->n_nodes == 0) {
+		return;
+	}
 
-	/* Match on transposing word[0] and word[1] */
-	key2 = g_strndup(&matcher->word[oldPos],nxtChI-oldPos);
-	subtrie2 = enchant_trie_get_subtrie(subtrie, matcher, &key2);
+	/* Search with a growing limit and stop at the first that finds
+	 * anything: the narrow passes are cheap and usually suffice */
+	max_errors = matcher->max_errors;
+	for (band = 0; band <= max_errors && matcher->n_matches == 0; band++) {
+		matcher->band = matcher->max_errors = band;
 
-	if(subtrie2 != NULL) {
-		nxtChI = (ssize_t) (g_utf8_next_char(&matcher->word[matcher->word_pos]) - matcher->word);
-		if (strncmp(key,&matcher->word[matcher->word_pos],nxtChI-matcher->word_pos) == 0) {
-			matcher->word_pos = nxtChI;
-			enchant_trie_matcher_pushpath(matcher,key);
-			enchant_trie_matcher_pushpath(matcher,key2);
+		/* The root row: the distance of every prefix of the word to "" */
+		hi = MIN(matcher->word_len, matcher->band);
+		for (j = 0; j <= hi; j++)
+			matcher->rows[j] = j;
+		if (hi < matcher->word_len)
+			matcher->rows[hi + 1] = matcher->band + 1;
 
-			enchant_trie_find_matches(subtrie2,matcher);
-			enchant_trie_matcher_poppath(matcher,strlen(key2));
-			enchant_trie_matcher_poppath(matcher,strlen(key));
-		}
+		enchant_trie_find_matches_below(trie, 0, 0, matcher);
 	}
-
-	g_free(key2);
-	
-	matcher->word_pos = oldPos;
 }
 
 static EnchantTrieMatcher* enchant_trie_matcher_init(const char* const word,
 						     size_t len,
 						     int maxerrs,
 						     EnchantTrieMatcherMode mode,
-						     void(*cbfunc)(char*,EnchantTrieMatcher*),
+						     void(*cbfunc)(const char*,EnchantTrieMatcher*),
 						     void* cbdata)
 {
 	EnchantTrieMatcher* matcher;
 	char * normalized_word, * pattern;
+	glong i;
 
 	normalized_word = g_utf8_normalize (word, len, G_NORMALIZE_NFD);
 	len = strlen(normalized_word);
@@ -1074,14 +1895,25 @@ static EnchantTrieMatcher* enchant_trie_matcher_init(const char* const word,
 	matcher = g_new(EnchantTrieMatcher,1);
 	matcher->num_errors = 0;
 	matcher->max_errors = maxerrs;
-	matcher->word = g_new0(char,len+maxerrs+1); // Ensure matcher does not overrun buffer
-	strcpy(matcher->word, pattern);
+	matcher->band = maxerrs;
+	matcher->n_matches = 0;
+	matcher->word = g_utf8_to_ucs4_fast(pattern, -1, &matcher->word_len);
 	g_free(pattern);
-	matcher->word_pos = 0;
-	matcher->path = g_new0(char,len+maxerrs+1);
-	matcher->path[0] = '\0';
-	matcher->path_len = len+maxerrs+1;
-	matcher->path_pos = 0;
+
+	/* we ignore the title case scenario since that will give us an edit
+	 * distance of one which is acceptable since this mode is used for
+	 * suggestions */
+	if(mode == case_insensitive)
+		{
+			matcher->word_upper = g_new(gunichar, matcher->word_len + 1);
+			for(i = 0; i <= matcher->word_len; i++)
+				matcher->word_upper[i] = g_unichar_toupper(matcher->word[i]);
+		}
+	else
+		matcher->word_upper = matcher->word;
+
+	/* a trie path longer than word_len + maxerrs is always too far away */
+	matcher->rows = g_new(int, (matcher->word_len + maxerrs + 1) * (matcher->word_len + 1));
 	matcher->mode = mode;
 	matcher->cbfunc = cbfunc;
 	matcher->cbdata = cbdata;
@@ -1091,90 +1923,158 @@ static EnchantTrieMatcher* enchant_trie_matcher_init(const char* const word,
 
 static void enchant_trie_matcher_free(EnchantTrieMatcher* matcher)
 {
+	if(matcher->word_upper != matcher->word)
+		g_free(matcher->word_upper);
 	g_free(matcher->word);
-	g_free(matcher->path);
+	g_free(matcher->rows);
 	g_free(matcher);
 }
 
-static void enchant_trie_matcher_pushpath(EnchantTrieMatcher* matcher,char* newchars)
+/* Decode up to max characters of a UTF-8 string into chars.  Returns the
+ * number of characters, or -1 if the string has more than max. */
+static glong edit_dist_decode(const char* utf8word, gunichar* chars, glong max)
 {
-	ssize_t len, i;
+	glong len = 0;
 
-	len = strlen(newchars);
-	if(matcher->path_pos + len >= matcher->path_len) {
-		matcher->path_len = matcher->path_len + len + 10;
-		matcher->path = g_renew(char,matcher->path,matcher->path_len);
-	}
-
-	for(i = 0; i < len; i++) {
-		matcher->path[matcher->path_pos + i] = newchars[i];
+	while (*utf8word) {
+		if (len == max)
+			return -1;
+		if ((guchar)*utf8word < 0x80) {
+			chars[len++] = (guchar)*utf8word++;
+		} else {
+			chars[len++] = g_utf8_get_char(utf8word);
+			utf8word = g_utf8_next_char(utf8word);
+		}
 	}
-	matcher->path_pos = matcher->path_pos + len;
-	matcher->path[matcher->path_pos] = '\0';
+	return len;
 }
 
-static void enchant_trie_matcher_poppath(EnchantTrieMatcher* matcher,int num)
+/* The restricted Damerau-Levenshtein distance of two words, computed with
+ * Hyyrö's bit-vector algorithm: one machine word holds a whole column of
+ * the table, so each character of word2 costs a handful of logical
+ * operations.  word1 must have between 1 and 64 characters. */
+static int edit_dist_bit_parallel(const gunichar* word1, glong len1,
+				  const gunichar* word2, glong len2, int max)
 {
-	g_return_if_fail(matcher->path_pos >= 0);
-	matcher->path_pos = matcher->path_pos - num;
-	if(matcher->path_pos < 0) {
-		matcher->path_pos = 0;
+	gunichar peq_ch[ENCHANT_PWL_EDIT_DIST_MAX_CHARS];
+	guint64 peq_bits[ENCHANT_PWL_EDIT_DIST_MAX_CHARS];
+	guint64 vp = ~(guint64)0, vn = 0, d0 = 0, hp, hn, tr, pm, pm_prev = 0;
+	const guint64 last = (guint64)1 << (len1 - 1);
+	glong i, j, n_peq = 0;
+	int dist = len1;
+
+	/* The positions at which each distinct character occurs in word1 */
+	for (i = 0; i < len1; i++) {
+		for (j = 0; j < n_peq && peq_ch[j] != word1[i]; j++)
+			;
+		if (j == n_peq) {
+			peq_ch[n_peq] = word1[i];
+			peq_bits[n_peq++] = 0;
+		}
+		peq_bits[j] |= (guint64)1 << i;
+	}
+
+	for (i = 0; i < len2; i++) {
+		for (j = 0; j < n_peq && peq_ch[j] != word2[i]; j++)
+			;
+		pm = (j < n_peq) ? peq_bits[j] : 0;
+
+		tr = (((~d0) & pm) << 1) & pm_prev;
+		d0 = (((pm & vp) + vp) ^ vp) | pm | vn | tr;
+		hp = vn | ~(d0 | vp);
+		hn = d0 & vp;
+		if (hp & last)
+			dist++;
+		else if (hn & last)
+			dist--;
+		hp = (hp << 1) | 1;
+		vp = (hn << 1) | ~(d0 | hp);
+		vn = hp & d0;
+		pm_prev = pm;
+
+		/* Each remaining character can lower the distance by one at most */
+		if (dist - (len2 - i - 1) > max)
+			return max + 1;
 	}
-	matcher->path[matcher->path_pos] = '\0';
+	return dist;
 }
 
-static int edit_dist(const char* utf8word1, const char* utf8word2)
+/* The same distance by dynamic programming over the entries within max of
+ * the diagonal, for words too long for edit_dist_bit_parallel. */
+static int edit_dist_banded(const gunichar* word1, glong len1,
+			    const gunichar* word2, glong len2, int max)
 {
-	gunichar * word1, * word2;
-	glong len1, len2, cost, i, j;
-	int v1, v2, v3, v4;
-	int* table;
-
-	word1 = g_utf8_to_ucs4_fast(utf8word1, -1, &len1);
-	word2 = g_utf8_to_ucs4_fast(utf8word2, -1, &len2);
+	int *rows, *row, *prev, *prev2;
+	glong i, j, lo, hi;
+	int d, best, limit = max + 1;
+
+	rows = g_new(int, 3 * (len2 + 1));
+	for (j = 0; j <= len2; j++)
+		rows[j] = MIN(j, limit);
+
+	for (i = 1; i <= len1; i++) {
+		row = rows + (i % 3) * (len2 + 1);
+		prev = rows + ((i - 1) % 3) * (len2 + 1);
+		prev2 = rows + ((i + 1) % 3) * (len2 + 1);
+
+		lo = MAX(1, i - max);
+		hi = MIN(len2, i + max);
+		row[0] = MIN(i, limit);
+		if (lo > 1)
+			row[lo - 1] = limit;
+		best = row[lo - 1];
+
+		for (j = lo; j <= hi; j++) {
+			int cost = (word1[i - 1] == word2[j - 1]) ? 0 : 1;
+
+			d = MIN(prev[j], row[j - 1]) + 1;
+			d = MIN(d, prev[j - 1] + cost);
+			if (i > 1 && j > 1 && word1[i - 1] == word2[j - 2] && word1[i - 2] == word2[j - 1])
+				d = MIN(d, prev2[j - 2] + cost);
+			row[j] = MIN(d, limit);
+			best = MIN(best, row[j]);
+		}
+		if (hi < len2)
+			row[hi + 1] = limit;
 
-	table = g_new0(int,(len1+1)*(len2+1));
-	
-	/* Initialise outer rows of table */
-	for (i=0; i < len1 + 1; i++) {
-		table[i*(len2+1)] = i;
-	}
-	for (j=0; j < len2 + 1; j++) {
-		table[j] = j;
+		if (best > max)
+			break;
 	}
 
-	/* Fill in table in dynamic programming style */
-	for (i=1; i < len1+1; i++){
-		for(j=1; j < len2+1; j++) {
-			if(word1[i-1] == word2[j-1]) {
-				cost = 0;
-			} else {
-				cost = 1;
-			}
-			v1 = table[(i-1)*(len2+1)+j] + 1;
-			v2 = table[i*(len2+1)+(j-1)] + 1;
-			v3 = table[(i-1)*(len2+1)+(j-1)] + cost;
-
-			if(i > 1 && j > 1 && word1[i-1] == word2[j-2] && word1[i-2] == word2[j-1]) {
-				v4 = table[(i-2)*(len2+1)+(j-2)] + cost;
-				if(v4 < v1)
-					v1 = v4;
-			}
+	d = (i > len1) ? rows[(len1 % 3) * (len2 + 1) + len2] : limit;
+	g_free(rows);
+	return d;
+}
 
-			if (v1 < v2 && v1 < v3) {
-				cost = v1;
-			} else if (v2 < v3) {
-				cost = v2;
-			} else {
-				cost = v3;
-			}
-			table[i*(len2+1)+j] = cost;
-		}
+/* Returns the edit distance between two words, or a value above max if
+ * it is larger than max. */
+static int edit_dist(const char* utf8word1, const char* utf8word2, int max)
+{
+	gunichar buf1[ENCHANT_PWL_EDIT_DIST_MAX_CHARS], buf2[ENCHANT_PWL_EDIT_DIST_MAX_CHARS];
+	gunichar * word1, * word2;
+	glong len1, len2;
+	int dist;
+
+	if (max < 0)
+		return max + 1;
+
+	len1 = edit_dist_decode(utf8word1, buf1, ENCHANT_PWL_EDIT_DIST_MAX_CHARS);
+	len2 = edit_dist_decode(utf8word2, buf2, ENCHANT_PWL_EDIT_DIST_MAX_CHARS);
+	if (len1 >= 0 && len2 >= 0) {
+		if (ABS(len1 - len2) > max)
+			return max + 1;
+		if (len1 == 0 || len2 == 0)
+			return MAX(len1, len2);
+		return edit_dist_bit_parallel(buf1, len1, buf2, len2, max);
 	}
 
-	cost = table[len1*(len2+1) + len2];
+	word1 = g_utf8_to_ucs4_fast(utf8word1, -1, &len1);
+	word2 = g_utf8_to_ucs4_fast(utf8word2, -1, &len2);
+	if (ABS(len1 - len2) > max)
+		dist = max + 1;
+	else
+		dist = edit_dist_banded(word1, len1, word2, len2, max);
 	g_free(word1);
 	g_free(word2);
-	g_free(table);
-	return cost;
+	return dist;
 }
@@ -31,6 +31,7 @@
 #define PWL_H
 
 #include "enchant.h"
+#include "stats.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -50,6 +51,26 @@ char** enchant_pwl_suggest(EnchantPWL *me, const char *const word,
 			   size_t len, char ** suggs, size_t* out_n_suggs);
 void enchant_pwl_free(EnchantPWL* me);
 
+/* Check the file for changes made by others at most once every msecs
+ * when checking words or making suggestions (0 means on every call) */
+void enchant_pwl_set_refresh_interval(EnchantPWL * me, int msecs);
+
+/* Count the times the file is read again or rewritten in @stats, which
+ * must outlive the PWL, or stop counting if NULL */
+void enchant_pwl_set_stats(EnchantPWL * me, EnchantStats * stats);
+
+/* For callers that share a PWL between threads: enchant_pwl_check and
+ * enchant_pwl_suggest look for changes to the file themselves, while the
+ * _loaded variants only read what is in memory and so may run concurrently.
+ * enchant_pwl_refresh_is_due tells, subject to the refresh interval, whether
+ * the file changed since it was read, and enchant_pwl_refresh reads the
+ * changes. */
+int enchant_pwl_refresh_is_due(EnchantPWL * me);
+void enchant_pwl_refresh(EnchantPWL * me);
+int enchant_pwl_check_loaded(EnchantPWL * me, const char *const word, size_t len);
+char** enchant_pwl_suggest_loaded(EnchantPWL *me, const char *const word,
+				  size_t len, char ** suggs, size_t* out_n_suggs);
+
 #ifdef __cplusplus
 }
 #endif
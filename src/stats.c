@@ -0,0 +1,174 @@
+/* enchant
+ * Copyright (C) 2003 Dom Lachowicz
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02110-1301, USA.
+ *
+ * In addition, as a special exception, Dom Lachowicz
+ * gives permission to link the code of this program with
+ * non-LGPL Spelling Provider libraries (eg: a MSFT Office
+ * spell checker backend) and distribute linked combinations including
+ * the two.  You must obey the GNU Lesser General Public License in all
+ * respects for all of the code used other than said providers.  If you modify
+ * this file, you may extend this exception to your version of the
+ * file, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+/**
+ *
+ *  This file implements the operation counters of brokers and
+ *  dictionaries in the type EnchantStats.
+ *
+ *  Each operation has a count, a total duration and a histogram of
+ *  durations with power of two buckets.  The counters are kept in a few
+ *  stripes, and a thread always adds to the same stripe, picked in turn
+ *  the first time it records anything, so that threads checking words at
+ *  the same time seldom write to the same cache lines.  Adding up the
+ *  stripes is left to the rare reads.
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "stats.h"
+
+#define ENCHANT_STATS_N_STRIPES 8
+
+typedef struct str_enchant_stats_counters
+{
+	gsize count;
+	gsize total_usecs;
+	gsize histogram[ENCHANT_STATS_N_BUCKETS];
+} EnchantStatsCounters;
+
+struct str_enchant_stats
+{
+	EnchantStatsCounters stripes[ENCHANT_STATS_N_STRIPES][ENCHANT_STATS_N_OPERATIONS];
+};
+
+static const char * const enchant_stats_operation_names[ENCHANT_STATS_N_OPERATIONS] =
+{
+	"check",
+	"check_many",
+	"suggest",
+	"add",
+	"remove",
+	"provider_check",
+	"provider_suggest",
+	"pwl_refresh",
+	"pwl_rewrite",
+	"request_dict"
+};
+
+/* the stripe of the thread plus one, 0 until it has one */
+static GPrivate enchant_stats_thread_stripe = G_PRIVATE_INIT (NULL);
+static gint enchant_stats_next_stripe;
+
+static guint
+enchant_stats_get_stripe (void)
+{
+	guint stripe = GPOINTER_TO_UINT (g_private_get (&enchant_stats_thread_stripe));
+
+	if (stripe == 0)
+		{
+			stripe = (guint) g_atomic_int_add (&enchant_stats_next_stripe, 1) % ENCHANT_STATS_N_STRIPES + 1;
+			g_private_set (&enchant_stats_thread_stripe, GUINT_TO_POINTER (stripe));
+		}
+
+	return stripe - 1;
+}
+
+EnchantStats*
+enchant_stats_new (void)
+{
+	return g_new0 (EnchantStats, 1);
+}
+
+void
+enchant_stats_free (EnchantStats * me)
+{
+	g_free (me);
+}
+
+void
+enchant_stats_record (EnchantStats * me, EnchantStatsOperation operation, gint64 start)
+{
+	EnchantStatsCounters * counters;
+	gint64 usecs;
+	guint bucket;
+
+	if (me == NULL)
+		return;
+
+	usecs = g_get_monotonic_time () - start;
+	if (usecs < 0)
+		usecs = 0;
+	bucket = usecs == 0 ? 0 : MIN (g_bit_storage ((gulong) usecs), ENCHANT_STATS_N_BUCKETS - 1);
+
+	counters = &me->stripes[enchant_stats_get_stripe ()][operation];
+	g_atomic_pointer_add (&counters->count, 1);
+	g_atomic_pointer_add (&counters->total_usecs, (gssize) usecs);
+	g_atomic_pointer_add (&counters->histogram[bucket], 1);
+}
+
+void
+enchant_stats_merge (EnchantStats * me, EnchantStats * src)
+{
+	EnchantStatsCounters counters;
+	int operation, i;
+
+	for (operation = 0; operation < ENCHANT_STATS_N_OPERATIONS; operation++)
+		{
+			enchant_stats_get (src, (EnchantStatsOperation) operation,
+					   &counters.count, &counters.total_usecs, counters.histogram);
+
+			g_atomic_pointer_add (&me->stripes[0][operation].count, (gssize) counters.count);
+			g_atomic_pointer_add (&me->stripes[0][operation].total_usecs, (gssize) counters.total_usecs);
+			for (i = 0; i < ENCHANT_STATS_N_BUCKETS; i++)
+				g_atomic_pointer_add (&me->stripes[0][operation].histogram[i], (gssize) counters.histogram[i]);
+		}
+}
+
+void
+enchant_stats_get (EnchantStats * me, EnchantStatsOperation operation,
+		   size_t * count, size_t * total_usecs, size_t * histogram)
+{
+	int stripe, i;
+
+	*count = 0;
+	*total_usecs = 0;
+	memset (histogram, 0, ENCHANT_STATS_N_BUCKETS * sizeof (size_t));
+
+	for (stripe = 0; stripe < ENCHANT_STATS_N_STRIPES; stripe++)
+		{
+			EnchantStatsCounters * counters = &me->stripes[stripe][operation];
+
+			*count += g_atomic_pointer_get (&counters->count);
+			*total_usecs += g_atomic_pointer_get (&counters->total_usecs);
+			for (i = 0; i < ENCHANT_STATS_N_BUCKETS; i++)
+				histogram[i] += g_atomic_pointer_get (&counters->histogram[i]);
+		}
+}
+
+const char*
+enchant_stats_operation_name (EnchantStatsOperation operation)
+{
+	return enchant_stats_operation_names[operation];
+}
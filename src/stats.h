@@ -0,0 +1,86 @@
+/* enchant
+ * Copyright (C) 2003 Dom Lachowicz
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02110-1301, USA.
+ *
+ * In addition, as a special exception, Dom Lachowicz
+ * gives permission to link the code of this program with
+ * non-LGPL Spelling Provider libraries (eg: a MSFT Office
+ * spell checker backend) and distribute linked combinations including
+ * the two.  You must obey the GNU Lesser General Public License in all
+ * respects for all of the code used other than said providers.  If you modify
+ * this file, you may extend this exception to your version of the
+ * file, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Counts and latency histograms of operations. Recording may be done from
+ * several threads at once: each thread adds to one of a few stripes of
+ * counters, so that threads seldom share a cache line, and reading adds the
+ * stripes up. */
+typedef struct str_enchant_stats EnchantStats;
+
+typedef enum
+{
+	ENCHANT_STATS_CHECK,
+	ENCHANT_STATS_CHECK_MANY,
+	ENCHANT_STATS_SUGGEST,
+	ENCHANT_STATS_ADD,
+	ENCHANT_STATS_REMOVE,
+	ENCHANT_STATS_PROVIDER_CHECK,
+	ENCHANT_STATS_PROVIDER_SUGGEST,
+	ENCHANT_STATS_PWL_REFRESH,
+	ENCHANT_STATS_PWL_REWRITE,
+	ENCHANT_STATS_REQUEST_DICT,
+	ENCHANT_STATS_N_OPERATIONS
+} EnchantStatsOperation;
+
+/* Bucket 0 counts the operations that took less than a microsecond,
+ * bucket i those that took at least 2^(i-1) and less than 2^i, and the
+ * last bucket all that took longer */
+#define ENCHANT_STATS_N_BUCKETS 20
+
+EnchantStats* enchant_stats_new(void);
+void enchant_stats_free(EnchantStats * me);
+
+/* Counts an @operation that started at the monotonic time @start; does
+ * nothing if @me is NULL */
+void enchant_stats_record(EnchantStats * me, EnchantStatsOperation operation, gint64 start);
+
+/* Adds the counts of @src to those of @me */
+void enchant_stats_merge(EnchantStats * me, EnchantStats * src);
+
+/* Stores the counts of @operation in @count, @total_usecs and the
+ * ENCHANT_STATS_N_BUCKETS items of @histogram */
+void enchant_stats_get(EnchantStats * me, EnchantStatsOperation operation,
+		       size_t * count, size_t * total_usecs, size_t * histogram);
+
+const char* enchant_stats_operation_name(EnchantStatsOperation operation);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATS_H */
@@ -0,0 +1,253 @@
+/* enchant
+ * Copyright (C) 2003 Dom Lachowicz
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02110-1301, USA.
+ *
+ * In addition, as a special exception, Dom Lachowicz
+ * gives permission to link the code of this program with
+ * non-LGPL Spelling Provider libraries (eg: a MSFT Office
+ * spell checker backend) and distribute linked combinations including
+ * the two.  You must obey the GNU Lesser General Public License in all
+ * respects for all of the code used other than said providers.  If you modify
+ * this file, you may extend this exception to your version of the
+ * file, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+/**
+ *
+ *  This file implements the sets of words added to and removed from a
+ *  session in the type EnchantWordSet.
+ *
+ *  The set is an open-addressed hash table with linear probing whose slots
+ *  point into a GStringChunk owned by the set, so neither adding nor
+ *  looking up a word needs a nul-terminated copy of it. A removed word
+ *  keeps its slot and its string, only marked absent, which spares the
+ *  probe sequences from tombstones and lets a word that comes and goes
+ *  reuse both. Once absent words fill more slots than present ones, the
+ *  table and the strings are rebuilt without them.
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "wordset.h"
+
+#define ENCHANT_WORD_SET_MIN_SLOTS 16
+#define ENCHANT_WORD_SET_CHUNK_SIZE 1024
+
+typedef struct str_enchant_word_set_slot
+{
+	const char *word;	/* NULL for a slot never used */
+	size_t len;
+	guint hash;
+	gboolean present;
+} EnchantWordSetSlot;
+
+struct str_enchant_word_set
+{
+	EnchantWordSetSlot *slots;
+	size_t n_slots;		/* a power of two, or 0 before the first word */
+	size_t n_used;		/* slots holding a word, present or not */
+	size_t n_present;
+	GStringChunk *words;
+};
+
+static guint
+enchant_word_set_hash (const char *const word, size_t len)
+{
+	/* the same function as g_str_hash, bounded by len */
+	guint hash = 5381;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		hash = (hash << 5) + hash + (guchar) word[i];
+
+	return hash;
+}
+
+static EnchantWordSetSlot *
+enchant_word_set_find (EnchantWordSet * me, const char *const word, size_t len, guint hash)
+{
+	size_t mask = me->n_slots - 1;
+	size_t i;
+
+	for (i = hash & mask; me->slots[i].word != NULL; i = (i + 1) & mask)
+		{
+			EnchantWordSetSlot *slot = &me->slots[i];
+
+			if (slot->hash == hash && slot->len == len &&
+			    memcmp (slot->word, word, len) == 0)
+				break;
+		}
+
+	return &me->slots[i];
+}
+
+static void
+enchant_word_set_grow (EnchantWordSet * me)
+{
+	EnchantWordSetSlot *old_slots = me->slots;
+	size_t old_n_slots = me->n_slots;
+	size_t i;
+
+	me->n_slots = old_n_slots ? old_n_slots * 2 : ENCHANT_WORD_SET_MIN_SLOTS;
+	me->slots = g_new0 (EnchantWordSetSlot, me->n_slots);
+
+	for (i = 0; i < old_n_slots; i++)
+		if (old_slots[i].word != NULL)
+			*enchant_word_set_find (me, old_slots[i].word, old_slots[i].len,
+						old_slots[i].hash) = old_slots[i];
+
+	g_free (old_slots);
+}
+
+/* Makes the table and the strings anew with only the words present */
+static void
+enchant_word_set_compact (EnchantWordSet * me)
+{
+	EnchantWordSetSlot *old_slots = me->slots;
+	GStringChunk *old_words = me->words;
+	size_t old_n_slots = me->n_slots;
+	size_t i;
+
+	me->slots = NULL;
+	me->n_slots = 0;
+	me->n_used = 0;
+	me->words = NULL;
+
+	if (me->n_present > 0)
+		{
+			me->n_slots = ENCHANT_WORD_SET_MIN_SLOTS;
+			while (me->n_present * 2 > me->n_slots)
+				me->n_slots *= 2;
+			me->slots = g_new0 (EnchantWordSetSlot, me->n_slots);
+			me->words = g_string_chunk_new (ENCHANT_WORD_SET_CHUNK_SIZE);
+
+			for (i = 0; i < old_n_slots; i++)
+				if (old_slots[i].present)
+					{
+						EnchantWordSetSlot *slot;
+
+						slot = enchant_word_set_find (me, old_slots[i].word, old_slots[i].len,
+									      old_slots[i].hash);
+						*slot = old_slots[i];
+						slot->word = g_string_chunk_insert_len (me->words, old_slots[i].word,
+											old_slots[i].len);
+						me->n_used++;
+					}
+		}
+
+	if (old_words)
+		g_string_chunk_free (old_words);
+	g_free (old_slots);
+}
+
+EnchantWordSet*
+enchant_word_set_new (void)
+{
+	/* the table and the string chunk are made on the first add */
+	return g_new0 (EnchantWordSet, 1);
+}
+
+void
+enchant_word_set_free (EnchantWordSet * me)
+{
+	g_return_if_fail (me);
+
+	if (me->words)
+		g_string_chunk_free (me->words);
+	g_free (me->slots);
+	g_free (me);
+}
+
+void
+enchant_word_set_add (EnchantWordSet * me, const char *const word, size_t len)
+{
+	EnchantWordSetSlot *slot;
+	guint hash;
+
+	g_return_if_fail (me);
+	g_return_if_fail (word);
+
+	/* keep at least half of the slots free */
+	if ((me->n_used + 1) * 2 > me->n_slots)
+		enchant_word_set_grow (me);
+
+	hash = enchant_word_set_hash (word, len);
+	slot = enchant_word_set_find (me, word, len, hash);
+	if (slot->word == NULL)
+		{
+			if (me->words == NULL)
+				me->words = g_string_chunk_new (ENCHANT_WORD_SET_CHUNK_SIZE);
+			slot->word = g_string_chunk_insert_len (me->words, word, len);
+			slot->len = len;
+			slot->hash = hash;
+			me->n_used++;
+		}
+
+	if (!slot->present)
+		{
+			slot->present = TRUE;
+			me->n_present++;
+		}
+}
+
+void
+enchant_word_set_remove (EnchantWordSet * me, const char *const word, size_t len)
+{
+	EnchantWordSetSlot *slot;
+
+	g_return_if_fail (me);
+	g_return_if_fail (word);
+
+	if (me->n_present == 0)
+		return;
+
+	slot = enchant_word_set_find (me, word, len, enchant_word_set_hash (word, len));
+	if (slot->present)
+		{
+			slot->present = FALSE;
+			me->n_present--;
+
+			if (me->n_used >= ENCHANT_WORD_SET_MIN_SLOTS / 2 && me->n_used > me->n_present * 2)
+				enchant_word_set_compact (me);
+		}
+}
+
+gboolean
+enchant_word_set_contains (EnchantWordSet * me, const char *const word, size_t len)
+{
+	g_return_val_if_fail (me, FALSE);
+	g_return_val_if_fail (word, FALSE);
+
+	if (me->n_present == 0)
+		return FALSE;
+
+	return enchant_word_set_find (me, word, len, enchant_word_set_hash (word, len))->present;
+}
+
+size_t
+enchant_word_set_size (EnchantWordSet * me)
+{
+	g_return_val_if_fail (me, 0);
+
+	return me->n_present;
+}
@@ -0,0 +1,157 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+#include <map>
+#include <string>
+
+struct DictMemory
+{
+    size_t n_bytes;
+    int in_use;
+};
+
+typedef std::map<std::string, DictMemory> DictMemoryMap;
+
+static void
+EnchantDictMemoryDescriber (const char * const lang_tag,
+                            size_t n_bytes,
+                            int in_use,
+                            void * user_data)
+{
+    DictMemoryMap * dicts = reinterpret_cast<DictMemoryMap*>(user_data);
+    DictMemory memory = { n_bytes, in_use };
+    (*dicts)[lang_tag] = memory;
+}
+
+static size_t
+GetMemoryUsage (EnchantDict *)
+{
+    return 1234;
+}
+
+static EnchantDict *
+RequestDictionary (EnchantProvider *me, const char *tag)
+{
+    EnchantDict * dict = MockEnGbAndQaaProviderRequestDictionary(me, tag);
+    if(dict && strcmp(tag, "en_GB") == 0)
+        dict->get_memory_usage = GetMemoryUsage;
+    return dict;
+}
+
+static void Describe_Dict_Memory_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantBrokerDescribeDictMemory_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerDescribeDictMemory_TestFixture():
+            EnchantBrokerTestFixture(Describe_Dict_Memory_ProviderConfiguration)
+    { }
+
+    DictMemoryMap Describe()
+    {
+        DictMemoryMap dicts;
+        enchant_broker_describe_dict_memory(_broker, EnchantDictMemoryDescriber, &dicts);
+        return dicts;
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+
+TEST_FIXTURE(EnchantBrokerDescribeDictMemory_TestFixture, 
+             EnchantBrokerDescribeDictMemory_NoDicts_NotCalled)
+{
+    CHECK(Describe().empty());
+}
+
+TEST_FIXTURE(EnchantBrokerDescribeDictMemory_TestFixture, 
+             EnchantBrokerDescribeDictMemory_DictInUse_Described)
+{
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+
+    DictMemoryMap dicts = Describe();
+    CHECK_EQUAL(1u, dicts.size());
+    CHECK_EQUAL(1234u, dicts["en_GB"].n_bytes);
+    CHECK_EQUAL(1, dicts["en_GB"].in_use);
+
+    enchant_broker_free_dict(_broker, dict);
+    CHECK(Describe().empty());
+}
+
+TEST_FIXTURE(EnchantBrokerDescribeDictMemory_TestFixture, 
+             EnchantBrokerDescribeDictMemory_NoEstimate_Zero)
+{
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "qaa");
+
+    DictMemoryMap dicts = Describe();
+    CHECK_EQUAL(1u, dicts.size());
+    CHECK_EQUAL(0u, dicts["qaa"].n_bytes);
+
+    enchant_broker_free_dict(_broker, dict);
+}
+
+TEST_FIXTURE(EnchantBrokerDescribeDictMemory_TestFixture, 
+             EnchantBrokerDescribeDictMemory_DictKeptForBudget_NotInUse)
+{
+    enchant_broker_set_dict_memory_budget(_broker, 10000);
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    enchant_broker_free_dict(_broker, dict);
+
+    DictMemoryMap dicts = Describe();
+    CHECK_EQUAL(1u, dicts.size());
+    CHECK_EQUAL(1234u, dicts["en_GB"].n_bytes);
+    CHECK_EQUAL(0, dicts["en_GB"].in_use);
+}
+
+TEST_FIXTURE(EnchantBrokerDescribeDictMemory_TestFixture, 
+             EnchantBrokerDescribeDictMemory_PwlDict_NotDescribed)
+{
+    EnchantDict* dict = enchant_broker_request_pwl_dict(_broker, GetTemporaryFilename("pwl").c_str());
+    CHECK(dict);
+
+    CHECK(Describe().empty());
+
+    enchant_broker_free_dict(_broker, dict);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+
+TEST_FIXTURE(EnchantBrokerDescribeDictMemory_TestFixture, 
+             EnchantBrokerDescribeDictMemory_NullBroker_DoNothing)
+{
+    DictMemoryMap dicts;
+    enchant_broker_describe_dict_memory(NULL, EnchantDictMemoryDescriber, &dicts);
+    CHECK(dicts.empty());
+}
+
+TEST_FIXTURE(EnchantBrokerDescribeDictMemory_TestFixture, 
+             EnchantBrokerDescribeDictMemory_NullFn_DoNothing)
+{
+    enchant_broker_describe_dict_memory(_broker, NULL, NULL);
+}
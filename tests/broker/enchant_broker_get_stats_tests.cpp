@@ -0,0 +1,195 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+#include <map>
+#include <string>
+
+typedef std::map<std::string, size_t> OperationCountMap;
+
+static void
+EnchantStatsCounter (const char * const provider_name,
+                     const char * const operation,
+                     size_t count,
+                     size_t,
+                     const size_t * const,
+                     size_t,
+                     void * user_data)
+{
+    OperationCountMap * counts = reinterpret_cast<OperationCountMap*>(user_data);
+    (*counts)[std::string(provider_name) + "/" + operation] = count;
+}
+
+static int
+CheckDictionary (EnchantDict *, const char *const, size_t)
+{
+    return 0;
+}
+
+static EnchantDict *
+RequestDictionary (EnchantProvider *me, const char *tag)
+{
+    EnchantDict * dict = MockEnGbAndQaaProviderRequestDictionary(me, tag);
+    if(dict)
+        dict->check = CheckDictionary;
+    return dict;
+}
+
+static void Get_Stats_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantBrokerGetStats_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerGetStats_TestFixture():
+            EnchantBrokerTestFixture(Get_Stats_ProviderConfiguration)
+    { 
+        enchant_broker_set_stats_enabled(_broker, 1);
+    }
+
+    OperationCountMap GetStats()
+    {
+        OperationCountMap counts;
+        enchant_broker_get_stats(_broker, EnchantStatsCounter, &counts);
+        return counts;
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture, 
+             EnchantBrokerGetStats_NothingDone_NothingReported)
+{
+    CHECK(GetStats().empty());
+}
+
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture, 
+             EnchantBrokerGetStats_RequestDict_CountedUnderProvider)
+{
+    EnchantDict* dict = RequestDictionary("en_GB");
+    CHECK(dict);
+
+    OperationCountMap counts = GetStats();
+    CHECK_EQUAL(1u, counts["mock/request_dict"]);
+
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture, 
+             EnchantBrokerGetStats_RequestDictForThread_Counted)
+{
+    EnchantDict* dict = enchant_broker_request_dict_for_thread(_broker, "en_GB");
+    CHECK(dict);
+
+    CHECK_EQUAL(2u, GetStats()["mock/request_dict"]);
+
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture, 
+             EnchantBrokerGetStats_DictInUse_Reported)
+{
+    EnchantDict* dict = RequestDictionary("en_GB");
+    enchant_dict_check(dict, "hello", -1);
+    enchant_dict_check(dict, "world", -1);
+
+    OperationCountMap counts = GetStats();
+    CHECK_EQUAL(2u, counts["mock/check"]);
+    CHECK_EQUAL(2u, counts["mock/provider_check"]);
+
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture, 
+             EnchantBrokerGetStats_DictFreed_StillReported)
+{
+    EnchantDict* dict = RequestDictionary("en_GB");
+    enchant_dict_check(dict, "hello", -1);
+    FreeDictionary(dict);
+
+    CHECK_EQUAL(1u, GetStats()["mock/check"]);
+}
+
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture, 
+             EnchantBrokerGetStats_SeveralDicts_Summed)
+{
+    EnchantDict* dict = RequestDictionary("en_GB");
+    EnchantDict* otherDict = RequestDictionary("qaa");
+    enchant_dict_check(dict, "hello", -1);
+    enchant_dict_check(otherDict, "hello", -1);
+    FreeDictionary(otherDict);
+    enchant_dict_check(dict, "world", -1);
+
+    OperationCountMap counts = GetStats();
+    CHECK_EQUAL(3u, counts["mock/check"]);
+    CHECK_EQUAL(2u, counts["mock/request_dict"]);
+
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture, 
+             EnchantBrokerGetStats_PersonalDict_CountedUnderPersonalWordlist)
+{
+    EnchantDict* dict = RequestPersonalDictionary();
+    enchant_dict_add(dict, "hello", -1);
+    enchant_dict_check(dict, "hello", -1);
+    FreeDictionary(dict);
+
+    OperationCountMap counts = GetStats();
+    CHECK_EQUAL(1u, counts["Personal Wordlist/add"]);
+    CHECK_EQUAL(1u, counts["Personal Wordlist/check"]);
+}
+
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture, 
+             EnchantBrokerGetStats_NotEnabled_NothingReported)
+{
+    enchant_broker_set_stats_enabled(_broker, 0);
+    EnchantDict* dict = RequestDictionary("en_GB");
+    enchant_dict_check(dict, "hello", -1);
+    FreeDictionary(dict);
+
+    CHECK(GetStats().empty());
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture, 
+             EnchantBrokerGetStats_NullBroker_DoNothing)
+{
+    OperationCountMap counts;
+    enchant_broker_get_stats(NULL, EnchantStatsCounter, &counts);
+    CHECK(counts.empty());
+}
+
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture, 
+             EnchantBrokerGetStats_NullFn_DoNothing)
+{
+    EnchantDict* dict = RequestDictionary("en_GB");
+    enchant_broker_get_stats(_broker, NULL, NULL);
+    FreeDictionary(dict);
+}
@@ -0,0 +1,333 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include <vector>
+#include "EnchantBrokerTestFixture.h"
+
+static int providerLoadCount;
+
+static void Lazy_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     providerLoadCount++;
+     me->request_dict = MockEnGbAndQaaProviderRequestDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+     me->list_dicts = MockEnGbProviderListDictionaries;
+}
+
+static void DescribeProvidersCallback (const char * const provider_name,
+                                       const char * const provider_desc,
+                                       const char * const provider_file,
+                                       void * user_data)
+{
+    std::vector<std::string>* providers = reinterpret_cast<std::vector<std::string>*>(user_data);
+    providers->push_back(std::string(provider_name) + "|" + provider_desc);
+    CHECK(strlen(provider_file) > 0);
+}
+
+static void ListDictionariesCallback (const char * const lang_tag,
+                                      const char * const,
+                                      const char * const,
+                                      const char * const,
+                                      void * user_data)
+{
+    std::vector<std::string>* tags = reinterpret_cast<std::vector<std::string>*>(user_data);
+    tags->push_back(lang_tag);
+}
+
+struct EnchantBrokerInitLazy_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerInitLazy_TestFixture():
+            EnchantBrokerTestFixture(Lazy_ProviderConfiguration)
+    { 
+        _dict = NULL;
+        // the first lazy broker writes the manifest, the second one uses it
+        ReinitializeLazyBroker();
+        ReinitializeLazyBroker();
+        providerLoadCount = 0;
+    }
+
+    //Teardown
+    ~EnchantBrokerInitLazy_TestFixture()
+    {
+        FreeDictionary(_dict);
+    }
+
+    void ReinitializeLazyBroker()
+    {
+        FreeDictionary(_dict);
+        _dict = NULL;
+        enchant_broker_free(_broker);
+        _broker = enchant_broker_init_lazy();
+    }
+
+    std::string GetManifestFilename()
+    {
+        return AddToPath(GetTempUserEnchantDir(), "providers.cache");
+    }
+
+    void SetManifestModuleTimes(gint64 mtime)
+    {
+        GKeyFile* manifest = g_key_file_new();
+        CHECK(g_key_file_load_from_file(manifest, GetManifestFilename().c_str(), G_KEY_FILE_NONE, NULL));
+
+        gchar** groups = g_key_file_get_groups(manifest, NULL);
+        for (gchar** group = groups; *group; group++)
+            g_key_file_set_int64(manifest, *group, "mtime", mtime);
+        g_strfreev(groups);
+
+        gsize length;
+        gchar* data = g_key_file_to_data(manifest, &length, NULL);
+        g_file_set_contents(GetManifestFilename().c_str(), data, length, NULL);
+        g_free(data);
+        g_key_file_free(manifest);
+    }
+
+    EnchantDict* _dict;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+
+TEST_FIXTURE(EnchantBrokerInitLazy_TestFixture, 
+             EnchantBrokerInitLazy_ManifestWritten)
+{
+    CHECK(FileExists(GetManifestFilename()));
+}
+
+TEST_FIXTURE(EnchantBrokerInitLazy_TestFixture, 
+             EnchantBrokerInitLazy_ManifestCurrent_ProviderNotLoaded)
+{
+    CHECK(_broker);
+    CHECK_EQUAL(0, providerLoadCount);
+}
+
+TEST_FIXTURE(EnchantBrokerInitLazy_TestFixture, 
+             EnchantBrokerInitLazy_NoManifest_ProviderLoaded)
+{
+    DeleteFile(GetManifestFilename());
+    ReinitializeLazyBroker();
+    CHECK_EQUAL(1, providerLoadCount);
+    CHECK(FileExists(GetManifestFilename()));
+}
+
+TEST_FIXTURE(EnchantBrokerInitLazy_TestFixture, 
+             EnchantBrokerInitLazy_CorruptManifest_RebuiltOnce)
+{
+    g_file_set_contents(GetManifestFilename().c_str(), "[\n\xa5\xf1\x08", -1, NULL);
+    ReinitializeLazyBroker();
+    CHECK_EQUAL(1, providerLoadCount);
+
+    ReinitializeLazyBroker();
+    CHECK_EQUAL(1, providerLoadCount);
+}
+
+TEST_FIXTURE(EnchantBrokerInitLazy_TestFixture, 
+             EnchantBrokerInitLazy_ModuleChanged_ProviderLoaded)
+{
+    SetManifestModuleTimes(0);
+    ReinitializeLazyBroker();
+    CHECK_EQUAL(1, providerLoadCount);
+
+    ReinitializeLazyBroker();
+    CHECK_EQUAL(1, providerLoadCount);
+}
+
+TEST_FIXTURE(EnchantBrokerInitLazy_TestFixture, 
+             EnchantBrokerInitLazy_RequestDict_ProviderLoaded)
+{
+    _dict = enchant_broker_request_dict(_broker, "en_GB");
+    CHECK(_dict);
+    CHECK_EQUAL(1, providerLoadCount);
+}
+
+TEST_FIXTURE(EnchantBrokerInitLazy_TestFixture, 
+             EnchantBrokerInitLazy_RequestDictTwice_ProviderLoadedOnce)
+{
+    _dict = enchant_broker_request_dict(_broker, "en_GB");
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "qaa");
+    CHECK(dict);
+    FreeDictionary(dict);
+    CHECK_EQUAL(1, providerLoadCount);
+}
+
+TEST_FIXTURE(EnchantBrokerInitLazy_TestFixture, 
+             EnchantBrokerInitLazy_RequestDictNotListedByProvider_Found)
+{
+    _dict = enchant_broker_request_dict(_broker, "qaa");
+    CHECK(_dict);
+    CHECK_EQUAL(1, providerLoadCount);
+}
+
+TEST_FIXTURE(EnchantBrokerInitLazy_TestFixture, 
+             EnchantBrokerInitLazy_RequestDictNoProviderHas_Null)
+{
+    _dict = enchant_broker_request_dict(_broker, "xx");
+    CHECK_EQUAL((void*)NULL, (void*)_dict);
+}
+
+TEST_FIXTURE(EnchantBrokerInitLazy_TestFixture, 
+             EnchantBrokerInitLazy_DictExists)
+{
+    CHECK_EQUAL(1, enchant_broker_dict_exists(_broker, "en_GB"));
+    CHECK_EQUAL(0, enchant_broker_dict_exists(_broker, "xx"));
+}
+
+TEST_FIXTURE(EnchantBrokerInitLazy_TestFixture, 
+             EnchantBrokerInitLazy_Describe_ProviderNotLoaded)
+{
+    std::vector<std::string> providers;
+    enchant_broker_describe(_broker, DescribeProvidersCallback, &providers);
+
+    CHECK_EQUAL(1, providers.size());
+    if (providers.size() == 1)
+        CHECK_EQUAL("mock|Mock Provider", providers[0]);
+    CHECK_EQUAL(0, providerLoadCount);
+}
+
+TEST_FIXTURE(EnchantBrokerInitLazy_TestFixture, 
+             EnchantBrokerInitLazy_ListDicts_ProviderLoaded)
+{
+    std::vector<std::string> tags;
+    enchant_broker_list_dicts(_broker, ListDictionariesCallback, &tags);
+
+    CHECK_EQUAL(1, tags.size());
+    if (tags.size() == 1)
+        CHECK_EQUAL("en_GB", tags[0]);
+    CHECK_EQUAL(1, providerLoadCount);
+}
+
+TEST_FIXTURE(EnchantBrokerInitLazy_TestFixture, 
+             EnchantBrokerInitLazy_RequestPwlDict_ProviderNotLoaded)
+{
+    EnchantDict* dict = RequestPersonalDictionary();
+    CHECK(dict);
+    FreeDictionary(dict);
+    CHECK_EQUAL(0, providerLoadCount);
+}
+
+// mock1 is preferred, and gets the qaa dictionary after the manifest is written
+static bool qaaInstalled;
+static const char * requestedFrom;
+
+static const char *
+MockProvider1Identify (EnchantProvider *)
+{
+    return "mock1";
+}
+
+static const char *
+MockProvider2Identify (EnchantProvider *)
+{
+    return "mock2";
+}
+
+static char **
+ListDictionaries1 (EnchantProvider * me, size_t * out_n_dicts)
+{
+    return qaaInstalled ? MockEnGbAndQaaProviderListDictionaries(me, out_n_dicts)
+                        : MockEnGbProviderListDictionaries(me, out_n_dicts);
+}
+
+static EnchantDict *
+RequestDictionary1 (EnchantProvider * me, const char * tag)
+{
+    if(strcmp(tag, "qaa") == 0 && !qaaInstalled)
+        return NULL;
+    requestedFrom = "mock1";
+    return MockEnGbAndQaaProviderRequestDictionary(me, tag);
+}
+
+static EnchantDict *
+RequestDictionary2 (EnchantProvider * me, const char * tag)
+{
+    requestedFrom = "mock2";
+    return MockEnGbAndQaaProviderRequestDictionary(me, tag);
+}
+
+static void Lazy_ProviderConfiguration1 (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary1;
+     me->dispose_dict = MockProviderDisposeDictionary;
+     me->list_dicts = ListDictionaries1;
+     me->identify = MockProvider1Identify;
+}
+
+static void Lazy_ProviderConfiguration2 (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary2;
+     me->dispose_dict = MockProviderDisposeDictionary;
+     me->list_dicts = MockEnGbAndQaaProviderListDictionaries;
+     me->identify = MockProvider2Identify;
+}
+
+struct EnchantBrokerInitLazyOrdering_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerInitLazyOrdering_TestFixture():
+            EnchantBrokerTestFixture(Lazy_ProviderConfiguration1, Lazy_ProviderConfiguration2)
+    { 
+        qaaInstalled = false;
+        requestedFrom = NULL;
+        // the first lazy broker writes the manifest
+        enchant_broker_free(_broker);
+        _broker = enchant_broker_init_lazy();
+        enchant_broker_free(_broker);
+        _broker = enchant_broker_init_lazy();
+        enchant_broker_set_ordering(_broker, "*", "mock1,mock2");
+    }
+};
+
+TEST_FIXTURE(EnchantBrokerInitLazyOrdering_TestFixture, 
+             EnchantBrokerInitLazy_DictInstalledSinceManifest_OrderingKept)
+{
+    qaaInstalled = true;
+
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "qaa");
+    CHECK(dict);
+    CHECK_EQUAL("mock1", requestedFrom);
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerInitLazyOrdering_TestFixture, 
+             EnchantBrokerInitLazy_DictNotInstalled_NextProviderChosen)
+{
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "qaa");
+    CHECK(dict);
+    CHECK_EQUAL("mock2", requestedFrom);
+    FreeDictionary(dict);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+
+TEST_FIXTURE(EnchantBrokerInitLazy_TestFixture, 
+             EnchantBrokerInitLazy_ManifestNotWritable_ProvidersStillFound)
+{
+    DeleteFile(GetManifestFilename());
+    CreateDirectory(GetManifestFilename());
+    ReinitializeLazyBroker();
+    _dict = enchant_broker_request_dict(_broker, "en_GB");
+    CHECK(_dict);
+    g_rmdir(GetManifestFilename().c_str());
+}
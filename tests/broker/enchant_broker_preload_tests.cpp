@@ -0,0 +1,350 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+
+static gint requestDictionaryCount;
+static gint disposeDictionaryCount;
+static gint concurrentRequests;
+static gint maxConcurrentRequests;
+static gint requestsToWaitFor;
+static gint gateOpen;
+
+/* Holds each request until requestsToWaitFor requests are in the provider
+ * at once, or the gate is opened, giving up after a few seconds */
+static void
+WaitAtGate()
+{
+    gint concurrent = g_atomic_int_add(&concurrentRequests, 1) + 1;
+    gint max = g_atomic_int_get(&maxConcurrentRequests);
+    while(concurrent > max && !g_atomic_int_compare_and_exchange(&maxConcurrentRequests, max, concurrent))
+    {
+        max = g_atomic_int_get(&maxConcurrentRequests);
+    }
+
+    for(int i = 0; i < 500; ++i)
+    {
+        if(g_atomic_int_get(&gateOpen) ||
+           g_atomic_int_get(&maxConcurrentRequests) >= g_atomic_int_get(&requestsToWaitFor))
+            break;
+        g_usleep(10000);
+    }
+
+    g_atomic_int_add(&concurrentRequests, -1);
+}
+
+static EnchantDict *
+RequestDictionary (EnchantProvider *me, const char *tag)
+{
+    WaitAtGate();
+    EnchantDict * dict = MockEnGbAndQaaProviderRequestDictionary(me, tag);
+    if(dict)
+        g_atomic_int_inc(&requestDictionaryCount);
+    return dict;
+}
+
+static void
+DisposeDictionary (EnchantProvider *me, EnchantDict * dict)
+{
+    g_atomic_int_inc(&disposeDictionaryCount);
+    MockProviderDisposeDictionary(me, dict);
+}
+
+static void Preload_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary;
+     me->dispose_dict = DisposeDictionary;
+     me->dictionary_exists = MockEnGbAndQaaProviderDictionaryExists;
+     me->concurrent_request_dict = 1;
+}
+
+struct EnchantBrokerPreload_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerPreload_TestFixture():
+            EnchantBrokerTestFixture(Preload_ProviderConfiguration)
+    { 
+        requestDictionaryCount = 0;
+        disposeDictionaryCount = 0;
+        concurrentRequests = 0;
+        maxConcurrentRequests = 0;
+        requestsToWaitFor = 1;
+        gateOpen = 0;
+    }
+};
+
+static void Preload_SerialProviderConfiguration (EnchantProvider * me, const char * dir_name)
+{
+     Preload_ProviderConfiguration(me, dir_name);
+     me->concurrent_request_dict = 0;
+}
+
+struct EnchantBrokerPreloadSerial_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerPreloadSerial_TestFixture():
+            EnchantBrokerTestFixture(Preload_SerialProviderConfiguration)
+    { 
+        requestDictionaryCount = 0;
+        disposeDictionaryCount = 0;
+        concurrentRequests = 0;
+        maxConcurrentRequests = 0;
+        requestsToWaitFor = 100;
+        gateOpen = 0;
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerPreload_AfterWait_DictIsReady)
+{
+    const char * tags[] = {"en_GB"};
+    enchant_broker_preload(_broker, tags, 1);
+    enchant_broker_preload_wait(_broker);
+
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "en_GB"));
+    CHECK_EQUAL(1, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerPreload_RequestAfterPreload_NotLoadedAgain)
+{
+    const char * tags[] = {"en_GB"};
+    enchant_broker_preload(_broker, tags, 1);
+    enchant_broker_preload_wait(_broker);
+
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    CHECK(dict);
+    CHECK_EQUAL(1, requestDictionaryCount);
+
+    enchant_broker_free_dict(_broker, dict);
+    CHECK_EQUAL(0, disposeDictionaryCount);
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "en_GB"));
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerPreload_BrokerFreed_PreloadedDictDisposed)
+{
+    const char * tags[] = {"en_GB", "qaa"};
+    enchant_broker_preload(_broker, tags, 2);
+    enchant_broker_preload_wait(_broker);
+
+    enchant_broker_free(_broker);
+    _broker = NULL;
+    CHECK_EQUAL(2, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerPreload_BrokerFreedWithoutWaiting_DoesNotCrash)
+{
+    const char * tags[] = {"en_GB", "qaa", "en", "en_US"};
+    enchant_broker_preload(_broker, tags, 4);
+
+    enchant_broker_free(_broker);
+    _broker = NULL;
+    CHECK_EQUAL(requestDictionaryCount, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerPreload_TagsLoadInParallel)
+{
+    requestsToWaitFor = 2;
+    const char * tags[] = {"en_GB", "qaa"};
+    enchant_broker_preload(_broker, tags, 2);
+    enchant_broker_preload_wait(_broker);
+
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "en_GB"));
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "qaa"));
+    if(g_get_num_processors() > 1)
+    {
+        CHECK_EQUAL(2, maxConcurrentRequests);
+    }
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerPreload_WhileLoading_NotReady)
+{
+    requestsToWaitFor = 100;
+    const char * tags[] = {"en_GB"};
+    enchant_broker_preload(_broker, tags, 1);
+
+    CHECK_EQUAL(0, enchant_broker_dict_is_ready(_broker, "en_GB"));
+
+    g_atomic_int_set(&gateOpen, 1);
+    enchant_broker_preload_wait(_broker);
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "en_GB"));
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerPreload_RequestedWhileLoading_OneDictKept)
+{
+    requestsToWaitFor = 2;
+    const char * tags[] = {"en_GB"};
+    enchant_broker_preload(_broker, tags, 1);
+
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    enchant_broker_preload_wait(_broker);
+    CHECK(dict);
+
+    EnchantDict* otherDict = enchant_broker_request_dict(_broker, "en_GB");
+    CHECK_EQUAL(dict, otherDict);
+    CHECK_EQUAL(requestDictionaryCount - 1, disposeDictionaryCount);
+
+    enchant_broker_free_dict(_broker, dict);
+    enchant_broker_free_dict(_broker, otherDict);
+}
+
+TEST_FIXTURE(EnchantBrokerPreloadSerial_TestFixture, 
+             EnchantBrokerPreload_SerialProviderLoading_BrokerNotBlocked)
+{
+    const char * tags[] = {"en_GB"};
+    enchant_broker_preload(_broker, tags, 1);
+    while(g_atomic_int_get(&concurrentRequests) == 0)
+        g_usleep(1000);
+
+    CHECK_EQUAL(0, enchant_broker_dict_is_ready(_broker, "en_GB"));
+
+    g_atomic_int_set(&gateOpen, 1);
+    enchant_broker_preload_wait(_broker);
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "en_GB"));
+}
+
+TEST_FIXTURE(EnchantBrokerPreloadSerial_TestFixture, 
+             EnchantBrokerPreload_SerialProvider_LoadsOneAtATime)
+{
+    g_atomic_int_set(&gateOpen, 1);
+    const char * tags[] = {"en_GB", "qaa"};
+    enchant_broker_preload(_broker, tags, 2);
+    enchant_broker_preload_wait(_broker);
+
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "en_GB"));
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "qaa"));
+    CHECK_EQUAL(1, maxConcurrentRequests);
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerPreload_SameTagTwice_LoadedOnce)
+{
+    const char * tags[] = {"en_GB", "en-gb"};
+    enchant_broker_preload(_broker, tags, 2);
+    enchant_broker_preload(_broker, tags, 1);
+    enchant_broker_preload_wait(_broker);
+
+    CHECK_EQUAL(1, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerPreload_FallsBackToLanguage_Ready)
+{
+    const char * tags[] = {"qaa_CA"};
+    enchant_broker_preload(_broker, tags, 1);
+    enchant_broker_preload_wait(_broker);
+
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "qaa_CA"));
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerPreload_NoDictionary_NotReady)
+{
+    const char * tags[] = {"xx"};
+    enchant_broker_preload(_broker, tags, 1);
+    enchant_broker_preload_wait(_broker);
+
+    CHECK_EQUAL(-1, enchant_broker_dict_is_ready(_broker, "xx"));
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerPreload_NoTags_DoNothing)
+{
+    enchant_broker_preload(_broker, NULL, 0);
+    enchant_broker_preload_wait(_broker);
+    CHECK_EQUAL(0, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerDictIsReady_NotRequested_NotReady)
+{
+    CHECK_EQUAL(-1, enchant_broker_dict_is_ready(_broker, "en_GB"));
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerDictIsReady_Requested_Ready)
+{
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "en_GB"));
+    enchant_broker_free_dict(_broker, dict);
+    CHECK_EQUAL(-1, enchant_broker_dict_is_ready(_broker, "en_GB"));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerPreload_InvalidTag_SetsError)
+{
+    const char * tags[] = {"en_GB", "en~US"};
+    enchant_broker_preload(_broker, tags, 2);
+    CHECK(NULL != enchant_broker_get_error(_broker));
+    enchant_broker_preload_wait(_broker);
+
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "en_GB"));
+    CHECK_EQUAL(-1, enchant_broker_dict_is_ready(_broker, "en~US"));
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerPreload_NullTag_DoNothing)
+{
+    const char * tags[] = {"en_GB", NULL};
+    enchant_broker_preload(_broker, tags, 2);
+    enchant_broker_preload_wait(_broker);
+    CHECK_EQUAL(0, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerPreload_NullTags_DoNothing)
+{
+    enchant_broker_preload(_broker, NULL, 1);
+    enchant_broker_preload_wait(_broker);
+    CHECK_EQUAL(0, requestDictionaryCount);
+}
+
+TEST(EnchantBrokerPreload_NullBroker_DoNothing)
+{
+    const char * tags[] = {"en_GB"};
+    enchant_broker_preload(NULL, tags, 1);
+    enchant_broker_preload_wait(NULL);
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerDictIsReady_NullBroker_NotReady)
+{
+    CHECK_EQUAL(-1, enchant_broker_dict_is_ready(NULL, "en_GB"));
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture, 
+             EnchantBrokerDictIsReady_NullTag_NotReady)
+{
+    CHECK_EQUAL(-1, enchant_broker_dict_is_ready(_broker, NULL));
+}
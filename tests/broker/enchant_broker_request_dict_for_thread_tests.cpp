@@ -0,0 +1,252 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+
+static int requestDictionaryCount; // dictionaries opened
+static int disposeDictionaryCount;
+static bool failRequests;
+
+static EnchantDict * RequestDictionary (EnchantProvider *me, const char *tag)
+{
+    if(failRequests)
+        return NULL;
+    EnchantDict * dict = MockEnGbAndQaaProviderRequestDictionary(me, tag);
+    if(dict)
+        requestDictionaryCount++;
+    return dict;
+}
+
+static void DisposeDictionary (EnchantProvider *me, EnchantDict * dict)
+{
+    disposeDictionaryCount++;
+    MockProviderDisposeDictionary(me, dict);
+}
+
+static void Request_Dictionary_For_Thread_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary;
+     me->dispose_dict = DisposeDictionary;
+}
+
+struct EnchantBrokerRequestDictionaryForThread_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerRequestDictionaryForThread_TestFixture():
+            EnchantBrokerTestFixture(Request_Dictionary_For_Thread_ProviderConfiguration)
+    { 
+        _dict = NULL;
+        requestDictionaryCount = 0;
+        disposeDictionaryCount = 0;
+        failRequests = false;
+    }
+
+    //Teardown
+    ~EnchantBrokerRequestDictionaryForThread_TestFixture()
+    {
+        FreeDictionary(_dict);
+    }
+
+    EnchantDict* _dict;
+};
+
+struct ThreadRequest
+{
+    EnchantBroker* broker;
+    EnchantDict* dict;
+};
+
+static gpointer
+RequestDictionaryInThread(gpointer data)
+{
+    ThreadRequest* request = static_cast<ThreadRequest*>(data);
+    request->dict = enchant_broker_request_dict_for_thread(request->broker, "en_GB");
+    return NULL;
+}
+
+static gpointer
+FreeDictionaryInThread(gpointer data)
+{
+    ThreadRequest* request = static_cast<ThreadRequest*>(data);
+    enchant_broker_free_dict(request->broker, request->dict);
+    return NULL;
+}
+
+static void
+RunInThread(GThreadFunc func, ThreadRequest* request)
+{
+    g_thread_join(g_thread_new("enchant test", func, request));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+
+TEST_FIXTURE(EnchantBrokerRequestDictionaryForThread_TestFixture, 
+             EnchantBrokerRequestDictionaryForThread_ProviderHas_OpensSharedAndThreadDictionaries)
+{
+    _dict = enchant_broker_request_dict_for_thread(_broker, "en_GB");
+    CHECK(_dict);
+    CHECK_EQUAL(2, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionaryForThread_TestFixture, 
+             EnchantBrokerRequestDictionaryForThread_NotTheSharedDictionary)
+{
+    EnchantDict* shared = enchant_broker_request_dict(_broker, "en_GB");
+    _dict = enchant_broker_request_dict_for_thread(_broker, "en_GB");
+    CHECK(_dict);
+    CHECK(shared != _dict);
+    FreeDictionary(shared);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionaryForThread_TestFixture, 
+             EnchantBrokerRequestDictionaryForThread_CalledTwiceInSameThread_ReturnsSame)
+{
+    _dict = enchant_broker_request_dict_for_thread(_broker, "en_GB");
+    EnchantDict* dict = enchant_broker_request_dict_for_thread(_broker, "en_GB");
+    CHECK_EQUAL(_dict, dict);
+    CHECK_EQUAL(2, requestDictionaryCount);
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionaryForThread_TestFixture, 
+             EnchantBrokerRequestDictionaryForThread_OtherThread_ReturnsOwnDictionary)
+{
+    _dict = enchant_broker_request_dict_for_thread(_broker, "en_GB");
+
+    ThreadRequest request = { _broker, NULL };
+    RunInThread(RequestDictionaryInThread, &request);
+
+    CHECK(request.dict);
+    CHECK(request.dict != _dict);
+    CHECK_EQUAL(3, requestDictionaryCount);
+
+    RunInThread(FreeDictionaryInThread, &request);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionaryForThread_TestFixture, 
+             EnchantBrokerRequestDictionaryForThread_SharesSessionWithSharedDictionary)
+{
+    EnchantDict* shared = enchant_broker_request_dict(_broker, "en_GB");
+    _dict = enchant_broker_request_dict_for_thread(_broker, "en_GB");
+
+    enchant_dict_add_to_session(shared, "hello", -1);
+    CHECK(enchant_dict_is_added(_dict, "hello", -1));
+
+    enchant_dict_remove_from_session(_dict, "hello", -1);
+    CHECK(enchant_dict_is_removed(shared, "hello", -1));
+
+    FreeDictionary(shared);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionaryForThread_TestFixture, 
+             EnchantBrokerRequestDictionaryForThread_SessionKeptUntilLastDictionaryFreed)
+{
+    EnchantDict* shared = enchant_broker_request_dict(_broker, "en_GB");
+    _dict = enchant_broker_request_dict_for_thread(_broker, "en_GB");
+    enchant_dict_add_to_session(shared, "hello", -1);
+
+    FreeDictionary(shared);
+    CHECK(enchant_dict_is_added(_dict, "hello", -1));
+    CHECK_EQUAL(0, disposeDictionaryCount);
+
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    CHECK(enchant_dict_is_added(dict, "hello", -1));
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionaryForThread_TestFixture, 
+             EnchantBrokerRequestDictionaryForThread_Freed_DisposesBothDictionaries)
+{
+    _dict = enchant_broker_request_dict_for_thread(_broker, "en_GB");
+    FreeDictionary(_dict);
+    _dict = NULL;
+
+    CHECK_EQUAL(2, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionaryForThread_TestFixture, 
+             EnchantBrokerRequestDictionaryForThread_ProviderHasBase_Finds)
+{
+    _dict = enchant_broker_request_dict_for_thread(_broker, "qaa_CA");
+    CHECK(_dict);
+    CHECK_EQUAL(2, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionaryForThread_TestFixture, 
+             EnchantBrokerRequestDictionaryForThread_ProviderCannotOpenAnother_ReturnsShared)
+{
+    EnchantDict* shared = enchant_broker_request_dict(_broker, "en_GB");
+    failRequests = true;
+    _dict = enchant_broker_request_dict_for_thread(_broker, "en_GB");
+    CHECK_EQUAL(shared, _dict);
+    FreeDictionary(shared);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionaryForThread_TestFixture, 
+             EnchantBrokerRequestDictionaryForThread_NotFreed_FreedWithBroker)
+{
+    EnchantDict* dict = enchant_broker_request_dict_for_thread(_broker, "en_GB");
+    CHECK(dict);
+    enchant_broker_free(_broker);
+    _broker = NULL;
+    CHECK_EQUAL(2, disposeDictionaryCount);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantBrokerRequestDictionaryForThread_TestFixture,
+             EnchantBrokerRequestDictionaryForThread_NullBroker_NULL)
+{
+    _dict = enchant_broker_request_dict_for_thread(NULL, "en_GB");
+
+    CHECK_EQUAL((void*)NULL, (void*)_dict);
+    CHECK_EQUAL(0, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionaryForThread_TestFixture,
+             EnchantBrokerRequestDictionaryForThread_NullLanguageTag_NULL)
+{
+    _dict = enchant_broker_request_dict_for_thread(_broker, NULL);
+
+    CHECK_EQUAL((void*)NULL, (void*)_dict);
+    CHECK_EQUAL(0, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionaryForThread_TestFixture,
+             EnchantBrokerRequestDictionaryForThread_ProviderDoesNotHave_NULL)
+{
+    _dict = enchant_broker_request_dict_for_thread(_broker, "en");
+
+    CHECK_EQUAL((void*)NULL, (void*)_dict);
+    CHECK_EQUAL(0, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionaryForThread_TestFixture,
+             EnchantBrokerRequestDictionaryForThread_InvalidTag_NULLAndError)
+{
+    _dict = enchant_broker_request_dict_for_thread(_broker, "en~US");
+
+    CHECK_EQUAL((void*)NULL, (void*)_dict);
+    CHECK(enchant_broker_get_error(_broker));
+}
@@ -0,0 +1,242 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+#include <string>
+
+static int requestDictionaryCount;
+static int disposeDictionaryCount;
+static std::string disposedTags;
+
+static size_t
+GetMemoryUsage (EnchantDict * dict)
+{
+    return strcmp((const char *) dict->user_data, "qaa") == 0 ? 2000 : 1000;
+}
+
+static EnchantDict *
+RequestDictionary (EnchantProvider *, const char *tag)
+{
+    if(strcmp(tag, "en_GB") != 0 && strcmp(tag, "fr_FR") != 0 && strcmp(tag, "qaa") != 0 &&
+       strcmp(tag, "de_DE") != 0 && strcmp(tag, "es_ES") != 0)
+        return NULL;
+
+    EnchantDict * dict = g_new0(EnchantDict, 1);
+    dict->user_data = g_strdup(tag);
+    // the provider cannot tell the size of de_DE and es_ES
+    if(strcmp(tag, "de_DE") != 0 && strcmp(tag, "es_ES") != 0)
+        dict->get_memory_usage = GetMemoryUsage;
+    requestDictionaryCount++;
+    return dict;
+}
+
+static void
+DisposeDictionary (EnchantProvider *, EnchantDict * dict)
+{
+    disposeDictionaryCount++;
+    disposedTags += (const char *) dict->user_data;
+    disposedTags += " ";
+    g_free(dict->user_data);
+    g_free(dict);
+}
+
+static void Memory_Budget_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary;
+     me->dispose_dict = DisposeDictionary;
+}
+
+struct EnchantBrokerSetDictMemoryBudget_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerSetDictMemoryBudget_TestFixture():
+            EnchantBrokerTestFixture(Memory_Budget_ProviderConfiguration)
+    { 
+        requestDictionaryCount = 0;
+        disposeDictionaryCount = 0;
+        disposedTags.clear();
+    }
+
+    void RequestAndFree(const char * tag)
+    {
+        EnchantDict* dict = enchant_broker_request_dict(_broker, tag);
+        CHECK(dict);
+        enchant_broker_free_dict(_broker, dict);
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+
+TEST_FIXTURE(EnchantBrokerSetDictMemoryBudget_TestFixture, 
+             EnchantBrokerSetDictMemoryBudget_NotSet_DictFreedWhenUnused)
+{
+    RequestAndFree("en_GB");
+    CHECK_EQUAL(1, disposeDictionaryCount);
+
+    RequestAndFree("en_GB");
+    CHECK_EQUAL(2, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictMemoryBudget_TestFixture, 
+             EnchantBrokerSetDictMemoryBudget_WithinBudget_DictKeptWhenUnused)
+{
+    enchant_broker_set_dict_memory_budget(_broker, 10000);
+
+    RequestAndFree("en_GB");
+    CHECK_EQUAL(0, disposeDictionaryCount);
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "en_GB"));
+
+    RequestAndFree("en_GB");
+    CHECK_EQUAL(1, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictMemoryBudget_TestFixture, 
+             EnchantBrokerSetDictMemoryBudget_OverBudget_LeastRecentlyUsedFreed)
+{
+    enchant_broker_set_dict_memory_budget(_broker, 3000);
+
+    RequestAndFree("en_GB");
+    RequestAndFree("fr_FR");
+    RequestAndFree("en_GB");
+    CHECK_EQUAL(0, disposeDictionaryCount);
+
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "qaa");
+    CHECK_EQUAL(std::string("fr_FR "), disposedTags);
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "en_GB"));
+
+    enchant_broker_free_dict(_broker, dict);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictMemoryBudget_TestFixture, 
+             EnchantBrokerSetDictMemoryBudget_Preloaded_FreedOverBudget)
+{
+    enchant_broker_set_dict_memory_budget(_broker, 3000);
+
+    const char * tags[] = {"en_GB", "fr_FR"};
+    enchant_broker_preload(_broker, tags, 2);
+    enchant_broker_preload_wait(_broker);
+    CHECK_EQUAL(0, disposeDictionaryCount);
+
+    RequestAndFree("qaa");
+    CHECK_EQUAL(1, disposeDictionaryCount);
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "qaa"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictMemoryBudget_TestFixture, 
+             EnchantBrokerSetDictMemoryBudget_SetAfterPreload_PreloadedFreed)
+{
+    const char * tags[] = {"en_GB"};
+    enchant_broker_preload(_broker, tags, 1);
+    enchant_broker_preload_wait(_broker);
+
+    enchant_broker_set_dict_memory_budget(_broker, 500);
+    CHECK_EQUAL(1, disposeDictionaryCount);
+    CHECK_EQUAL(-1, enchant_broker_dict_is_ready(_broker, "en_GB"));
+
+    enchant_broker_preload(_broker, tags, 1);
+    enchant_broker_preload_wait(_broker);
+    CHECK_EQUAL(2, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictMemoryBudget_TestFixture, 
+             EnchantBrokerSetDictMemoryBudget_DictsInUse_NotFreed)
+{
+    enchant_broker_set_dict_memory_budget(_broker, 500);
+
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    EnchantDict* otherDict = enchant_broker_request_dict(_broker, "qaa");
+    CHECK_EQUAL(0, disposeDictionaryCount);
+
+    enchant_broker_free_dict(_broker, dict);
+    CHECK_EQUAL(std::string("en_GB "), disposedTags);
+
+    enchant_broker_free_dict(_broker, otherDict);
+    CHECK_EQUAL(2, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictMemoryBudget_TestFixture, 
+             EnchantBrokerSetDictMemoryBudget_SizeUnknown_CountedAgainstBudget)
+{
+    enchant_broker_set_dict_memory_budget(_broker, 10000);
+
+    RequestAndFree("de_DE");
+    CHECK_EQUAL(std::string("de_DE "), disposedTags);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictMemoryBudget_TestFixture, 
+             EnchantBrokerSetDictMemoryBudget_SizesUnknown_LeastRecentlyUsedFreed)
+{
+    enchant_broker_set_dict_memory_budget(_broker, 6 * 1024 * 1024);
+
+    RequestAndFree("de_DE");
+    CHECK_EQUAL(0, disposeDictionaryCount);
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "de_DE"));
+
+    RequestAndFree("es_ES");
+    CHECK_EQUAL(std::string("de_DE "), disposedTags);
+    CHECK_EQUAL(1, enchant_broker_dict_is_ready(_broker, "es_ES"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictMemoryBudget_TestFixture, 
+             EnchantBrokerSetDictMemoryBudget_Lowered_UnusedDictsFreed)
+{
+    enchant_broker_set_dict_memory_budget(_broker, 10000);
+    RequestAndFree("en_GB");
+    RequestAndFree("qaa");
+
+    enchant_broker_set_dict_memory_budget(_broker, 2500);
+    CHECK_EQUAL(std::string("en_GB "), disposedTags);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictMemoryBudget_TestFixture, 
+             EnchantBrokerSetDictMemoryBudget_SetToZero_UnusedDictsFreed)
+{
+    enchant_broker_set_dict_memory_budget(_broker, 10000);
+    RequestAndFree("en_GB");
+    RequestAndFree("qaa");
+
+    enchant_broker_set_dict_memory_budget(_broker, 0);
+    CHECK_EQUAL(2, disposeDictionaryCount);
+    CHECK_EQUAL(-1, enchant_broker_dict_is_ready(_broker, "en_GB"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictMemoryBudget_TestFixture, 
+             EnchantBrokerSetDictMemoryBudget_BrokerFreed_KeptDictsFreed)
+{
+    enchant_broker_set_dict_memory_budget(_broker, 10000);
+    RequestAndFree("en_GB");
+    RequestAndFree("qaa");
+
+    enchant_broker_free(_broker);
+    _broker = NULL;
+    CHECK_EQUAL(2, disposeDictionaryCount);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+
+TEST(EnchantBrokerSetDictMemoryBudget_NullBroker_DoNothing)
+{
+    enchant_broker_set_dict_memory_budget(NULL, 10000);
+}
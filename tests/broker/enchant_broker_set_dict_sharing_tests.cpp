@@ -0,0 +1,219 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+
+static int requestDictionaryCount;
+static int disposeDictionaryCount;
+
+static int
+CheckDictionary (EnchantDict *, const char *const word, size_t len)
+{
+    return (len == 5 && strncmp(word, "hello", len) == 0) ? 0 : 1;
+}
+
+static EnchantDict *
+RequestDictionary (EnchantProvider *me, const char *tag)
+{
+    EnchantDict * dict = MockEnGbAndQaaProviderRequestDictionary(me, tag);
+    if(dict)
+    {
+        dict->check = CheckDictionary;
+        requestDictionaryCount++;
+    }
+    return dict;
+}
+
+static void
+DisposeDictionary (EnchantProvider *me, EnchantDict * dict)
+{
+    disposeDictionaryCount++;
+    MockProviderDisposeDictionary(me, dict);
+}
+
+static void Dict_Sharing_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary;
+     me->dispose_dict = DisposeDictionary;
+}
+
+struct EnchantBrokerSetDictSharing_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerSetDictSharing_TestFixture():
+            EnchantBrokerTestFixture(Dict_Sharing_ProviderConfiguration)
+    { 
+        _otherBroker = enchant_broker_init();
+        requestDictionaryCount = 0;
+        disposeDictionaryCount = 0;
+    }
+
+    //Teardown
+    ~EnchantBrokerSetDictSharing_TestFixture()
+    {
+        if(_otherBroker)
+            enchant_broker_free(_otherBroker);
+    }
+
+    void EnableSharing()
+    {
+        enchant_broker_set_dict_sharing(_broker, 1);
+        enchant_broker_set_dict_sharing(_otherBroker, 1);
+    }
+
+    EnchantBroker* _otherBroker;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+
+TEST_FIXTURE(EnchantBrokerSetDictSharing_TestFixture, 
+             EnchantBrokerSetDictSharing_NotEnabled_EachBrokerRequestsDict)
+{
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    EnchantDict* otherDict = enchant_broker_request_dict(_otherBroker, "en_GB");
+    CHECK(dict);
+    CHECK(otherDict);
+    CHECK_EQUAL(2, requestDictionaryCount);
+    enchant_broker_free_dict(_broker, dict);
+    enchant_broker_free_dict(_otherBroker, otherDict);
+    CHECK_EQUAL(2, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictSharing_TestFixture, 
+             EnchantBrokerSetDictSharing_EnabledForOneBroker_EachBrokerRequestsDict)
+{
+    enchant_broker_set_dict_sharing(_broker, 1);
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    EnchantDict* otherDict = enchant_broker_request_dict(_otherBroker, "en_GB");
+    CHECK_EQUAL(2, requestDictionaryCount);
+    enchant_broker_free_dict(_broker, dict);
+    enchant_broker_free_dict(_otherBroker, otherDict);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictSharing_TestFixture, 
+             EnchantBrokerSetDictSharing_Enabled_DictRequestedOnce)
+{
+    EnableSharing();
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    EnchantDict* otherDict = enchant_broker_request_dict(_otherBroker, "en_GB");
+    CHECK(dict);
+    CHECK(otherDict);
+    CHECK(dict != otherDict);
+    CHECK_EQUAL(1, requestDictionaryCount);
+    enchant_broker_free_dict(_broker, dict);
+    enchant_broker_free_dict(_otherBroker, otherDict);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictSharing_TestFixture, 
+             EnchantBrokerSetDictSharing_Enabled_OtherTagsRequestedSeparately)
+{
+    EnableSharing();
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    EnchantDict* otherDict = enchant_broker_request_dict(_otherBroker, "qaa");
+    CHECK_EQUAL(2, requestDictionaryCount);
+    enchant_broker_free_dict(_broker, dict);
+    enchant_broker_free_dict(_otherBroker, otherDict);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictSharing_TestFixture, 
+             EnchantBrokerSetDictSharing_Enabled_DisposedWhenLastDictFreed)
+{
+    EnableSharing();
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    EnchantDict* otherDict = enchant_broker_request_dict(_otherBroker, "en_GB");
+
+    enchant_broker_free_dict(_broker, dict);
+    CHECK_EQUAL(0, disposeDictionaryCount);
+    CHECK_EQUAL(0, enchant_dict_check(otherDict, "hello", -1));
+
+    enchant_broker_free_dict(_otherBroker, otherDict);
+    CHECK_EQUAL(1, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictSharing_TestFixture, 
+             EnchantBrokerSetDictSharing_Enabled_AllFreed_RequestedAgain)
+{
+    EnableSharing();
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    enchant_broker_free_dict(_broker, dict);
+
+    EnchantDict* otherDict = enchant_broker_request_dict(_otherBroker, "en_GB");
+    CHECK_EQUAL(2, requestDictionaryCount);
+    enchant_broker_free_dict(_otherBroker, otherDict);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictSharing_TestFixture, 
+             EnchantBrokerSetDictSharing_FirstBrokerFreed_OtherDictStillWorks)
+{
+    EnableSharing();
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    EnchantDict* otherDict = enchant_broker_request_dict(_otherBroker, "en_GB");
+
+    enchant_broker_free_dict(_broker, dict);
+    enchant_broker_free(_broker);
+    _broker = NULL;
+
+    CHECK_EQUAL(0, enchant_dict_check(otherDict, "hello", -1));
+    CHECK_EQUAL(1, enchant_dict_check(otherDict, "helo", -1));
+
+    enchant_broker_free_dict(_otherBroker, otherDict);
+    CHECK_EQUAL(1, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictSharing_TestFixture, 
+             EnchantBrokerSetDictSharing_Enabled_SessionsNotShared)
+{
+    EnableSharing();
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    EnchantDict* otherDict = enchant_broker_request_dict(_otherBroker, "en_GB");
+
+    enchant_dict_add_to_session(dict, "session", -1);
+    CHECK(enchant_dict_is_added(dict, "session", -1));
+    CHECK(!enchant_dict_is_added(otherDict, "session", -1));
+    CHECK_EQUAL(1, enchant_dict_check(otherDict, "session", -1));
+
+    enchant_broker_free_dict(_broker, dict);
+    enchant_broker_free_dict(_otherBroker, otherDict);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictSharing_TestFixture, 
+             EnchantBrokerSetDictSharing_Disabled_LaterRequestsNotShared)
+{
+    EnableSharing();
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    enchant_broker_set_dict_sharing(_otherBroker, 0);
+    EnchantDict* otherDict = enchant_broker_request_dict(_otherBroker, "en_GB");
+    CHECK_EQUAL(2, requestDictionaryCount);
+
+    enchant_broker_free_dict(_broker, dict);
+    enchant_broker_free_dict(_otherBroker, otherDict);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+
+TEST(EnchantBrokerSetDictSharing_NullBroker_DoNothing)
+{
+    enchant_broker_set_dict_sharing(NULL, 1);
+}
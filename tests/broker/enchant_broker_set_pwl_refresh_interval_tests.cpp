@@ -0,0 +1,196 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+
+struct EnchantBrokerSetPwlRefreshInterval_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantBrokerSetPwlRefreshInterval_TestFixture():
+        EnchantDictionaryTestFixture(EmptyDictionary_ProviderConfiguration)
+    { }
+};
+
+static const int OneHour = 60 * 60 * 1000;
+
+/**
+ * enchant_broker_set_pwl_refresh_interval
+ * @broker: A non-null #EnchantBroker
+ * @msecs: The minimum time between two looks, in milliseconds, or 0
+ *
+ * By default a dictionary looks at its personal and exclude word
+ * lists for changes made by other programs each time it checks a word
+ * or makes suggestions, at the cost of a stat() call each time.
+ * A non-zero @msecs makes the dictionaries of @broker, current and
+ * future, look at most once every @msecs instead. Words added or
+ * removed through Enchant itself are always seen immediately.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+
+TEST_FIXTURE(EnchantBrokerSetPwlRefreshInterval_TestFixture,
+             EnchantBrokerSetPwlRefreshInterval_NotDue_ExternalChangeNotSeen)
+{
+    enchant_broker_set_pwl_refresh_interval(_broker, OneHour);
+    CHECK(!IsWordInDictionary("hello"));
+
+    ExternalAddWordToDictionary("hello");
+
+    CHECK(!IsWordInDictionary("hello"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetPwlRefreshInterval_TestFixture,
+             EnchantBrokerSetPwlRefreshInterval_Due_ExternalChangeSeen)
+{
+    enchant_broker_set_pwl_refresh_interval(_broker, 500);
+    CHECK(!IsWordInDictionary("hello"));
+
+    ExternalAddWordToDictionary("hello"); // takes over a second
+
+    CHECK(IsWordInDictionary("hello"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetPwlRefreshInterval_TestFixture,
+             EnchantBrokerSetPwlRefreshInterval_Due_ChangeInSameSecondSeen)
+{
+    enchant_broker_set_pwl_refresh_interval(_broker, 100);
+    ExternalAddWordToDictionary("hello");
+    CHECK(IsWordInDictionary("hello"));
+
+    // written without waiting for the modification time to change
+    FILE * f = g_fopen(GetPersonalDictFileName().c_str(), "ab");
+    CHECK(f);
+    if(f)
+    {
+        fputs("\nworld", f);
+        fclose(f);
+    }
+    g_usleep(200 * 1000);
+
+    CHECK(IsWordInDictionary("world"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetPwlRefreshInterval_TestFixture,
+             EnchantBrokerSetPwlRefreshInterval_NotDue_ExternalExcludeNotSeen)
+{
+    enchant_broker_set_pwl_refresh_interval(_broker, OneHour);
+    AddWordToDictionary("hello");
+
+    ExternalAddWordToExclude("hello");
+
+    CHECK(IsWordInDictionary("hello"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetPwlRefreshInterval_TestFixture,
+             EnchantBrokerSetPwlRefreshInterval_NotDue_AddedWordSeen)
+{
+    enchant_broker_set_pwl_refresh_interval(_broker, OneHour);
+    CHECK(!IsWordInDictionary("hello"));
+
+    AddWordToDictionary("hello");
+
+    CHECK(IsWordInDictionary("hello"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetPwlRefreshInterval_TestFixture,
+             EnchantBrokerSetPwlRefreshInterval_NotDue_AddWordPicksUpExternalChange)
+{
+    enchant_broker_set_pwl_refresh_interval(_broker, OneHour);
+    CHECK(!IsWordInDictionary("hello"));
+
+    ExternalAddWordToDictionary("hello");
+    AddWordToDictionary("world");
+
+    CHECK(IsWordInDictionary("hello"));
+    CHECK(IsWordInDictionary("world"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetPwlRefreshInterval_TestFixture,
+             EnchantBrokerSetPwlRefreshInterval_NotDue_RemoveExternallyAddedWord)
+{
+    enchant_broker_set_pwl_refresh_interval(_broker, OneHour);
+    CHECK(!IsWordInDictionary("hello"));
+
+    ExternalAddWordToDictionary("hello");
+    RemoveWordFromDictionary("hello");
+
+    CHECK(!IsWordInDictionary("hello"));
+    CHECK(!PersonalWordListFileHasContents());
+}
+
+TEST_FIXTURE(EnchantBrokerSetPwlRefreshInterval_TestFixture,
+             EnchantBrokerSetPwlRefreshInterval_SetBackToZero_ExternalChangeSeen)
+{
+    enchant_broker_set_pwl_refresh_interval(_broker, OneHour);
+    CHECK(!IsWordInDictionary("hello"));
+    enchant_broker_set_pwl_refresh_interval(_broker, 0);
+
+    ExternalAddWordToDictionary("hello");
+
+    CHECK(IsWordInDictionary("hello"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetPwlRefreshInterval_TestFixture,
+             EnchantBrokerSetPwlRefreshInterval_DictionaryRequestedAfterwards_UsesInterval)
+{
+    enchant_broker_set_pwl_refresh_interval(_broker, OneHour);
+    ReloadTestDictionary();
+    CHECK(!IsWordInDictionary("hello"));
+
+    ExternalAddWordToDictionary("hello");
+
+    CHECK(!IsWordInDictionary("hello"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetPwlRefreshInterval_TestFixture,
+             EnchantBrokerSetPwlRefreshInterval_PwlDictionary_UsesInterval)
+{
+    enchant_broker_set_pwl_refresh_interval(_broker, OneHour);
+    CHECK_EQUAL(1, enchant_dict_check(_pwl, "hello", -1));
+
+    ExternalAddWordToFile("hello", _pwlFileName);
+
+    CHECK_EQUAL(1, enchant_dict_check(_pwl, "hello", -1));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+
+TEST_FIXTURE(EnchantBrokerSetPwlRefreshInterval_TestFixture,
+             EnchantBrokerSetPwlRefreshInterval_NullBroker_DoNothing)
+{
+    enchant_broker_set_pwl_refresh_interval(NULL, OneHour);
+    ExternalAddWordToDictionary("hello");
+
+    CHECK(IsWordInDictionary("hello"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetPwlRefreshInterval_TestFixture,
+             EnchantBrokerSetPwlRefreshInterval_Negative_DoNothing)
+{
+    enchant_broker_set_pwl_refresh_interval(_broker, -1);
+    ExternalAddWordToDictionary("hello");
+
+    CHECK(IsWordInDictionary("hello"));
+}
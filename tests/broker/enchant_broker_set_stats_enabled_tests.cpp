@@ -0,0 +1,88 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+
+static void
+EnchantStatsCounter (const char * const,
+                     const char * const,
+                     size_t,
+                     size_t,
+                     const size_t * const,
+                     size_t,
+                     void * user_data)
+{
+    ++*reinterpret_cast<int*>(user_data);
+}
+
+struct EnchantBrokerSetStatsEnabled_TestFixture : EnchantBrokerTestFixture
+{
+    int CountReports()
+    {
+        int reports = 0;
+        enchant_broker_get_stats(_broker, EnchantStatsCounter, &reports);
+        return reports;
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+
+TEST_FIXTURE(EnchantBrokerSetStatsEnabled_TestFixture, 
+             EnchantBrokerSetStatsEnabled_Default_Disabled)
+{
+    EnchantDict* dict = RequestPersonalDictionary();
+    enchant_dict_check(dict, "hello", -1);
+    FreeDictionary(dict);
+    CHECK_EQUAL(0, CountReports());
+}
+
+TEST_FIXTURE(EnchantBrokerSetStatsEnabled_TestFixture, 
+             EnchantBrokerSetStatsEnabled_Enabled_Counts)
+{
+    enchant_broker_set_stats_enabled(_broker, 1);
+    EnchantDict* dict = RequestPersonalDictionary();
+    enchant_dict_check(dict, "hello", -1);
+    FreeDictionary(dict);
+    CHECK(CountReports() > 0);
+}
+
+TEST_FIXTURE(EnchantBrokerSetStatsEnabled_TestFixture, 
+             EnchantBrokerSetStatsEnabled_Disabled_KeepsCounts)
+{
+    enchant_broker_set_stats_enabled(_broker, 1);
+    EnchantDict* dict = RequestPersonalDictionary();
+    enchant_dict_check(dict, "hello", -1);
+    FreeDictionary(dict);
+    enchant_broker_set_stats_enabled(_broker, 0);
+    CHECK(CountReports() > 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+
+TEST_FIXTURE(EnchantBrokerSetStatsEnabled_TestFixture, 
+             EnchantBrokerSetStatsEnabled_NullBroker_DoNothing)
+{
+    enchant_broker_set_stats_enabled(NULL, 1);
+}
@@ -0,0 +1,262 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+#include <string>
+#include <vector>
+
+struct TraceEvent
+{
+    std::string hook;
+    std::string provider_name;
+    std::string lang_tag;
+    std::string operation;
+    size_t word_len;
+};
+
+typedef std::vector<TraceEvent> TraceEvents;
+
+static void
+TraceBegin (const char * const provider_name,
+            const char * const lang_tag,
+            const char * const operation,
+            size_t word_len,
+            void * user_data)
+{
+    TraceEvent event = { "begin", provider_name, lang_tag, operation, word_len };
+    reinterpret_cast<TraceEvents*>(user_data)->push_back(event);
+}
+
+static void
+TraceEnd (const char * const provider_name,
+          const char * const lang_tag,
+          const char * const operation,
+          size_t word_len,
+          size_t,
+          void * user_data)
+{
+    TraceEvent event = { "end", provider_name, lang_tag, operation, word_len };
+    reinterpret_cast<TraceEvents*>(user_data)->push_back(event);
+}
+
+static int
+CheckDictionary (EnchantDict *, const char *const, size_t)
+{
+    return 1;
+}
+
+static char **
+SuggestDictionary (EnchantDict *, const char *const, size_t, size_t* out_n_suggs)
+{
+    char ** suggs = g_new0 (char *, 2);
+    suggs[0] = g_strdup ("hello");
+    *out_n_suggs = 1;
+    return suggs;
+}
+
+static EnchantDict *
+RequestDictionary (EnchantProvider *me, const char *tag)
+{
+    EnchantDict * dict = MockEnGbAndQaaProviderRequestDictionary(me, tag);
+    if(dict)
+    {
+        dict->check = CheckDictionary;
+        dict->suggest = SuggestDictionary;
+    }
+    return dict;
+}
+
+static void Trace_Hooks_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantBrokerSetTraceHooks_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerSetTraceHooks_TestFixture():
+            EnchantBrokerTestFixture(Trace_Hooks_ProviderConfiguration)
+    { 
+        _dict = RequestDictionary("en_GB");
+    }
+
+    //Teardown
+    ~EnchantBrokerSetTraceHooks_TestFixture()
+    {
+        FreeDictionary(_dict);
+    }
+
+    void SetHooks()
+    {
+        enchant_broker_set_trace_hooks(_broker, TraceBegin, TraceEnd, &_events);
+    }
+
+    EnchantDict* _dict;
+    TraceEvents _events;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+
+TEST_FIXTURE(EnchantBrokerSetTraceHooks_TestFixture, 
+             EnchantBrokerSetTraceHooks_NotSet_NothingTraced)
+{
+    enchant_dict_check(_dict, "hello", -1);
+    CHECK(_events.empty());
+}
+
+TEST_FIXTURE(EnchantBrokerSetTraceHooks_TestFixture, 
+             EnchantBrokerSetTraceHooks_Check_BeginAndEndCalled)
+{
+    SetHooks();
+    enchant_dict_check(_dict, "hello", -1);
+
+    CHECK_EQUAL(2u, _events.size());
+    CHECK_EQUAL("begin", _events[0].hook);
+    CHECK_EQUAL("end", _events[1].hook);
+    for(size_t i = 0; i < _events.size(); ++i)
+    {
+        CHECK_EQUAL("mock", _events[i].provider_name);
+        CHECK_EQUAL("en_GB", _events[i].lang_tag);
+        CHECK_EQUAL("check", _events[i].operation);
+        CHECK_EQUAL(5u, _events[i].word_len);
+    }
+}
+
+TEST_FIXTURE(EnchantBrokerSetTraceHooks_TestFixture, 
+             EnchantBrokerSetTraceHooks_Suggest_Traced)
+{
+    SetHooks();
+    size_t n_suggs;
+    char ** suggs = enchant_dict_suggest(_dict, "helo", -1, &n_suggs);
+    enchant_dict_free_string_list(_dict, suggs);
+
+    CHECK_EQUAL(2u, _events.size());
+    CHECK_EQUAL("suggest", _events[0].operation);
+    CHECK_EQUAL("suggest", _events[1].operation);
+    CHECK_EQUAL(4u, _events[1].word_len);
+}
+
+TEST_FIXTURE(EnchantBrokerSetTraceHooks_TestFixture, 
+             EnchantBrokerSetTraceHooks_CheckMany_TracedOnceForAllWords)
+{
+    SetHooks();
+    const char * words[] = {"hello", "helo", "world"};
+    unsigned char misspelled[1];
+    enchant_dict_check_many(_dict, words, NULL, 3, misspelled);
+
+    CHECK_EQUAL(2u, _events.size());
+    CHECK_EQUAL("check_many", _events[0].operation);
+    CHECK_EQUAL(14u, _events[0].word_len);
+    CHECK_EQUAL("check_many", _events[1].operation);
+}
+
+TEST_FIXTURE(EnchantBrokerSetTraceHooks_TestFixture, 
+             EnchantBrokerSetTraceHooks_WordInSession_NotTraced)
+{
+    SetHooks();
+    enchant_dict_add_to_session(_dict, "hello", -1);
+    enchant_dict_check(_dict, "hello", -1);
+
+    CHECK(_events.empty());
+}
+
+TEST_FIXTURE(EnchantBrokerSetTraceHooks_TestFixture, 
+             EnchantBrokerSetTraceHooks_CheckAnsweredFromCache_NotTraced)
+{
+    enchant_dict_set_check_cache_size(_dict, 10);
+    SetHooks();
+    enchant_dict_check(_dict, "hello", -1);
+    enchant_dict_check(_dict, "hello", -1);
+
+    CHECK_EQUAL(2u, _events.size());
+}
+
+TEST_FIXTURE(EnchantBrokerSetTraceHooks_TestFixture, 
+             EnchantBrokerSetTraceHooks_OnlyEnd_EndCalled)
+{
+    enchant_broker_set_trace_hooks(_broker, NULL, TraceEnd, &_events);
+    enchant_dict_check(_dict, "hello", -1);
+
+    CHECK_EQUAL(1u, _events.size());
+    CHECK_EQUAL("end", _events[0].hook);
+}
+
+TEST_FIXTURE(EnchantBrokerSetTraceHooks_TestFixture, 
+             EnchantBrokerSetTraceHooks_SetToNull_StopsTracing)
+{
+    SetHooks();
+    enchant_dict_check(_dict, "hello", -1);
+    enchant_broker_set_trace_hooks(_broker, NULL, NULL, NULL);
+    enchant_dict_check(_dict, "world", -1);
+
+    CHECK_EQUAL(2u, _events.size());
+}
+
+TEST_FIXTURE(EnchantBrokerSetTraceHooks_TestFixture, 
+             EnchantBrokerSetTraceHooks_Replaced_NewHooksCalled)
+{
+    TraceEvents otherEvents;
+    SetHooks();
+    enchant_broker_set_trace_hooks(_broker, TraceBegin, TraceEnd, &otherEvents);
+    enchant_dict_check(_dict, "hello", -1);
+
+    CHECK(_events.empty());
+    CHECK_EQUAL(2u, otherEvents.size());
+}
+
+TEST_FIXTURE(EnchantBrokerSetTraceHooks_TestFixture, 
+             EnchantBrokerSetTraceHooks_PersonalDict_NotTraced)
+{
+    SetHooks();
+    EnchantDict* dict = RequestPersonalDictionary();
+    enchant_dict_check(dict, "hello", -1);
+    FreeDictionary(dict);
+
+    CHECK(_events.empty());
+}
+
+TEST_FIXTURE(EnchantBrokerSetTraceHooks_TestFixture, 
+             EnchantBrokerSetTraceHooks_DictRequestedLater_Traced)
+{
+    SetHooks();
+    EnchantDict* dict = RequestDictionary("qaa");
+    enchant_dict_check(dict, "hello", -1);
+    FreeDictionary(dict);
+
+    CHECK_EQUAL(2u, _events.size());
+    CHECK_EQUAL("qaa", _events[0].lang_tag);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+
+TEST_FIXTURE(EnchantBrokerSetTraceHooks_TestFixture, 
+             EnchantBrokerSetTraceHooks_NullBroker_DoNothing)
+{
+    enchant_broker_set_trace_hooks(NULL, TraceBegin, TraceEnd, &_events);
+    enchant_dict_check(_dict, "hello", -1);
+
+    CHECK(_events.empty());
+}
@@ -141,6 +141,33 @@ TEST_FIXTURE(EnchantDictionaryAddToSession_TestFixture,
     CHECK(IsWordInSession("hello"));
 }
 
+TEST_FIXTURE(EnchantDictionaryAddToSession_TestFixture,
+             EnchantDictionaryAddToSession_LenSpecified_OnlyPrefixInSession)
+{
+    enchant_dict_add_to_session(_dict, "hellodisregard me", 5);
+    CHECK(IsWordInSession("hello"));
+    CHECK(!IsWordInSession("hellodisregard"));
+    CHECK(!IsWordInSession("hell"));
+}
+
+TEST_FIXTURE(EnchantDictionaryAddToSession_TestFixture,
+             EnchantDictionaryAddToSession_ManyWords_AllInSession)
+{
+    char word[32];
+    for (int i = 0; i < 1000; i++)
+    {
+        snprintf(word, sizeof(word), "session%d", i);
+        enchant_dict_add_to_session(_dict, word, -1);
+    }
+
+    for (int i = 0; i < 1000; i++)
+    {
+        snprintf(word, sizeof(word), "session%d", i);
+        CHECK(IsWordInSession(word));
+    }
+    CHECK(!IsWordInSession("session1000"));
+}
+
 TEST_FIXTURE(EnchantDictionaryAddToSession_TestFixture,
              EnchantDictionaryAddToSession_InBrokerSession)
 {
@@ -0,0 +1,229 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+
+static int providerCheckCount;
+
+static int
+MockDictionaryCheck (EnchantDict *, const char *const word, size_t len)
+{
+    providerCheckCount++;
+    if(strncmp("hello", word, len)==0)
+        return 0;
+    return 1;
+}
+
+static EnchantDict* MockProviderRequestCheckMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->check = MockDictionaryCheck;
+    return dict;
+}
+
+static void DictionaryCheckCache_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestCheckMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantDictionaryCheckCache_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionaryCheckCache_TestFixture():
+            EnchantDictionaryTestFixture(DictionaryCheckCache_ProviderConfiguration)
+    { 
+        providerCheckCount = 0;
+        enchant_dict_set_check_cache_size(_dict, 100);
+    }
+
+    size_t Hits()
+    {
+        size_t hits;
+        enchant_dict_get_check_cache_stats(_dict, &hits, NULL);
+        return hits;
+    }
+
+    size_t Misses()
+    {
+        size_t misses;
+        enchant_dict_get_check_cache_stats(_dict, NULL, &misses);
+        return misses;
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionaryCheckCache_TestFixture,
+             EnchantDictionaryCheckCache_CheckedTwice_ProviderAskedOnce)
+{
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+    CHECK_EQUAL(1, providerCheckCount);
+    CHECK_EQUAL(1, Hits());
+    CHECK_EQUAL(1, Misses());
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckCache_TestFixture,
+             EnchantDictionaryCheckCache_MisspelledCheckedTwice_ProviderAskedOnce)
+{
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "helo", -1));
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "helo", -1));
+    CHECK_EQUAL(1, providerCheckCount);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckCache_TestFixture,
+             EnchantDictionaryCheckCache_LengthGiven_OnlyThatPrefixCached)
+{
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hellohello", 5));
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "hellohello", -1));
+    CHECK_EQUAL(2, providerCheckCount);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckCache_TestFixture,
+             EnchantDictionaryCheckCache_SizeZero_ProviderAskedEachTime)
+{
+    enchant_dict_set_check_cache_size(_dict, 0);
+    enchant_dict_check(_dict, "hello", -1);
+    enchant_dict_check(_dict, "hello", -1);
+    CHECK_EQUAL(2, providerCheckCount);
+    CHECK_EQUAL(0, Hits());
+    CHECK_EQUAL(0, Misses());
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckCache_TestFixture,
+             EnchantDictionaryCheckCache_Full_LeastRecentlyUsedForgotten)
+{
+    enchant_dict_set_check_cache_size(_dict, 2);
+    enchant_dict_check(_dict, "one", -1);
+    enchant_dict_check(_dict, "two", -1);
+    enchant_dict_check(_dict, "one", -1);
+    enchant_dict_check(_dict, "three", -1);
+    CHECK_EQUAL(3, providerCheckCount);
+
+    enchant_dict_check(_dict, "one", -1);
+    CHECK_EQUAL(3, providerCheckCount);
+    enchant_dict_check(_dict, "two", -1);
+    CHECK_EQUAL(4, providerCheckCount);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckCache_TestFixture,
+             EnchantDictionaryCheckCache_SizeSet_StatsReset)
+{
+    enchant_dict_check(_dict, "hello", -1);
+    enchant_dict_check(_dict, "hello", -1);
+    enchant_dict_set_check_cache_size(_dict, 50);
+    CHECK_EQUAL(0, Hits());
+    CHECK_EQUAL(0, Misses());
+
+    enchant_dict_check(_dict, "hello", -1);
+    CHECK_EQUAL(1, Hits());
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckCache_TestFixture,
+             EnchantDictionaryCheckCache_WordAdded_CacheInvalidated)
+{
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "helo", -1));
+    enchant_dict_add(_dict, "helo", -1);
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "helo", -1));
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckCache_TestFixture,
+             EnchantDictionaryCheckCache_WordAddedToSession_CacheInvalidated)
+{
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "helo", -1));
+    enchant_dict_add_to_session(_dict, "helo", -1);
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "helo", -1));
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckCache_TestFixture,
+             EnchantDictionaryCheckCache_WordRemoved_CacheInvalidated)
+{
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+    enchant_dict_remove(_dict, "hello", -1);
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "hello", -1));
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckCache_TestFixture,
+             EnchantDictionaryCheckCache_WordRemovedFromSession_CacheInvalidated)
+{
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+    enchant_dict_remove_from_session(_dict, "hello", -1);
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "hello", -1));
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckCache_TestFixture,
+             EnchantDictionaryCheckCache_WordAddedToFileExternally_CacheInvalidated)
+{
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "helo", -1));
+    ExternalAddWordToDictionary("helo");
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "helo", -1));
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckCache_TestFixture,
+             EnchantDictionaryCheckCache_WordAddedToExcludeExternally_CacheInvalidated)
+{
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+    ExternalAddWordToExclude("hello");
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "hello", -1));
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckCache_TestFixture,
+             EnchantDictionaryCheckCache_CheckMany_UsesAndFillsCache)
+{
+    const char* words[] = { "hello", "helo" };
+    unsigned char misspelled[1];
+
+    enchant_dict_check(_dict, "hello", -1);
+    CHECK_EQUAL(1, enchant_dict_check_many(_dict, words, NULL, 2, misspelled));
+    CHECK_EQUAL(0x02, misspelled[0]);
+    CHECK_EQUAL(2, providerCheckCount);
+
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "helo", -1));
+    CHECK_EQUAL(2, providerCheckCount);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckCache_TestFixture,
+             EnchantDictionaryCheckCache_SharedWithThreadDictionary)
+{
+    EnchantDict* dict = enchant_broker_request_dict_for_thread(_broker, "qaa");
+    CHECK(dict != _dict);
+
+    enchant_dict_check(_dict, "hello", -1);
+    enchant_dict_check(dict, "hello", -1);
+    CHECK_EQUAL(1, providerCheckCount);
+
+    FreeDictionary(dict);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionaryCheckCache_TestFixture,
+             EnchantDictionaryCheckCache_NullDictionary_DoNothing)
+{
+    size_t hits = 7, misses = 7;
+    enchant_dict_set_check_cache_size(NULL, 10);
+    enchant_dict_get_check_cache_stats(NULL, &hits, &misses);
+    CHECK_EQUAL(7, hits);
+    CHECK_EQUAL(7, misses);
+}
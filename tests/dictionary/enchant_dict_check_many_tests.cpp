@@ -0,0 +1,401 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+
+static int dictCheckCalls;
+static int dictCheckManyCalls;
+static int dictCheckManyWords;
+
+static int
+MockDictionaryCheck (EnchantDict * dict, const char *const word, size_t len)
+{
+    dict;
+    dictCheckCalls++;
+    if(strncmp("hello", word, len)==0 || strncmp("world", word, len)==0)
+    {
+        return 0; //good word
+    }
+    return 1; // bad word
+}
+
+static void
+MockDictionaryCheckMany (EnchantDict * dict, const char *const *const words,
+                         const size_t *const lens, size_t n_words, int *results)
+{
+    dictCheckManyCalls++;
+    dictCheckManyWords += (int)n_words;
+    for(size_t i = 0; i < n_words; i++)
+    {
+        results[i] = MockDictionaryCheck(dict, words[i], lens[i]);
+    }
+    dictCheckCalls -= (int)n_words;
+}
+
+static EnchantDict* MockProviderRequestCheckMockDictionary(EnchantProvider * me, const char *tag)
+{
+    
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->check = MockDictionaryCheck;
+    return dict;
+}
+
+static EnchantDict* MockProviderRequestCheckManyMockDictionary(EnchantProvider * me, const char *tag)
+{
+    
+    EnchantDict* dict = MockProviderRequestCheckMockDictionary(me, tag);
+    dict->check_many = MockDictionaryCheckMany;
+    return dict;
+}
+
+static void DictionaryCheck_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestCheckMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+static void DictionaryCheckMany_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestCheckManyMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantDictionaryCheckMany_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionaryCheckMany_TestFixture(ConfigureHook userConfiguration=DictionaryCheck_ProviderConfiguration):
+            EnchantDictionaryTestFixture(userConfiguration)
+    { 
+        dictCheckCalls = 0;
+        dictCheckManyCalls = 0;
+        dictCheckManyWords = 0;
+    }
+
+    int CheckMany(EnchantDict* dict, const std::vector<std::string>& sWords)
+    {
+        std::vector<const char*> words;
+        std::vector<ssize_t> lens;
+        for(std::vector<std::string>::const_iterator itWord = sWords.begin(); itWord != sWords.end(); ++itWord)
+        {
+            words.push_back(itWord->c_str());
+            lens.push_back(itWord->size());
+        }
+
+        misspelled.assign((sWords.size() + 7) / 8 + 1, 0xff);
+        return enchant_dict_check_many(dict, words.empty() ? NULL : &words[0],
+                                       lens.empty() ? NULL : &lens[0],
+                                       sWords.size(), &misspelled[0]);
+    }
+
+    bool IsMisspelled(size_t i)
+    {
+        return (misspelled[i / 8] & (1 << (i % 8))) != 0;
+    }
+
+    std::vector<unsigned char> misspelled;
+};
+
+struct EnchantDictionaryCheckManyHook_TestFixture : EnchantDictionaryCheckMany_TestFixture
+{
+    //Setup
+    EnchantDictionaryCheckManyHook_TestFixture():
+            EnchantDictionaryCheckMany_TestFixture(DictionaryCheckMany_ProviderConfiguration)
+    { }
+};
+
+struct EnchantDictionaryCheckManyNotImplemented_TestFixture : EnchantDictionaryCheckMany_TestFixture
+{
+    //Setup
+    EnchantDictionaryCheckManyNotImplemented_TestFixture():
+            EnchantDictionaryCheckMany_TestFixture(EmptyDictionary_ProviderConfiguration)
+    { }
+};
+
+/**
+ * enchant_dict_check_many
+ * @dict: A non-null #EnchantDict
+ * @words: An array of @n_words words you wish to check, in UTF-8 encoding
+ * @lens: The byte lengths of @words, or %null; a negative length, or a %null
+ *        @lens, means strlen of the word
+ * @n_words: The number of words in @words
+ * @misspelled: A bitmap of at least (@n_words + 7) / 8 bytes, in which bit
+ *              (i % 8) of byte (i / 8) is set if @words[i] is not correctly spelled
+ *
+ * Checks many words at once, with the same result for each word as
+ * enchant_dict_check but at a lower cost per word. Words that are %null,
+ * empty or not valid UTF-8 are marked as misspelled.
+ *
+ * Returns: the number of misspelled words, or negative if a word could not be checked
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture,
+             EnchantDictionaryCheckMany_AllWordsExist_0)
+{
+    std::vector<std::string> sWords;
+    sWords.push_back("hello");
+    sWords.push_back("world");
+
+    CHECK_EQUAL(0, CheckMany(_dict, sWords));
+    CHECK(!IsMisspelled(0));
+    CHECK(!IsMisspelled(1));
+    CHECK_EQUAL(2, dictCheckCalls);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture,
+             EnchantDictionaryCheckMany_SomeWordsDoNotExist_MisspelledMarked)
+{
+    std::vector<std::string> sWords;
+    sWords.push_back("hello");
+    sWords.push_back("helo");
+    sWords.push_back("world");
+    sWords.push_back("wrld");
+
+    CHECK_EQUAL(2, CheckMany(_dict, sWords));
+    CHECK(!IsMisspelled(0));
+    CHECK( IsMisspelled(1));
+    CHECK(!IsMisspelled(2));
+    CHECK( IsMisspelled(3));
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture,
+             EnchantDictionaryCheckMany_MoreThanEightWords_MisspelledMarkedInLaterBytes)
+{
+    std::vector<std::string> sWords(17, "hello");
+    sWords[8] = "helo";
+    sWords[16] = "wrld";
+
+    CHECK_EQUAL(2, CheckMany(_dict, sWords));
+    for(size_t i = 0; i < sWords.size(); ++i)
+    {
+        CHECK_EQUAL(i == 8 || i == 16, IsMisspelled(i));
+    }
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture,
+             EnchantDictionaryCheckMany_LensNull_LensComputed)
+{
+    const char* words[] = { "hello", "helo" };
+    unsigned char bitmap = 0;
+
+    CHECK_EQUAL(1, enchant_dict_check_many(_dict, words, NULL, 2, &bitmap));
+    CHECK_EQUAL(2, bitmap);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture,
+             EnchantDictionaryCheckMany_LensSpecified_OnlyThoseBytesChecked)
+{
+    const char* words[] = { "hellodisregard me", "helodisregard me", "world" };
+    ssize_t lens[] = { 5, 4, -1 };
+    unsigned char bitmap = 0;
+
+    CHECK_EQUAL(1, enchant_dict_check_many(_dict, words, lens, 3, &bitmap));
+    CHECK_EQUAL(2, bitmap);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture,
+             EnchantDictionaryCheckMany_SameResultsAsCheck)
+{
+    enchant_dict_add(_dict, "personal", -1);
+    enchant_dict_add_to_session(_dict, "session", -1);
+    enchant_dict_remove(_dict, "world", -1);
+
+    std::vector<std::string> sWords;
+    sWords.push_back("hello");
+    sWords.push_back("helo");
+    sWords.push_back("world");
+    sWords.push_back("personal");
+    sWords.push_back("session");
+    sWords.push_back("Hello");
+    sWords.push_back("PERSONAL");
+    sWords.push_back("Personal");
+    sWords.push_back("a very long string that does not fit into the small lookup buffer at all");
+
+    CheckMany(_dict, sWords);
+    for(size_t i = 0; i < sWords.size(); ++i)
+    {
+        CHECK_EQUAL(enchant_dict_check(_dict, sWords[i].c_str(), -1) != 0, IsMisspelled(i));
+    }
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture,
+             EnchantDictionaryCheckMany_WordsExistInSessionOrPersonal_DoesNotCallProvider)
+{
+    enchant_dict_add_to_session(_dict, "session", -1);
+    enchant_dict_add(_dict, "personal", -1);
+
+    std::vector<std::string> sWords;
+    sWords.push_back("session");
+    sWords.push_back("personal");
+
+    CHECK_EQUAL(0, CheckMany(_dict, sWords));
+    CHECK_EQUAL(0, dictCheckCalls);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture,
+             EnchantDictionaryCheckMany_WordExcluded_MisspelledWithoutCallingProvider)
+{
+    enchant_dict_remove(_dict, "hello", -1);
+
+    std::vector<std::string> sWords;
+    sWords.push_back("hello");
+
+    CHECK_EQUAL(1, CheckMany(_dict, sWords));
+    CHECK(IsMisspelled(0));
+    CHECK_EQUAL(0, dictCheckCalls);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture,
+             EnchantDictionaryCheckMany_WordInDictionaryAndExclude_Misspelled)
+{
+    ExternalAddWordToExclude("hello");
+    ExternalAddWordToDictionary("hello");
+
+    std::vector<std::string> sWords;
+    sWords.push_back("hello");
+
+    CHECK_EQUAL(1, CheckMany(_dict, sWords));
+    CHECK(IsMisspelled(0));
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture,
+             EnchantDictionaryCheckMany_WordsInBrokerPwl_0)
+{
+    enchant_dict_add(_pwl, "personal", -1);
+    enchant_dict_add_to_session(_pwl, "session", -1);
+
+    std::vector<std::string> sWords;
+    sWords.push_back("personal");
+    sWords.push_back("session");
+    sWords.push_back("hello");
+
+    CHECK_EQUAL(1, CheckMany(_pwl, sWords));
+    CHECK(!IsMisspelled(0));
+    CHECK(!IsMisspelled(1));
+    CHECK( IsMisspelled(2));
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture,
+             EnchantDictionaryCheckMany_NoWords_0)
+{
+    CHECK_EQUAL(0, enchant_dict_check_many(_dict, NULL, NULL, 0, NULL));
+    CHECK_EQUAL(0, dictCheckCalls);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture, 
+             EnchantDictionaryCheckMany_HasPreviousError_ErrorCleared)
+{
+    SetErrorOnMockDictionary("something bad happened");
+
+    std::vector<std::string> sWords;
+    sWords.push_back("hello");
+
+    CheckMany(_dict, sWords);
+    CHECK_EQUAL((void*)NULL, (void*)enchant_dict_get_error(_dict));
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckManyHook_TestFixture,
+             EnchantDictionaryCheckMany_ProviderImplementsCheckMany_CalledOnceForUnknownWords)
+{
+    enchant_dict_add_to_session(_dict, "session", -1);
+
+    std::vector<std::string> sWords;
+    sWords.push_back("hello");
+    sWords.push_back("session");
+    sWords.push_back("helo");
+    sWords.push_back("world");
+
+    CHECK_EQUAL(1, CheckMany(_dict, sWords));
+    CHECK(!IsMisspelled(0));
+    CHECK(!IsMisspelled(1));
+    CHECK( IsMisspelled(2));
+    CHECK(!IsMisspelled(3));
+    CHECK_EQUAL(1, dictCheckManyCalls);
+    CHECK_EQUAL(3, dictCheckManyWords);
+    CHECK_EQUAL(0, dictCheckCalls);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture,
+             EnchantDictionaryCheckMany_NullDictionary_Negative1)
+{
+    const char* words[] = { "hello" };
+    unsigned char bitmap = 0;
+
+    CHECK_EQUAL(-1, enchant_dict_check_many(NULL, words, NULL, 1, &bitmap));
+    CHECK_EQUAL(0, dictCheckCalls);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture,
+             EnchantDictionaryCheckMany_NullWords_Negative1)
+{
+    unsigned char bitmap = 0;
+
+    CHECK_EQUAL(-1, enchant_dict_check_many(_dict, NULL, NULL, 1, &bitmap));
+    CHECK_EQUAL(0, dictCheckCalls);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture,
+             EnchantDictionaryCheckMany_NullBitmap_Negative1)
+{
+    const char* words[] = { "hello" };
+
+    CHECK_EQUAL(-1, enchant_dict_check_many(_dict, words, NULL, 1, NULL));
+    CHECK_EQUAL(0, dictCheckCalls);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckMany_TestFixture,
+             EnchantDictionaryCheckMany_InvalidWords_MisspelledWithoutCallingProvider)
+{
+    const char* words[] = { NULL, "", "helo", "\xa5\xf1\x08", "hello" };
+    ssize_t lens[] = { -1, -1, 0, -1, -1 };
+    unsigned char bitmap = 0;
+
+    CHECK_EQUAL(4, enchant_dict_check_many(_dict, words, lens, 5, &bitmap));
+    CHECK_EQUAL(15, bitmap);
+    CHECK_EQUAL(1, dictCheckCalls);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckManyNotImplemented_TestFixture,
+             EnchantDictionaryCheckManyNotImplemented_Negative1)
+{
+    std::vector<std::string> sWords;
+    sWords.push_back("hello");
+
+    CHECK_EQUAL(-1, CheckMany(_dict, sWords));
+    CHECK(IsMisspelled(0));
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckManyNotImplemented_TestFixture,
+             EnchantDictionaryCheckManyNotImplemented_InBrokerPwl_Misspelled)
+{
+    std::vector<std::string> sWords;
+    sWords.push_back("hello");
+    sWords.push_back("world");
+
+    CHECK_EQUAL(2, CheckMany(_pwl, sWords));
+    CHECK(IsMisspelled(0));
+    CHECK(IsMisspelled(1));
+}
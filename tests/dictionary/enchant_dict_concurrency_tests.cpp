@@ -0,0 +1,273 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+
+#define N_THREADS 8
+#define N_ITERATIONS 2000
+
+static gint providerCalls;
+static gint concurrentProviderCalls;
+static gint maxConcurrentProviderCalls;
+
+static void
+EnterProvider()
+{
+    g_atomic_int_inc(&providerCalls);
+    gint concurrent = g_atomic_int_add(&concurrentProviderCalls, 1) + 1;
+    gint max = g_atomic_int_get(&maxConcurrentProviderCalls);
+    while(concurrent > max && !g_atomic_int_compare_and_exchange(&maxConcurrentProviderCalls, max, concurrent))
+    {
+        max = g_atomic_int_get(&maxConcurrentProviderCalls);
+    }
+}
+
+static void
+LeaveProvider()
+{
+    g_atomic_int_add(&concurrentProviderCalls, -1);
+}
+
+static int
+MockDictionaryCheck (EnchantDict *, const char *const word, size_t len)
+{
+    EnterProvider();
+    int result = (strncmp("hello", word, len)==0) ? 0 : 1;
+    LeaveProvider();
+    return result;
+}
+
+static char**
+MockDictionaryCountingSuggest (EnchantDict * dict, 
+                               const char *const word,
+                               size_t len, 
+                               size_t * out_n_suggs)
+{
+    EnterProvider();
+    char** suggs = MockDictionarySuggest(dict, word, len, out_n_suggs);
+    LeaveProvider();
+    return suggs;
+}
+
+static EnchantDict* MockProviderRequestConcurrencyMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->check = MockDictionaryCheck;
+    dict->suggest = MockDictionaryCountingSuggest;
+    return dict;
+}
+
+static void DictionaryConcurrency_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestConcurrencyMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantDictionaryConcurrency_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionaryConcurrency_TestFixture():
+            EnchantDictionaryTestFixture(DictionaryConcurrency_ProviderConfiguration)
+    { 
+        providerCalls = 0;
+        concurrentProviderCalls = 0;
+        maxConcurrentProviderCalls = 0;
+        failures = 0;
+    }
+
+    void RunThreads(GThreadFunc func, int n_threads)
+    {
+        std::vector<GThread*> threads;
+        for(int i = 0; i < n_threads; ++i)
+        {
+            threads.push_back(g_thread_new("enchant test", func, this));
+        }
+        for(size_t i = 0; i < threads.size(); ++i)
+        {
+            g_thread_join(threads[i]);
+        }
+    }
+
+    void Fail()
+    {
+        g_atomic_int_inc(&failures);
+    }
+
+    gint failures;
+};
+
+static gpointer
+CheckAndSuggest(gpointer data)
+{
+    EnchantDictionaryConcurrency_TestFixture* fixture = static_cast<EnchantDictionaryConcurrency_TestFixture*>(data);
+    EnchantDict* dict = fixture->_dict;
+
+    for(int i = 0; i < N_ITERATIONS; ++i)
+    {
+        if(enchant_dict_check(dict, "hello", -1) != 0)
+            fixture->Fail();
+        if(enchant_dict_check(dict, "personal", -1) != 0)
+            fixture->Fail();
+        if(enchant_dict_check(dict, "helo", -1) != 1)
+            fixture->Fail();
+        if(enchant_dict_check(dict, "excluded", -1) != 1)
+            fixture->Fail();
+
+        if(i % 16 == 0)
+        {
+            size_t n_suggs;
+            char** suggs = enchant_dict_suggest(dict, "helo", -1, &n_suggs);
+            if(suggs == NULL || n_suggs < 4)
+                fixture->Fail();
+            enchant_dict_free_string_list(dict, suggs);
+        }
+    }
+    return NULL;
+}
+
+static gpointer
+ChangeWordLists(gpointer data)
+{
+    EnchantDictionaryConcurrency_TestFixture* fixture = static_cast<EnchantDictionaryConcurrency_TestFixture*>(data);
+    EnchantDict* dict = fixture->_dict;
+
+    for(int i = 0; i < N_ITERATIONS / 10; ++i)
+    {
+        char word[32];
+        snprintf(word, sizeof(word), "word%d", i);
+
+        enchant_dict_add_to_session(dict, word, -1);
+        if(enchant_dict_check(dict, word, -1) != 0)
+            fixture->Fail();
+        enchant_dict_remove_from_session(dict, word, -1);
+        if(enchant_dict_check(dict, word, -1) != 1)
+            fixture->Fail();
+
+        if(i % 20 == 0)
+        {
+            snprintf(word, sizeof(word), "personal%d", i);
+            enchant_dict_add(dict, word, -1);
+            if(enchant_dict_check(dict, word, -1) != 0)
+                fixture->Fail();
+        }
+    }
+    return NULL;
+}
+
+static gpointer
+SetAndGetErrors(gpointer data)
+{
+    EnchantDictionaryConcurrency_TestFixture* fixture = static_cast<EnchantDictionaryConcurrency_TestFixture*>(data);
+    EnchantDict* dict = fixture->_dict;
+    char error[64];
+    snprintf(error, sizeof(error), "error from %p", (void*)g_thread_self());
+
+    for(int i = 0; i < N_ITERATIONS; ++i)
+    {
+        enchant_dict_set_error(dict, error);
+        const char* err = enchant_dict_get_error(dict);
+        if(err == NULL || strcmp(err, error) != 0)
+            fixture->Fail();
+        enchant_dict_check(dict, "hello", -1);
+        if(enchant_dict_get_error(dict) != NULL)
+            fixture->Fail();
+    }
+    return NULL;
+}
+
+static gpointer
+RequestAndFreeDictionaries(gpointer data)
+{
+    EnchantDictionaryConcurrency_TestFixture* fixture = static_cast<EnchantDictionaryConcurrency_TestFixture*>(data);
+
+    for(int i = 0; i < N_ITERATIONS / 10; ++i)
+    {
+        EnchantDict* dict = enchant_broker_request_dict(fixture->_broker, "qaa");
+        if(dict == NULL)
+        {
+            fixture->Fail();
+            continue;
+        }
+        if(enchant_dict_check(dict, "hello", -1) != 0)
+            fixture->Fail();
+        enchant_broker_free_dict(fixture->_broker, dict);
+    }
+    return NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionaryConcurrency_TestFixture,
+             EnchantDictionaryConcurrency_CheckAndSuggestFromManyThreads_SameResults)
+{
+    enchant_dict_add(_dict, "personal", -1);
+    enchant_dict_remove(_dict, "excluded", -1);
+
+    RunThreads(CheckAndSuggest, N_THREADS);
+
+    CHECK_EQUAL(0, failures);
+    CHECK(providerCalls > 0);
+    CHECK_EQUAL(1, maxConcurrentProviderCalls);
+}
+
+TEST_FIXTURE(EnchantDictionaryConcurrency_TestFixture,
+             EnchantDictionaryConcurrency_WordListsChangedWhileChecking_SameResults)
+{
+    enchant_dict_add(_dict, "personal", -1);
+    enchant_dict_remove(_dict, "excluded", -1);
+
+    std::vector<GThread*> threads;
+    threads.push_back(g_thread_new("enchant test", ChangeWordLists, this));
+    for(int i = 0; i < N_THREADS; ++i)
+    {
+        threads.push_back(g_thread_new("enchant test", CheckAndSuggest, this));
+    }
+    for(size_t i = 0; i < threads.size(); ++i)
+    {
+        g_thread_join(threads[i]);
+    }
+
+    CHECK_EQUAL(0, failures);
+    CHECK(IsWordInDictionary("personal0"));
+    CHECK(IsWordInDictionary("personal180"));
+    CHECK(!IsWordInDictionary("word1"));
+}
+
+TEST_FIXTURE(EnchantDictionaryConcurrency_TestFixture,
+             EnchantDictionaryConcurrency_ErrorsFromManyThreads_EachThreadSeesItsOwn)
+{
+    RunThreads(SetAndGetErrors, N_THREADS);
+
+    CHECK_EQUAL(0, failures);
+}
+
+TEST_FIXTURE(EnchantDictionaryConcurrency_TestFixture,
+             EnchantDictionaryConcurrency_DictionariesRequestedFromManyThreads_Shared)
+{
+    RunThreads(RequestAndFreeDictionaries, N_THREADS);
+
+    CHECK_EQUAL(0, failures);
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "qaa");
+    CHECK_EQUAL(_dict, dict);
+    FreeDictionary(dict);
+}
@@ -0,0 +1,256 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+#include <map>
+#include <string>
+
+struct OperationStats
+{
+    std::string provider_name;
+    size_t count;
+    size_t total_usecs;
+    size_t histogram_count;
+    size_t n_buckets;
+};
+
+typedef std::map<std::string, OperationStats> OperationStatsMap;
+
+static void
+EnchantStatsCollector (const char * const provider_name,
+                       const char * const operation,
+                       size_t count,
+                       size_t total_usecs,
+                       const size_t * const histogram,
+                       size_t n_buckets,
+                       void * user_data)
+{
+    OperationStatsMap * stats = reinterpret_cast<OperationStatsMap*>(user_data);
+    OperationStats operationStats;
+    operationStats.provider_name = provider_name;
+    operationStats.count = count;
+    operationStats.total_usecs = total_usecs;
+    operationStats.histogram_count = 0;
+    for(size_t i = 0; i < n_buckets; ++i)
+        operationStats.histogram_count += histogram[i];
+    operationStats.n_buckets = n_buckets;
+    (*stats)[operation] = operationStats;
+}
+
+static int
+MockDictionaryCheck (EnchantDict *, const char *const word, size_t len)
+{
+    return (len == 5 && strncmp(word, "hello", len) == 0) ? 0 : 1;
+}
+
+static EnchantDict*
+MockProviderRequestStatsMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestBasicMockDictionary(me, tag);
+    dict->check = MockDictionaryCheck;
+    return dict;
+}
+
+static void DictionaryStats_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestStatsMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantDictionaryGetStats_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionaryGetStats_TestFixture():
+            EnchantDictionaryTestFixture(DictionaryStats_ProviderConfiguration)
+    { 
+        enchant_broker_set_stats_enabled(_broker, 1);
+    }
+
+    OperationStatsMap GetStats()
+    {
+        OperationStatsMap stats;
+        enchant_dict_get_stats(_dict, EnchantStatsCollector, &stats);
+        return stats;
+    }
+
+    size_t GetCount(const std::string& operation)
+    {
+        OperationStatsMap stats = GetStats();
+        OperationStatsMap::const_iterator it = stats.find(operation);
+        return it == stats.end() ? 0 : it->second.count;
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictGetStats_NothingDone_NothingReported)
+{
+    CHECK(GetStats().empty());
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictGetStats_NotEnabled_NothingReported)
+{
+    enchant_broker_set_stats_enabled(_broker, 0);
+    enchant_dict_check(_dict, "hello", -1);
+
+    CHECK(GetStats().empty());
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictGetStats_Check_Counted)
+{
+    enchant_dict_check(_dict, "hello", -1);
+    enchant_dict_check(_dict, "helo", -1);
+    enchant_dict_check(_dict, "hello", -1);
+
+    OperationStatsMap stats = GetStats();
+    CHECK_EQUAL(3u, stats["check"].count);
+    CHECK_EQUAL(3u, stats["check"].histogram_count);
+    CHECK_EQUAL(3u, stats["provider_check"].count);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictGetStats_CheckAnsweredFromCache_ProviderNotCounted)
+{
+    enchant_dict_set_check_cache_size(_dict, 10);
+    enchant_dict_check(_dict, "hello", -1);
+    enchant_dict_check(_dict, "hello", -1);
+
+    CHECK_EQUAL(2u, GetCount("check"));
+    CHECK_EQUAL(1u, GetCount("provider_check"));
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictGetStats_CheckInSession_ProviderNotCounted)
+{
+    enchant_dict_add_to_session(_dict, "helo", -1);
+    enchant_dict_check(_dict, "helo", -1);
+
+    CHECK_EQUAL(1u, GetCount("check"));
+    CHECK_EQUAL(0u, GetCount("provider_check"));
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictGetStats_CheckMany_CountedOnce)
+{
+    const char * words[] = {"hello", "helo", "hello"};
+    unsigned char misspelled[1];
+    enchant_dict_check_many(_dict, words, NULL, 3, misspelled);
+
+    CHECK_EQUAL(1u, GetCount("check_many"));
+    CHECK_EQUAL(0u, GetCount("check"));
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictGetStats_Suggest_Counted)
+{
+    size_t n_suggs;
+    char ** suggs = enchant_dict_suggest(_dict, "helo", -1, &n_suggs);
+    FreeStringList(suggs);
+
+    CHECK_EQUAL(1u, GetCount("suggest"));
+    CHECK_EQUAL(1u, GetCount("provider_suggest"));
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictGetStats_AddAndRemove_Counted)
+{
+    enchant_dict_add(_dict, "hello", -1);
+    enchant_dict_add(_dict, "world", -1);
+    enchant_dict_remove(_dict, "hello", -1);
+
+    CHECK_EQUAL(2u, GetCount("add"));
+    CHECK_EQUAL(1u, GetCount("remove"));
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictGetStats_WordAddedAndRemoved_FileRewritten)
+{
+    enchant_dict_add(_dict, "hello", -1);
+    enchant_dict_remove(_dict, "hello", -1);
+
+    CHECK(GetCount("pwl_rewrite") >= 1);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictGetStats_FileChangedByOthers_RefreshCounted)
+{
+    enchant_dict_check(_dict, "hello", -1);
+    ExternalAddWordToDictionary("elephant");
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "elephant", -1));
+
+    CHECK(GetCount("pwl_refresh") >= 1);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictGetStats_Disabled_StopsCounting)
+{
+    enchant_dict_check(_dict, "hello", -1);
+    enchant_broker_set_stats_enabled(_broker, 0);
+    enchant_dict_check(_dict, "hello", -1);
+
+    CHECK_EQUAL(1u, GetCount("check"));
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictGetStats_ReportedUnderProviderName)
+{
+    enchant_dict_check(_dict, "hello", -1);
+
+    OperationStatsMap stats = GetStats();
+    CHECK_EQUAL(std::string("mock"), stats["check"].provider_name);
+    CHECK(stats["check"].n_buckets > 1);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictGetStats_PerThreadDict_CountsWithSharedDict)
+{
+    EnchantDict* dict = enchant_broker_request_dict_for_thread(_broker, "qaa");
+    enchant_dict_check(dict, "hello", -1);
+    enchant_dict_check(_dict, "hello", -1);
+
+    CHECK_EQUAL(2u, GetCount("check"));
+
+    FreeDictionary(dict);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictGetStats_NullDict_DoNothing)
+{
+    OperationStatsMap stats;
+    enchant_dict_get_stats(NULL, EnchantStatsCollector, &stats);
+    CHECK(stats.empty());
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictGetStats_NullFn_DoNothing)
+{
+    enchant_dict_check(_dict, "hello", -1);
+    enchant_dict_get_stats(_dict, NULL, NULL);
+}
@@ -99,6 +99,63 @@ TEST_FIXTURE(EnchantDictionaryRemoveFromSession_TestFixture,
     CHECK(!IsWordInSession("hello"));
 }
 
+TEST_FIXTURE(EnchantDictionaryRemoveFromSession_TestFixture,
+             EnchantDictionaryRemoveFromSession_AddedAndRemovedRepeatedly_LastOneWins)
+{
+    for (int i = 0; i < 5; i++)
+    {
+        enchant_dict_add_to_session(_dict, "hello", -1);
+        CHECK(IsWordInSession("hello"));
+        enchant_dict_remove_from_session(_dict, "hello", -1);
+        CHECK(!IsWordInSession("hello"));
+        CHECK(!IsWordInDictionary("hello"));
+    }
+}
+
+TEST_FIXTURE(EnchantDictionaryRemoveFromSession_TestFixture,
+             EnchantDictionaryRemoveFromSession_OneOfMany_OthersStillInSession)
+{
+    char word[32];
+    for (int i = 0; i < 100; i++)
+    {
+        snprintf(word, sizeof(word), "session%d", i);
+        enchant_dict_add_to_session(_dict, word, -1);
+    }
+
+    enchant_dict_remove_from_session(_dict, "session42", -1);
+
+    for (int i = 0; i < 100; i++)
+    {
+        snprintf(word, sizeof(word), "session%d", i);
+        CHECK_EQUAL(i != 42, IsWordInSession(word));
+    }
+}
+
+TEST_FIXTURE(EnchantDictionaryRemoveFromSession_TestFixture,
+             EnchantDictionaryRemoveFromSession_MostOfMany_OthersStillInSession)
+{
+    char word[32];
+    for (int i = 0; i < 100; i++)
+    {
+        snprintf(word, sizeof(word), "session%d", i);
+        enchant_dict_add_to_session(_dict, word, -1);
+    }
+
+    for (int i = 0; i < 100; i++)
+    {
+        snprintf(word, sizeof(word), "session%d", i);
+        if (i % 10 != 0)
+            enchant_dict_remove_from_session(_dict, word, -1);
+    }
+    enchant_dict_add_to_session(_dict, "session42", -1);
+
+    for (int i = 0; i < 100; i++)
+    {
+        snprintf(word, sizeof(word), "session%d", i);
+        CHECK_EQUAL(i % 10 == 0 || i == 42, IsWordInSession(word));
+    }
+}
+
 TEST_FIXTURE(EnchantDictionaryRemoveFromSession_TestFixture,
              EnchantDictionaryRemoveFromSession_WordExcludedFromDictionary)
 {
@@ -0,0 +1,410 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+
+static GMutex suggestMutex;
+static GCond suggestCond;
+static bool gateOpen;
+static int suggestCalls;
+static int concurrentSuggestCalls;
+static int maxConcurrentSuggestCalls;
+static int callbackCalls;
+
+static char**
+MockDictionaryGatedSuggest (EnchantDict * dict, 
+                            const char *const word,
+                            size_t len, 
+                            size_t * out_n_suggs)
+{
+    g_mutex_lock(&suggestMutex);
+    suggestCalls++;
+    concurrentSuggestCalls++;
+    if(concurrentSuggestCalls > maxConcurrentSuggestCalls)
+    {
+        maxConcurrentSuggestCalls = concurrentSuggestCalls;
+    }
+    g_cond_broadcast(&suggestCond);
+    while(!gateOpen)
+    {
+        g_cond_wait(&suggestCond, &suggestMutex);
+    }
+    g_mutex_unlock(&suggestMutex);
+
+    char** suggs = MockDictionarySuggest(dict, word, len, out_n_suggs);
+
+    g_mutex_lock(&suggestMutex);
+    concurrentSuggestCalls--;
+    g_mutex_unlock(&suggestMutex);
+
+    return suggs;
+}
+
+static EnchantDict*
+MockProviderRequestGatedSuggestMockDictionary(EnchantProvider *me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->suggest = MockDictionaryGatedSuggest;
+    return dict;
+}
+
+static void DictionarySuggestAsync_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestGatedSuggestMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+static void
+CountingCallback (EnchantSuggestRequest * request, void * user_data)
+{
+    size_t n_suggs = 0;
+    enchant_suggest_request_get_suggestions(request, &n_suggs);
+
+    g_mutex_lock(&suggestMutex);
+    callbackCalls++;
+    *static_cast<size_t*>(user_data) = n_suggs;
+    g_cond_broadcast(&suggestCond);
+    g_mutex_unlock(&suggestMutex);
+}
+
+static void
+FreeingCallback (EnchantSuggestRequest * request, void * user_data)
+{
+    CountingCallback(request, user_data);
+    enchant_suggest_request_free(request);
+}
+
+static gpointer
+OpenGateWhenDone (gpointer data)
+{
+    EnchantSuggestRequest* request = static_cast<EnchantSuggestRequest*>(data);
+    while(!enchant_suggest_request_is_done(request))
+    {
+        g_usleep(1000);
+    }
+
+    g_mutex_lock(&suggestMutex);
+    gateOpen = true;
+    g_cond_broadcast(&suggestCond);
+    g_mutex_unlock(&suggestMutex);
+    return NULL;
+}
+
+struct EnchantDictionarySuggestAsync_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionarySuggestAsync_TestFixture():
+            EnchantDictionaryTestFixture(DictionarySuggestAsync_ProviderConfiguration)
+    { 
+        gateOpen = true;
+        suggestCalls = 0;
+        concurrentSuggestCalls = 0;
+        maxConcurrentSuggestCalls = 0;
+        callbackCalls = 0;
+    }
+
+    //Teardown
+    ~EnchantDictionarySuggestAsync_TestFixture()
+    {
+        OpenGate();
+    }
+
+    void CloseGate()
+    {
+        g_mutex_lock(&suggestMutex);
+        gateOpen = false;
+        g_mutex_unlock(&suggestMutex);
+    }
+
+    void OpenGate()
+    {
+        g_mutex_lock(&suggestMutex);
+        gateOpen = true;
+        g_cond_broadcast(&suggestCond);
+        g_mutex_unlock(&suggestMutex);
+    }
+
+    void WaitForSuggestCalls(int n)
+    {
+        g_mutex_lock(&suggestMutex);
+        while(suggestCalls < n)
+        {
+            g_cond_wait(&suggestCond, &suggestMutex);
+        }
+        g_mutex_unlock(&suggestMutex);
+    }
+
+    void WaitForCallbacks(int n)
+    {
+        g_mutex_lock(&suggestMutex);
+        while(callbackCalls < n)
+        {
+            g_cond_wait(&suggestCond, &suggestMutex);
+        }
+        g_mutex_unlock(&suggestMutex);
+    }
+
+    std::vector<std::string> GetSuggestionsFromRequest(EnchantSuggestRequest* request)
+    {
+        std::vector<std::string> result;
+        size_t cSuggestions;
+        char** suggestions = enchant_suggest_request_get_suggestions(request, &cSuggestions);
+        if(suggestions != NULL)
+        {
+            result.insert(result.begin(), suggestions, suggestions+cSuggestions);
+        }
+        return result;
+    }
+};
+
+/**
+ * enchant_dict_suggest_async
+ * @dict: A non-null #EnchantDict
+ * @word: The non-null word you wish to find suggestions for, in UTF-8 encoding
+ * @len: The byte length of @word, or -1 for strlen (@word)
+ * @callback: The function to call once the suggestions are ready, or %null
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Finds the suggestions enchant_dict_suggest would give on a worker thread
+ * of the broker. Requests on one dictionary are handled one at a time and
+ * in order, and other calls on the dictionary wait while one is handled,
+ * so providers are never used from two threads at once. Freeing the
+ * dictionary cancels the requests made on it that have not started yet.
+ *
+ * Returns: A request to be freed with enchant_suggest_request_free, or %null
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_Wait_SameSuggestionsAsSuggest)
+{
+    EnchantSuggestRequest* request = enchant_dict_suggest_async(_dict, "helo", -1, NULL, NULL);
+    CHECK(request);
+    enchant_suggest_request_wait(request);
+
+    CHECK(enchant_suggest_request_is_done(request));
+    std::vector<std::string> suggestions = GetSuggestionsFromRequest(request);
+    CHECK_EQUAL(4, suggestions.size());
+    CHECK(GetSuggestionsFromWord("helo") == suggestions);
+
+    enchant_suggest_request_free(request);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_LenSpecified_SuggestionsForThoseBytes)
+{
+    EnchantSuggestRequest* request = enchant_dict_suggest_async(_dict, "helodisregard me", 4, NULL, NULL);
+    enchant_suggest_request_wait(request);
+
+    CHECK(GetSuggestionsFromWord("helo") == GetSuggestionsFromRequest(request));
+
+    enchant_suggest_request_free(request);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_Callback_CalledOnceWithUserData)
+{
+    size_t n_suggs = 0;
+    EnchantSuggestRequest* request = enchant_dict_suggest_async(_dict, "helo", -1, CountingCallback, &n_suggs);
+    WaitForCallbacks(1);
+
+    CHECK_EQUAL(1, callbackCalls);
+    CHECK_EQUAL(4, n_suggs);
+
+    enchant_suggest_request_free(request);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_FreedFromCallback_Ok)
+{
+    size_t n_suggs = 0;
+    enchant_dict_suggest_async(_dict, "helo", -1, FreeingCallback, &n_suggs);
+    WaitForCallbacks(1);
+
+    CHECK_EQUAL(4, n_suggs);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_NotDone_NoSuggestions)
+{
+    CloseGate();
+    EnchantSuggestRequest* request = enchant_dict_suggest_async(_dict, "helo", -1, NULL, NULL);
+    WaitForSuggestCalls(1);
+
+    CHECK(!enchant_suggest_request_is_done(request));
+    size_t n_suggs = 1;
+    CHECK_EQUAL((void*)NULL, (void*)enchant_suggest_request_get_suggestions(request, &n_suggs));
+    CHECK_EQUAL(0, n_suggs);
+
+    OpenGate();
+    enchant_suggest_request_wait(request);
+    CHECK_EQUAL(4, GetSuggestionsFromRequest(request).size());
+
+    enchant_suggest_request_free(request);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_ManyRequests_OneAtATimeInOrder)
+{
+    std::vector<EnchantSuggestRequest*> requests;
+    std::vector<std::string> words;
+    for(int i = 0; i < 20; ++i)
+    {
+        words.push_back(std::string("helo") + (char)('a' + i));
+        requests.push_back(enchant_dict_suggest_async(_dict, words.back().c_str(), -1, NULL, NULL));
+    }
+
+    for(size_t i = 0; i < requests.size(); ++i)
+    {
+        enchant_suggest_request_wait(requests[i]);
+        CHECK(GetSuggestionsFromWord(words[i]) == GetSuggestionsFromRequest(requests[i]));
+        enchant_suggest_request_free(requests[i]);
+    }
+
+    CHECK_EQUAL(1, maxConcurrentSuggestCalls);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_CancelNotStarted_DoneWithoutCallingProvider)
+{
+    size_t n_suggs = 0;
+    CloseGate();
+    EnchantSuggestRequest* running = enchant_dict_suggest_async(_dict, "helo", -1, CountingCallback, &n_suggs);
+    WaitForSuggestCalls(1);
+    EnchantSuggestRequest* queued = enchant_dict_suggest_async(_dict, "hello", -1, CountingCallback, &n_suggs);
+
+    enchant_suggest_request_cancel(queued);
+    CHECK(enchant_suggest_request_is_done(queued));
+    CHECK_EQUAL((void*)NULL, (void*)enchant_suggest_request_get_suggestions(queued, NULL));
+
+    OpenGate();
+    WaitForCallbacks(1);
+    enchant_suggest_request_free(running);
+    enchant_suggest_request_free(queued);
+
+    FreeTestDictionary();
+    _dict = NULL;
+    CHECK_EQUAL(1, suggestCalls);
+    CHECK_EQUAL(1, callbackCalls);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_CancelRunning_DoneWithoutCallback)
+{
+    size_t n_suggs = 0;
+    CloseGate();
+    EnchantSuggestRequest* running = enchant_dict_suggest_async(_dict, "helo", -1, CountingCallback, &n_suggs);
+    WaitForSuggestCalls(1);
+
+    enchant_suggest_request_cancel(running);
+    CHECK(enchant_suggest_request_is_done(running));
+    enchant_suggest_request_wait(running);
+
+    OpenGate();
+    FreeTestDictionary();
+    _dict = NULL;
+
+    CHECK_EQUAL(0, callbackCalls);
+    CHECK_EQUAL((void*)NULL, (void*)enchant_suggest_request_get_suggestions(running, NULL));
+    enchant_suggest_request_free(running);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_DictionaryFreed_PendingRequestsCancelled)
+{
+    size_t n_suggs = 0;
+    CloseGate();
+    EnchantSuggestRequest* running = enchant_dict_suggest_async(_dict, "helo", -1, CountingCallback, &n_suggs);
+    WaitForSuggestCalls(1);
+    EnchantSuggestRequest* queued = enchant_dict_suggest_async(_dict, "hello", -1, CountingCallback, &n_suggs);
+
+    GThread* opener = g_thread_new("open gate", OpenGateWhenDone, queued);
+    FreeTestDictionary();
+    _dict = NULL;
+    g_thread_join(opener);
+
+    CHECK(enchant_suggest_request_is_done(running));
+    CHECK(enchant_suggest_request_is_done(queued));
+    CHECK_EQUAL(4, GetSuggestionsFromRequest(running).size());
+    CHECK_EQUAL(0, GetSuggestionsFromRequest(queued).size());
+    CHECK_EQUAL(1, suggestCalls);
+    CHECK_EQUAL(1, callbackCalls);
+
+    enchant_suggest_request_free(running);
+    enchant_suggest_request_free(queued);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_InBrokerPwl_SameSuggestionsAsSuggest)
+{
+    enchant_dict_add(_pwl, "hello", -1);
+    EnchantSuggestRequest* request = enchant_dict_suggest_async(_pwl, "helo", -1, NULL, NULL);
+    enchant_suggest_request_wait(request);
+
+    std::vector<std::string> suggestions = GetSuggestionsFromRequest(request);
+    CHECK_EQUAL(1, suggestions.size());
+    if(suggestions.size() == 1)
+    {
+        CHECK_EQUAL("hello", suggestions[0]);
+    }
+
+    enchant_suggest_request_free(request);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_NullDictionary_NullRequest)
+{
+    CHECK_EQUAL((void*)NULL, (void*)enchant_dict_suggest_async(NULL, "helo", -1, NULL, NULL));
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_NullWord_NullRequest)
+{
+    CHECK_EQUAL((void*)NULL, (void*)enchant_dict_suggest_async(_dict, NULL, -1, NULL, NULL));
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_EmptyWord_NullRequest)
+{
+    CHECK_EQUAL((void*)NULL, (void*)enchant_dict_suggest_async(_dict, "", -1, NULL, NULL));
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_InvalidUtf8Word_NullRequest)
+{
+    CHECK_EQUAL((void*)NULL, (void*)enchant_dict_suggest_async(_dict, "\xa5\xf1\x08", -1, NULL, NULL));
+    CHECK_EQUAL(0, suggestCalls);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantSuggestRequest_NullRequest_DoNothing)
+{
+    CHECK_EQUAL(0, enchant_suggest_request_is_done(NULL));
+    CHECK_EQUAL((void*)NULL, (void*)enchant_suggest_request_get_suggestions(NULL, NULL));
+    enchant_suggest_request_wait(NULL);
+    enchant_suggest_request_cancel(NULL);
+    enchant_suggest_request_free(NULL);
+}
@@ -0,0 +1,239 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+
+static int providerSuggestCount;
+
+static char**
+MockDictionaryCountingSuggest (EnchantDict * dict, 
+                               const char *const word,
+                               size_t len, 
+                               size_t * out_n_suggs)
+{
+    providerSuggestCount++;
+    return MockDictionarySuggest(dict, word, len, out_n_suggs);
+}
+
+static EnchantDict* MockProviderRequestSuggestMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->suggest = MockDictionaryCountingSuggest;
+    return dict;
+}
+
+static void DictionarySuggestCache_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestSuggestMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantDictionarySuggestCache_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionarySuggestCache_TestFixture():
+            EnchantDictionaryTestFixture(DictionarySuggestCache_ProviderConfiguration)
+    { 
+        providerSuggestCount = 0;
+        enchant_dict_set_suggest_cache_size(_dict, 100);
+    }
+
+    std::vector<std::string> Suggest(const char* word)
+    {
+        std::vector<std::string> result;
+        size_t n_suggs = 0;
+        char** suggs = enchant_dict_suggest(_dict, word, -1, &n_suggs);
+        for(size_t i = 0; i < n_suggs; ++i)
+        {
+            result.push_back(suggs[i]);
+        }
+        FreeStringList(suggs);
+        return result;
+    }
+
+    size_t Hits()
+    {
+        size_t hits;
+        enchant_dict_get_suggest_cache_stats(_dict, &hits, NULL);
+        return hits;
+    }
+
+    size_t Misses()
+    {
+        size_t misses;
+        enchant_dict_get_suggest_cache_stats(_dict, NULL, &misses);
+        return misses;
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionarySuggestCache_TestFixture,
+             EnchantDictionarySuggestCache_SuggestedTwice_ProviderAskedOnce)
+{
+    std::vector<std::string> first = Suggest("helo");
+    std::vector<std::string> second = Suggest("helo");
+
+    CHECK_EQUAL(4, second.size());
+    CHECK(first == second);
+    CHECK_EQUAL(1, providerSuggestCount);
+    CHECK_EQUAL(1, Hits());
+    CHECK_EQUAL(1, Misses());
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestCache_TestFixture,
+             EnchantDictionarySuggestCache_SuggestedTwice_EachCallerOwnsItsList)
+{
+    size_t n_suggs;
+    char** first = enchant_dict_suggest(_dict, "helo", -1, &n_suggs);
+    char** second = enchant_dict_suggest(_dict, "helo", -1, &n_suggs);
+
+    CHECK(first != second);
+    FreeStringList(first);
+    CHECK_EQUAL(std::string("aelo"), second[0]);
+    FreeStringList(second);
+
+    CHECK_EQUAL(4, Suggest("helo").size());
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestCache_TestFixture,
+             EnchantDictionarySuggestCache_NoOutCount_ListStillReturned)
+{
+    Suggest("helo");
+    char** suggs = enchant_dict_suggest(_dict, "helo", -1, NULL);
+    CHECK(suggs);
+    CHECK_EQUAL(1, providerSuggestCount);
+    FreeStringList(suggs);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestCache_TestFixture,
+             EnchantDictionarySuggestCache_SizeZero_ProviderAskedEachTime)
+{
+    enchant_dict_set_suggest_cache_size(_dict, 0);
+    Suggest("helo");
+    Suggest("helo");
+    CHECK_EQUAL(2, providerSuggestCount);
+    CHECK_EQUAL(0, Hits());
+    CHECK_EQUAL(0, Misses());
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestCache_TestFixture,
+             EnchantDictionarySuggestCache_Full_LeastRecentlyUsedForgotten)
+{
+    enchant_dict_set_suggest_cache_size(_dict, 1);
+    Suggest("helo");
+    Suggest("wrld");
+    Suggest("wrld");
+    CHECK_EQUAL(2, providerSuggestCount);
+    Suggest("helo");
+    CHECK_EQUAL(3, providerSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestCache_TestFixture,
+             EnchantDictionarySuggestCache_SuggestionRemoved_CacheInvalidated)
+{
+    Suggest("helo");
+    enchant_dict_remove(_dict, "aelo", -1);
+
+    std::vector<std::string> suggestions = Suggest("helo");
+    CHECK_EQUAL(3, suggestions.size());
+    CHECK_EQUAL(std::string("belo"), suggestions[0]);
+    CHECK_EQUAL(2, providerSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestCache_TestFixture,
+             EnchantDictionarySuggestCache_SuggestionRemovedFromSession_CacheInvalidated)
+{
+    Suggest("helo");
+    enchant_dict_remove_from_session(_dict, "aelo", -1);
+    CHECK_EQUAL(3, Suggest("helo").size());
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestCache_TestFixture,
+             EnchantDictionarySuggestCache_WordAdded_CacheInvalidated)
+{
+    Suggest("helo");
+    enchant_dict_add(_dict, "heloo", -1);
+    CHECK_EQUAL(5, Suggest("helo").size());
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestCache_TestFixture,
+             EnchantDictionarySuggestCache_WordAddedToSession_CacheInvalidated)
+{
+    Suggest("helo");
+    enchant_dict_remove_from_session(_dict, "aelo", -1);
+    Suggest("helo");
+    enchant_dict_add_to_session(_dict, "aelo", -1);
+    CHECK_EQUAL(4, Suggest("helo").size());
+    CHECK_EQUAL(3, providerSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestCache_TestFixture,
+             EnchantDictionarySuggestCache_WordAddedToExcludeExternally_CacheInvalidated)
+{
+    Suggest("helo");
+    ExternalAddWordToExclude("aelo");
+    CHECK_EQUAL(3, Suggest("helo").size());
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestCache_TestFixture,
+             EnchantDictionarySuggestCache_Async_UsesCache)
+{
+    Suggest("helo");
+
+    EnchantSuggestRequest* request = enchant_dict_suggest_async(_dict, "helo", -1, NULL, NULL);
+    enchant_suggest_request_wait(request);
+    size_t n_suggs;
+    enchant_suggest_request_get_suggestions(request, &n_suggs);
+    enchant_suggest_request_free(request);
+
+    CHECK_EQUAL(4, n_suggs);
+    CHECK_EQUAL(1, providerSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestCache_TestFixture,
+             EnchantDictionarySuggestCache_SharedWithThreadDictionary)
+{
+    EnchantDict* dict = enchant_broker_request_dict_for_thread(_broker, "qaa");
+    Suggest("helo");
+
+    size_t n_suggs;
+    char** suggs = enchant_dict_suggest(dict, "helo", -1, &n_suggs);
+    CHECK_EQUAL(4, n_suggs);
+    CHECK_EQUAL(1, providerSuggestCount);
+    enchant_dict_free_string_list(dict, suggs);
+
+    FreeDictionary(dict);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionarySuggestCache_TestFixture,
+             EnchantDictionarySuggestCache_NullDictionary_DoNothing)
+{
+    size_t hits = 7, misses = 7;
+    enchant_dict_set_suggest_cache_size(NULL, 10);
+    enchant_dict_get_suggest_cache_stats(NULL, &hits, &misses);
+    CHECK_EQUAL(7, hits);
+    CHECK_EQUAL(7, misses);
+}
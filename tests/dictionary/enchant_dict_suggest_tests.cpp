@@ -35,7 +35,8 @@ static enum SuggestBehavior{
     returnZero,
     returnFour,
     returnFourOneInvalidUtf8,
-    returnFianceNfc
+    returnFianceNfc,
+    returnFianceNfcAndNfdTwice
 } suggestBehavior;
 
 struct EnchantDictionarySuggestTestFixtureBase : EnchantDictionaryTestFixture
@@ -79,6 +80,14 @@ MyMockDictionarySuggest (EnchantDict * dict, const char *const word, size_t len,
             sugg_arr = g_new0 (char *, *out_n_suggs + 1);
             sugg_arr[0] = g_strdup ("fianc\xc3\xa9");  // c3 a9 = utf8 for u00e9 = Latin small letter e with acute
             break;
+        case returnFianceNfcAndNfdTwice:
+            *out_n_suggs = 4;
+            sugg_arr = g_new0 (char *, *out_n_suggs + 1);
+            sugg_arr[0] = g_strdup ("fianc\xc3\xa9");
+            sugg_arr[1] = g_strdup ("fiance\xcc\x81");  // e followed by u0301 = combining acute accent
+            sugg_arr[2] = g_strdup ("fianc\xc3\xa9");
+            sugg_arr[3] = g_strdup ("fiance\xcc\x81");
+            break;
         case returnFour:
             sugg_arr = MockDictionarySuggest(dict, word, len, out_n_suggs);
             break;
@@ -255,6 +264,33 @@ TEST_FIXTURE(EnchantDictionarySuggest_TestFixture,
     CHECK_ARRAY_EQUAL(GetExpectedSuggestions("helo"), suggestions, std::min((size_t)4,cSuggestions));
 }
 
+TEST_FIXTURE(EnchantDictionarySuggest_TestFixture,
+             EnchantDictionarySuggest_CanonicallyEquivalentSuggestions_OnlyFirstIncluded)
+{
+    size_t cSuggestions;
+
+    suggestBehavior = returnFianceNfcAndNfdTwice;
+    _suggestions = enchant_dict_suggest(_dict, "fiance", -1, &cSuggestions);
+    CHECK(_suggestions);
+    CHECK_EQUAL(1, cSuggestions);
+    if(_suggestions != NULL){
+        CHECK_EQUAL(std::string("fianc\xc3\xa9"), _suggestions[0]);
+        CHECK(!_suggestions[1]);
+    }
+}
+
+TEST_FIXTURE(EnchantDictionarySuggest_TestFixture,
+             EnchantDictionarySuggest_CanonicallyEquivalentSuggestionFromPersonal_NotIncluded)
+{
+    size_t cSuggestions;
+
+    suggestBehavior = returnFianceNfc;
+    enchant_dict_add(_dict, "fiance\xcc\x81", -1);
+    _suggestions = enchant_dict_suggest(_dict, "fiance", -1, &cSuggestions);
+    CHECK(_suggestions);
+    CHECK_EQUAL(1, cSuggestions);
+}
+
 TEST_FIXTURE(EnchantDictionarySuggest_TestFixture,
              EnchantDictionarySuggest_SuggestionExcluded_Null)
 {
@@ -0,0 +1,349 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Measures the throughput of the main operations against the mock
+ * provider, whose dictionary and the personal word list hold synthetic
+ * words. Results are written as tab separated lines, one per benchmark,
+ * so that runs on different commits can be compared. */
+
+#include "EnchantBrokerTestFixture.h"
+#include <stdio.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+EnchantProvider * EnchantBrokerTestFixture::mock_provider=NULL;
+ConfigureHook EnchantBrokerTestFixture::userMockProviderConfiguration=NULL;
+ConfigureHook EnchantBrokerTestFixture::userMockProvider2Configuration=NULL;
+
+static std::unordered_set<std::string> dictionaryWords;
+static std::vector<std::string> unrelatedSuggestions;
+
+/* How many suggestions the en_GB dictionary makes for every word */
+#define BENCH_UNRELATED_SUGGS 16
+
+/* Words of 4 to 11 lower case letters, the same on every run */
+struct SyntheticWords
+{
+    guint32 state;
+
+    SyntheticWords(guint32 seed) : state(seed) {}
+
+    guint32 Next()
+    {
+        state = state * 1103515245 + 12345;
+        return state >> 16;
+    }
+
+    std::string Word()
+    {
+        std::string word;
+        size_t len = 4 + Next() % 8;
+        for(size_t i = 0; i < len; ++i)
+            word += (char)('a' + Next() % 26);
+        return word;
+    }
+};
+
+static int
+BenchDictionaryCheck (EnchantDict *, const char *const word, size_t len)
+{
+    return dictionaryWords.count(std::string(word, len)) ? 0 : 1;
+}
+
+static char **
+BenchDictionarySuggest (EnchantDict *, const char *const word, size_t len, size_t* out_n_suggs)
+{
+    char ** suggs = g_new0 (char *, 4);
+    for(size_t i = 0; i < 3; ++i)
+    {
+        suggs[i] = g_strndup (word, len);
+        suggs[i][i % len] = 'a' + i;
+    }
+    *out_n_suggs = 3;
+    return suggs;
+}
+
+/* Dictionary words unlike the misspelled one, so that comparing each
+ * with it runs the whole edit distance computation */
+static char **
+BenchDictionarySuggestUnrelated (EnchantDict *, const char *const, size_t, size_t* out_n_suggs)
+{
+    char ** suggs = g_new0 (char *, unrelatedSuggestions.size() + 1);
+    for(size_t i = 0; i < unrelatedSuggestions.size(); ++i)
+        suggs[i] = g_strdup (unrelatedSuggestions[i].c_str());
+    *out_n_suggs = unrelatedSuggestions.size();
+    return suggs;
+}
+
+static EnchantDict*
+BenchRequestDictionary (EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockEnGbAndQaaProviderRequestDictionary(me, tag);
+    if(dict)
+    {
+        dict->check = BenchDictionaryCheck;
+        if(strcmp(tag, "en_GB") == 0)
+            dict->suggest = BenchDictionarySuggestUnrelated;
+        else
+            dict->suggest = BenchDictionarySuggest;
+    }
+    return dict;
+}
+
+static void Bench_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = BenchRequestDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantBenchmark : EnchantBrokerTestFixture
+{
+    size_t _dictSize, _pwlSize, _nWords, _nEdits, _nInits;
+    std::vector<std::string> _dictWords, _pwlWords, _misspelledWords;
+
+    EnchantBenchmark(size_t dictSize, size_t pwlSize, size_t nWords, size_t nEdits, size_t nInits):
+            EnchantBrokerTestFixture(Bench_ProviderConfiguration),
+            _dictSize(dictSize), _pwlSize(pwlSize), _nWords(nWords), _nEdits(nEdits), _nInits(nInits)
+    {
+        SyntheticWords words(42);
+
+        for(size_t i = 0; i < _dictSize; ++i)
+        {
+            _dictWords.push_back(words.Word());
+            dictionaryWords.insert(_dictWords.back());
+        }
+        for(size_t i = 0; i < BENCH_UNRELATED_SUGGS; ++i)
+        {
+            unrelatedSuggestions.push_back(words.Word());
+            dictionaryWords.insert(unrelatedSuggestions.back());
+        }
+
+        std::string pwl;
+        for(size_t i = 0; i < _pwlSize; ++i)
+        {
+            _pwlWords.push_back(words.Word());
+            pwl += _pwlWords.back() + "\n";
+        }
+        g_file_set_contents(AddToPath(GetTempUserEnchantDir(), "qaa.dic").c_str(),
+                            pwl.c_str(), pwl.size(), NULL);
+
+        /* the upper case letter keeps them out of both word lists */
+        for(size_t i = 0; i < _nWords; ++i)
+            _misspelledWords.push_back(words.Word() + "Q");
+    }
+
+    ~EnchantBenchmark()
+    {
+        dictionaryWords.clear();
+        unrelatedSuggestions.clear();
+    }
+
+    /* Half dictionary words, a quarter from the PWL and a quarter misspelled */
+    std::vector<std::string> Corpus()
+    {
+        std::vector<std::string> corpus;
+        SyntheticWords picks(7);
+
+        for(size_t i = 0; i < _nWords; ++i)
+        {
+            if(i % 4 < 2 && !_dictWords.empty())
+                corpus.push_back(_dictWords[picks.Next() % _dictWords.size()]);
+            else if(i % 4 == 2 && !_pwlWords.empty())
+                corpus.push_back(_pwlWords[picks.Next() % _pwlWords.size()]);
+            else
+                corpus.push_back(_misspelledWords[i]);
+        }
+        return corpus;
+    }
+
+    static void Report(const char * benchmark, size_t operations, gint64 start)
+    {
+        gint64 usecs = MAX (g_get_monotonic_time () - start, 1);
+        printf("%s\t%lu\t%ld\t%.0f\n", benchmark, (unsigned long) operations,
+               (long) usecs, operations * 1e6 / usecs);
+    }
+
+    void Run()
+    {
+        gint64 start;
+        size_t i;
+
+        printf("# dict_size=%lu pwl_size=%lu words=%lu edits=%lu inits=%lu\n",
+               (unsigned long) _dictSize, (unsigned long) _pwlSize, (unsigned long) _nWords,
+               (unsigned long) _nEdits, (unsigned long) _nInits);
+        printf("benchmark\toperations\tusecs\tper_sec\n");
+
+        start = g_get_monotonic_time ();
+        for(i = 0; i < _nInits; ++i)
+            enchant_broker_free(enchant_broker_init());
+        Report("broker_init", _nInits, start);
+
+        start = g_get_monotonic_time ();
+        EnchantDict* dict = RequestDictionary("qaa");
+        Report("request_dict", 1, start);
+        if(dict == NULL)
+        {
+            fprintf(stderr, "enchant_bench: the mock provider gave no dictionary\n");
+            return;
+        }
+
+        std::vector<std::string> corpus = Corpus();
+
+        start = g_get_monotonic_time ();
+        for(i = 0; i < corpus.size(); ++i)
+            enchant_dict_check(dict, corpus[i].c_str(), corpus[i].size());
+        Report("check", corpus.size(), start);
+
+        start = g_get_monotonic_time ();
+        for(i = 0; i < corpus.size(); ++i)
+            enchant_dict_check(dict, corpus[i].c_str(), corpus[i].size());
+        Report("check_again", corpus.size(), start);
+
+        std::vector<const char *> words;
+        std::vector<ssize_t> lens;
+        for(i = 0; i < corpus.size(); ++i)
+        {
+            words.push_back(corpus[i].c_str());
+            lens.push_back(corpus[i].size());
+        }
+        std::vector<unsigned char> misspelled(100 / 8 + 1);
+        start = g_get_monotonic_time ();
+        for(i = 0; i < corpus.size(); i += 100)
+            enchant_dict_check_many(dict, &words[i], &lens[i],
+                                    MIN (corpus.size() - i, (size_t) 100), &misspelled[0]);
+        Report("check_many", corpus.size(), start);
+
+        size_t nSuggest = MAX (_nWords / 100, (size_t) 1);
+        start = g_get_monotonic_time ();
+        for(i = 0; i < nSuggest && i < _misspelledWords.size(); ++i)
+        {
+            size_t n_suggs;
+            char ** suggs = enchant_dict_suggest(dict, _misspelledWords[i].c_str(),
+                                                 _misspelledWords[i].size(), &n_suggs);
+            enchant_dict_free_string_list(dict, suggs);
+        }
+        Report("suggest", i, start);
+
+        /* The personal word list alone, asked for words one letter off.
+         * It has no provider suggestions to compare with, so this times
+         * the search of its trie for words within the error limit. */
+        std::string pwlFileName = AddToPath(GetTempUserEnchantDir(), "qaa.dic");
+        EnchantDict* pwlDict = enchant_broker_request_pwl_dict(_broker, pwlFileName.c_str());
+        if(pwlDict && !_pwlWords.empty())
+        {
+            SyntheticWords picks(99);
+            std::vector<std::string> typos;
+            for(i = 0; i < nSuggest; ++i)
+            {
+                std::string typo = _pwlWords[picks.Next() % _pwlWords.size()];
+                char& letter = typo[picks.Next() % typo.size()];
+                letter = letter == 'z' ? 'a' : letter + 1;
+                typos.push_back(typo);
+            }
+
+            start = g_get_monotonic_time ();
+            for(i = 0; i < typos.size(); ++i)
+            {
+                size_t n_suggs;
+                char ** suggs = enchant_dict_suggest(pwlDict, typos[i].c_str(),
+                                                     typos[i].size(), &n_suggs);
+                enchant_dict_free_string_list(pwlDict, suggs);
+            }
+            Report("pwl_suggest", typos.size(), start);
+        }
+        if(pwlDict)
+            FreeDictionary(pwlDict);
+
+        /* The edit distances between a misspelled word and each suggestion
+         * of the provider, from which the personal word list takes its
+         * error limit.  The en_GB personal word list is empty, so little
+         * but those comparisons, and normalizing the words for them, is
+         * left; the rate is of suggestions compared. */
+        EnchantDict* editDistDict = RequestDictionary("en_GB");
+        if(editDistDict)
+        {
+            size_t nCalls = MIN (MAX (_nWords / 10, (size_t) 1), _misspelledWords.size());
+            start = g_get_monotonic_time ();
+            for(i = 0; i < nCalls; ++i)
+            {
+                size_t n_suggs;
+                char ** suggs = enchant_dict_suggest(editDistDict, _misspelledWords[i].c_str(),
+                                                     _misspelledWords[i].size(), &n_suggs);
+                enchant_dict_free_string_list(editDistDict, suggs);
+            }
+            Report("edit_dist", nCalls * BENCH_UNRELATED_SUGGS, start);
+            FreeDictionary(editDistDict);
+        }
+
+        SyntheticWords added(1234);
+        std::vector<std::string> addedWords;
+        for(i = 0; i < _nEdits; ++i)
+            addedWords.push_back(added.Word() + "X");
+
+        start = g_get_monotonic_time ();
+        for(i = 0; i < addedWords.size(); ++i)
+            enchant_dict_add(dict, addedWords[i].c_str(), addedWords[i].size());
+        Report("pwl_add", addedWords.size(), start);
+
+        start = g_get_monotonic_time ();
+        for(i = 0; i < addedWords.size(); ++i)
+            enchant_dict_remove(dict, addedWords[i].c_str(), addedWords[i].size());
+        Report("pwl_remove", addedWords.size(), start);
+
+        FreeDictionary(dict);
+    }
+};
+
+static size_t
+ParseCount (const char * arg)
+{
+    return (size_t) g_ascii_strtoull (arg, NULL, 10);
+}
+
+int
+main (int argc, char **argv)
+{
+    size_t dictSize = 10000, pwlSize = 10000, nWords = 100000, nEdits = 1000, nInits = 100;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp (argv[i], "-dict-size") && i < argc - 1)
+            dictSize = ParseCount (argv[++i]);
+        else if (!strcmp (argv[i], "-pwl-size") && i < argc - 1)
+            pwlSize = ParseCount (argv[++i]);
+        else if (!strcmp (argv[i], "-words") && i < argc - 1)
+            nWords = ParseCount (argv[++i]);
+        else if (!strcmp (argv[i], "-edits") && i < argc - 1)
+            nEdits = ParseCount (argv[++i]);
+        else if (!strcmp (argv[i], "-inits") && i < argc - 1)
+            nInits = ParseCount (argv[++i]);
+        else {
+            printf ("%s [-dict-size n] [-pwl-size n] [-words n] [-edits n] [-inits n]\n", argv[0]);
+            return !strcmp (argv[i], "-h") ? 0 : 1;
+        }
+    }
+
+    EnchantBenchmark benchmark(dictSize, pwlSize, nWords, nEdits, nInits);
+    benchmark.Run();
+
+    return 0;
+}
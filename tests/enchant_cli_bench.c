@@ -0,0 +1,333 @@
+/* enchant
+ * Copyright (C) 2003 Dom Lachowicz
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02110-1301, USA.
+ *
+ * In addition, as a special exception, Dom Lachowicz
+ * gives permission to link the code of this program with
+ * non-LGPL Spelling Provider libraries (eg: a MSFT Office
+ * spell checker backend) and distribute linked combinations including
+ * the two.  You must obey the GNU Lesser General Public License in all
+ * respects for all of the code used other than said providers.  If you modify
+ * this file, you may extend this exception to your version of the
+ * file, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+/* Times the enchant program over a generated corpus, checked against a
+ * personal word list only, so that it needs no installed dictionaries.
+ * The corpus is the same on every run for the same options. Results are
+ * written as tab separated lines, one per mode of the program. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#define N_STAGES 5
+
+static const char * const stage_names[N_STAGES] = {
+	"read", "tokenize", "check", "suggest", "output"
+};
+
+/* Syllables of the generated words; each starts with an ASCII letter, so
+ * that a misspelling can be made after the first byte */
+static const char * const syllables[] = {
+	"ba", "be", "bi", "bo", "da", "de", "do", "fa", "fe", "ga", "go", "ka",
+	"ke", "la", "le", "li", "lo", "ma", "me", "mi", "mo", "na", "ne", "no",
+	"pa", "pe", "ra", "re", "ri", "ro", "sa", "se", "si", "so", "ta", "te",
+	"ti", "to", "va", "ve", "za", "zo", "ré", "lé", "aç", "tö", "mü", "eñ",
+	"uß", "lł", "nå", "dø"
+};
+
+static guint32 random_state;
+
+static guint32
+next_random (void)
+{
+	random_state = random_state * 1103515245 + 12345;
+	return random_state >> 16;
+}
+
+static char *
+make_word (void)
+{
+	GString * word = g_string_new (NULL);
+	guint32 i, n_syllables = 2 + next_random () % 3;
+
+	for (i = 0; i < n_syllables; i++)
+		g_string_append (word, syllables[next_random () % G_N_ELEMENTS (syllables)]);
+
+	return g_string_free (word, FALSE);
+}
+
+/* Writes the vocabulary to @pwl_file and @corpus_bytes of lines made of it
+ * to @corpus_file, with about @misspelled_percent of the words misspelled */
+static gboolean
+make_corpus (const char * pwl_file, const char * corpus_file,
+	     size_t vocabulary_size, size_t corpus_bytes, guint misspelled_percent)
+{
+	GPtrArray * vocabulary;
+	GString * pwl, * corpus;
+	gboolean ok;
+	size_t i;
+
+	vocabulary = g_ptr_array_new_with_free_func (g_free);
+	pwl = g_string_new (NULL);
+	for (i = 0; i < vocabulary_size; i++)
+		{
+			char * word = make_word ();
+
+			g_ptr_array_add (vocabulary, word);
+			g_string_append (pwl, word);
+			g_string_append_c (pwl, '\n');
+		}
+
+	corpus = g_string_sized_new (corpus_bytes + 256);
+	while (corpus->len < corpus_bytes)
+		{
+			guint32 n_words = 8 + next_random () % 9;
+
+			for (i = 0; i < n_words; i++)
+				{
+					const char * word = g_ptr_array_index (vocabulary, next_random () % vocabulary->len);
+					size_t start;
+
+					if (i > 0)
+						g_string_append (corpus, next_random () % 10 == 0 ? ", " : " ");
+					start = corpus->len;
+					g_string_append (corpus, word);
+					if (next_random () % 100 < misspelled_percent)
+						g_string_insert_c (corpus, start + 1, 'q');
+					if (i == 0)
+						corpus->str[start] = g_ascii_toupper (corpus->str[start]);
+				}
+			g_string_append (corpus, ".\n");
+		}
+
+	ok = g_file_set_contents (pwl_file, pwl->str, pwl->len, NULL) &&
+		g_file_set_contents (corpus_file, corpus->str, corpus->len, NULL);
+
+	g_string_free (corpus, TRUE);
+	g_string_free (pwl, TRUE);
+	g_ptr_array_free (vocabulary, TRUE);
+
+	return ok;
+}
+
+/* Runs @enchant in @mode over @input_file, with its output thrown away
+ * and what it writes to stderr in @stderr_file, and waits for it */
+static gboolean
+spawn_enchant (const char * enchant, const char * mode, gboolean profile,
+	       const char * pwl_file, const char * input_file, const char * stderr_file,
+	       struct rusage * usage)
+{
+	int status;
+	pid_t pid;
+
+	pid = fork ();
+	if (pid == 0)
+		{
+			int null_fd = open ("/dev/null", O_WRONLY);
+			int stderr_fd = open (stderr_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+			if (null_fd < 0 || stderr_fd < 0)
+				_exit (127);
+			dup2 (null_fd, STDOUT_FILENO);
+			dup2 (stderr_fd, STDERR_FILENO);
+			if (profile)
+				execl (enchant, enchant, mode, "-P", "-p", pwl_file, input_file, (char *) NULL);
+			else
+				execl (enchant, enchant, mode, "-p", pwl_file, input_file, (char *) NULL);
+			_exit (127);
+		}
+	if (pid < 0 || wait4 (pid, &status, 0, usage) != pid)
+		{
+			fprintf (stderr, "Error: Could not run %s\n", enchant);
+			return FALSE;
+		}
+
+	if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+		{
+			fprintf (stderr, "Error: %s %s failed\n", enchant, mode);
+			return FALSE;
+		}
+
+	return TRUE;
+}
+
+/* Runs @enchant in @mode over @corpus_file, and prints how long it took,
+ * the most memory it used and the times it reported for its stages.
+ * A run over @empty_file first builds the index of a large word list, or
+ * finds it up to date, so that every mode is timed loading it the same
+ * way. The stage times come from another run, as taking them costs time. */
+static gboolean
+run_enchant (const char * enchant, const char * mode, const char * pwl_file,
+	     const char * corpus_file, const char * empty_file, const char * stages_file)
+{
+	struct rusage usage;
+	gint64 start, usecs, stage_usecs[N_STAGES] = { 0 };
+	unsigned long n_tokens = 0;
+	char * contents, ** lines;
+	int i, j;
+
+	if (!spawn_enchant (enchant, mode, FALSE, pwl_file, empty_file, stages_file, &usage))
+		return FALSE;
+
+	start = g_get_monotonic_time ();
+	if (!spawn_enchant (enchant, mode, FALSE, pwl_file, corpus_file, stages_file, &usage))
+		return FALSE;
+	usecs = MAX (g_get_monotonic_time () - start, 1);
+
+	if (!spawn_enchant (enchant, mode, TRUE, pwl_file, corpus_file, stages_file, NULL))
+		return FALSE;
+
+	if (!g_file_get_contents (stages_file, &contents, NULL, NULL))
+		return FALSE;
+	lines = g_strsplit (contents, "\n", -1);
+	for (i = 0; lines[i]; i++)
+		{
+			char * value = strchr (lines[i], '\t');
+
+			if (value == NULL)
+				continue;
+			*value++ = '\0';
+			if (!strcmp (lines[i], "tokens"))
+				n_tokens = strtoul (value, NULL, 10);
+			for (j = 0; j < N_STAGES; j++)
+				{
+					char * name = g_strdup_printf ("%s_usecs", stage_names[j]);
+
+					if (!strcmp (lines[i], name))
+						stage_usecs[j] = g_ascii_strtoll (value, NULL, 10);
+					g_free (name);
+				}
+		}
+	g_strfreev (lines);
+	g_free (contents);
+
+	/* ru_maxrss is in kilobytes on Linux */
+	printf ("%s\t%lu\t%ld\t%.0f\t%ld", mode, n_tokens, (long) usecs,
+		n_tokens * 1e6 / usecs, (long) usage.ru_maxrss);
+	for (j = 0; j < N_STAGES; j++)
+		printf ("\t%ld", (long) stage_usecs[j]);
+	printf ("\n");
+
+	return TRUE;
+}
+
+/* Removes @dir and the files in it, whatever enchant left there */
+static void
+remove_dir (const char * dir)
+{
+	const char * name;
+	GDir * d;
+
+	d = g_dir_open (dir, 0, NULL);
+	if (d)
+		{
+			while ((name = g_dir_read_name (d)) != NULL)
+				{
+					char * filename = g_build_filename (dir, name, NULL);
+
+					g_unlink (filename);
+					g_free (filename);
+				}
+			g_dir_close (d);
+		}
+	g_rmdir (dir);
+}
+
+int
+main (int argc, char ** argv)
+{
+	const char * enchant = "../src/enchant";
+	size_t corpus_mb = 4, vocabulary_size = 20000;
+	guint misspelled_percent = 5, seed = 1;
+	char * dir, * pwl_file, * corpus_file, * empty_file, * stages_file;
+	gboolean ok;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-enchant") && i < argc - 1)
+			enchant = argv[++i];
+		else if (!strcmp (argv[i], "-size-mb") && i < argc - 1)
+			corpus_mb = strtoul (argv[++i], NULL, 10);
+		else if (!strcmp (argv[i], "-misspelled") && i < argc - 1)
+			misspelled_percent = strtoul (argv[++i], NULL, 10);
+		else if (!strcmp (argv[i], "-vocabulary") && i < argc - 1)
+			vocabulary_size = strtoul (argv[++i], NULL, 10);
+		else if (!strcmp (argv[i], "-seed") && i < argc - 1)
+			seed = strtoul (argv[++i], NULL, 10);
+		else {
+			printf ("%s [-enchant program] [-size-mb n] [-misspelled percent] [-vocabulary n] [-seed n]\n", argv[0]);
+			return strcmp (argv[i], "-h") ? 1 : 0;
+		}
+	}
+
+	misspelled_percent = MIN (misspelled_percent, 100);
+	vocabulary_size = MAX (vocabulary_size, 1);
+
+	dir = g_dir_make_tmp ("enchant-cli-bench-XXXXXX", NULL);
+	if (dir == NULL)
+		{
+			fprintf (stderr, "Error: Could not create a temporary directory.\n");
+			return 1;
+		}
+	pwl_file = g_build_filename (dir, "words.pwl", NULL);
+	corpus_file = g_build_filename (dir, "corpus.txt", NULL);
+	empty_file = g_build_filename (dir, "empty.txt", NULL);
+	stages_file = g_build_filename (dir, "stages.txt", NULL);
+
+	/* keep the user's configuration and locale out of the measurements */
+	g_setenv ("ENCHANT_CONFIG_DIR", dir, TRUE);
+	g_setenv ("LC_ALL", "C.UTF-8", TRUE);
+
+	random_state = seed;
+	ok = make_corpus (pwl_file, corpus_file, vocabulary_size, corpus_mb << 20, misspelled_percent) &&
+		g_file_set_contents (empty_file, "", 0, NULL);
+	if (ok)
+		{
+			printf ("# size_mb=%lu misspelled=%u vocabulary=%lu seed=%u\n",
+				(unsigned long) corpus_mb, misspelled_percent,
+				(unsigned long) vocabulary_size, seed);
+			printf ("mode\ttokens\tusecs\ttokens_per_sec\tmax_rss_kb");
+			for (i = 0; i < N_STAGES; i++)
+				printf ("\t%s_usecs", stage_names[i]);
+			printf ("\n");
+
+			ok = run_enchant (enchant, "-l", pwl_file, corpus_file, empty_file, stages_file) &&
+				run_enchant (enchant, "-a", pwl_file, corpus_file, empty_file, stages_file);
+		}
+	else
+		fprintf (stderr, "Error: Could not write the corpus to %s.\n", dir);
+
+	remove_dir (dir);
+	g_free (stages_file);
+	g_free (empty_file);
+	g_free (corpus_file);
+	g_free (pwl_file);
+	g_free (dir);
+
+	return ok ? 0 : 1;
+}
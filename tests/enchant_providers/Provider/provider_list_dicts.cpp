@@ -94,3 +94,21 @@ TEST_FIXTURE(ProviderListDicts_TestFixture,
     }
 }
 
+
+TEST_FIXTURE(ProviderListDicts_TestFixture, 
+             ProviderListDicts_CalledTwice_SameList)
+{
+    if(_provider->list_dicts)
+    {
+		size_t n_dicts, n_dicts_again;
+
+		_dicts = (*_provider->list_dicts) (_provider, &n_dicts);
+		char ** dicts_again = (*_provider->list_dicts) (_provider, &n_dicts_again);
+		CHECK_EQUAL(n_dicts, n_dicts_again);
+		for (size_t i = 0; i < n_dicts && i < n_dicts_again; i++)
+		{
+			CHECK_EQUAL(_dicts[i], dicts_again[i]);
+        }
+		g_strfreev (dicts_again);
+    }
+}
@@ -20,6 +20,7 @@
  */
 
 #include <unistd.h>
+#include <utime.h>
 #define NOMINMAX //don't want windows to collide with std::min
 #include <UnitTest++.h>
 #include <stdio.h>
@@ -131,6 +132,31 @@ TEST_FIXTURE(EnchantPwlWithDictSuggs_TestFixture,
   CHECK_ARRAY_EQUAL(sWords, suggestions, std::min(sWords.size(), suggestions.size()));
 }
 
+TEST_FIXTURE(EnchantPwlWithDictSuggs_TestFixture,
+             GetSuggestionsFromWord_DictSuggestionIsTransposition_ReturnsOnlyAsCloseAsDict)
+{
+  std::vector<std::string> sNoiseWords;
+  sNoiseWords.push_back("oats");
+  sNoiseWords.push_back("bass");
+
+  std::vector<std::string> sWords;
+  sWords.push_back("mast");
+  sWords.push_back("aft");
+
+  AddWordsToDictionary(sWords);
+  AddWordsToDictionary(sNoiseWords);
+
+  // "sat" is a single transposition away from "ast"
+  std::vector<std::string> suggestions = GetSuggestionsFromWord("ast");
+  sWords.push_back("sat");
+  CHECK_EQUAL(sWords.size(), suggestions.size());
+
+  std::sort(sWords.begin(), sWords.end());
+  std::sort(suggestions.begin(), suggestions.end());
+
+  CHECK_ARRAY_EQUAL(sWords, suggestions, std::min(sWords.size(), suggestions.size()));
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////
 // External File change
 TEST_FIXTURE(EnchantPwl_TestFixture, 
@@ -1581,3 +1607,437 @@ TEST_FIXTURE(EnchantPwl_TestFixture,
   CHECK_ARRAY_EQUAL(sWords, suggestions, std::min(sWords.size(), suggestions.size()));
 }
 
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// Large dictionaries are also stored as a compiled index next to the word list
+static std::vector<std::string> MakeManyWords(size_t count)
+{
+  std::vector<std::string> sWords;
+  for(size_t i = 0; i < count; ++i){
+    std::string word("qa");
+    for(size_t n = i; n != 0; n /= 26){
+      word += (char)('a' + n % 26);
+    }
+    sWords.push_back(word);
+  }
+  return sWords;
+}
+
+struct EnchantPwlIndex_TestFixture : EnchantPwl_TestFixture
+{
+  std::vector<std::string> sWords;
+
+  //Setup
+  EnchantPwlIndex_TestFixture():
+    sWords(MakeManyWords(10000))
+  {
+    ExternalAddWordsToDictionary(sWords);
+    ReloadTestDictionary();
+  }
+
+  std::string GetIndexFileName()
+  {
+    return GetPersonalDictFileName() + ".idx";
+  }
+};
+
+TEST_FIXTURE(EnchantPwlIndex_TestFixture,
+             LargeDictionary_IndexWritten)
+{
+  CHECK(g_file_test(GetIndexFileName().c_str(), G_FILE_TEST_EXISTS));
+}
+
+TEST_FIXTURE(EnchantPwlIndex_TestFixture,
+             IsWordInDictionary_LargeDictionaryLoadedFromIndex_Successful)
+{
+  GStatBuf indexStats, reloadedIndexStats;
+  CHECK(g_stat(GetIndexFileName().c_str(), &indexStats) == 0);
+
+  ReloadTestDictionary();
+
+  // the index is only read, not written again
+  CHECK(g_stat(GetIndexFileName().c_str(), &reloadedIndexStats) == 0);
+  CHECK_EQUAL(indexStats.st_ino, reloadedIndexStats.st_ino);
+
+  for(std::vector<std::string>::const_iterator itWord = sWords.begin(); itWord != sWords.end(); ++itWord){
+    CHECK( IsWordInDictionary(*itWord) );
+  }
+  CHECK(!IsWordInDictionary("qazzzzz"));
+
+  std::vector<std::string> suggestions = GetSuggestionsFromWord("qbc");
+  CHECK(std::find(suggestions.begin(), suggestions.end(), "qac") != suggestions.end());
+}
+
+TEST_FIXTURE(EnchantPwlIndex_TestFixture,
+             IsWordInDictionary_LargeDictionaryChangedExternally_IndexNotUsed)
+{
+  ExternalAddWordToDictionary("zebra");
+  ReloadTestDictionary();
+
+  CHECK( IsWordInDictionary("zebra") );
+  CHECK( IsWordInDictionary(sWords.back()) );
+}
+
+TEST_FIXTURE(EnchantPwlIndex_TestFixture,
+             IsWordInDictionary_LargeDictionaryReplacedKeepingSizeAndMtime_IndexNotUsed)
+{
+  GStatBuf stats;
+  CHECK(g_stat(GetPersonalDictFileName().c_str(), &stats) == 0);
+
+  gchar* contents;
+  gsize length;
+  CHECK(g_file_get_contents(GetPersonalDictFileName().c_str(), &contents, &length, NULL));
+  std::string text(contents, length);
+  g_free(contents);
+
+  // same size, and made to look as old as the list the index was built from
+  std::string replacement(sWords.back());
+  replacement[0] = 'z';
+  text.replace(text.rfind(sWords.back()), replacement.size(), replacement);
+  CHECK(g_file_set_contents(GetPersonalDictFileName().c_str(), text.c_str(), text.size(), NULL));
+  struct utimbuf times;
+  times.actime = stats.st_atime;
+  times.modtime = stats.st_mtime;
+  g_utime(GetPersonalDictFileName().c_str(), &times);
+
+  ReloadTestDictionary();
+
+  CHECK( IsWordInDictionary(replacement) );
+  CHECK(!IsWordInDictionary(sWords.back()) );
+}
+
+TEST_FIXTURE(EnchantPwlIndex_TestFixture,
+             IsWordInDictionary_LargeDictionaryIndexCorrupted_IndexNotUsed)
+{
+  // overwrite part of the node array in place, leaving the header and
+  // the word list alone, so that nodes refer to each other in a cycle
+  FILE* f = g_fopen(GetIndexFileName().c_str(), "r+b");
+  CHECK(f != NULL);
+  if(f == NULL)
+    return;
+  std::vector<guint32> garbage(1024, 1);
+  CHECK(fseek(f, 4096, SEEK_SET) == 0);
+  CHECK(fwrite(&garbage[0], sizeof(guint32), garbage.size(), f) == garbage.size());
+  fclose(f);
+
+  ReloadTestDictionary();
+
+  for(std::vector<std::string>::const_iterator itWord = sWords.begin(); itWord != sWords.end(); ++itWord){
+    CHECK( IsWordInDictionary(*itWord) );
+  }
+  CHECK(!IsWordInDictionary("qazzzzz"));
+
+  std::vector<std::string> suggestions = GetSuggestionsFromWord("qbc");
+  CHECK(std::find(suggestions.begin(), suggestions.end(), "qac") != suggestions.end());
+}
+
+TEST_FIXTURE(EnchantPwlIndex_TestFixture,
+             AddAndRemoveWord_LargeDictionaryLoadedFromIndex_Successful)
+{
+  ReloadTestDictionary();
+
+  AddWordToDictionary("zebra");
+  RemoveWordFromDictionary(sWords.front());
+
+  CHECK( IsWordInDictionary("zebra") );
+  CHECK(!IsWordInDictionary(sWords.front()) );
+  CHECK( IsWordInDictionary(sWords.back()) );
+}
+
+TEST_FIXTURE(EnchantPwlIndex_TestFixture,
+             IsWordInDictionary_LargeDictionaryLoadedFromIndexAppendedExternally_Successful)
+{
+  ReloadTestDictionary();
+  CHECK(!IsWordInDictionary("zebra"));
+
+  ExternalAddWordToDictionary("zebra");
+
+  CHECK( IsWordInDictionary("zebra") );
+  CHECK( IsWordInDictionary(sWords.front()) );
+  CHECK( IsWordInDictionary(sWords.back()) );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// Appending to and rewriting the file externally
+
+static void ExternalWriteFile(const std::string& filename, const std::string& contents, const char* mode)
+{
+  sleep(1); // c runtime library's time_t has a 1 second resolution
+  FILE * f = g_fopen(filename.c_str(), mode);
+  if(f)
+  {
+    fputs(contents.c_str(), f);
+    fclose(f);
+  }
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             IsWordInDictionary_LastLineCompletedExternally_OnlyCompletedWord)
+{
+  ExternalWriteFile(GetPersonalDictFileName(), "cat\nhel", "ab");
+  CHECK( IsWordInDictionary("hel") );
+
+  ExternalWriteFile(GetPersonalDictFileName(), "lo\n", "ab");
+
+  CHECK( IsWordInDictionary("cat") );
+  CHECK( IsWordInDictionary("hello") );
+  CHECK(!IsWordInDictionary("hel") );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             IsWordInDictionary_LastLineDuplicateCompletedExternally_EarlierWordKept)
+{
+  ExternalWriteFile(GetPersonalDictFileName(), "hel\nhel", "ab");
+  CHECK( IsWordInDictionary("hel") );
+
+  ExternalWriteFile(GetPersonalDictFileName(), "lo\n", "ab");
+
+  CHECK( IsWordInDictionary("hel") );
+  CHECK( IsWordInDictionary("hello") );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             IsWordInDictionary_DictionaryRewrittenExternally_RemovedWordsGone)
+{
+  ExternalWriteFile(GetPersonalDictFileName(), "cat\nhat\n", "ab");
+  CHECK( IsWordInDictionary("cat") );
+
+  // the same file, rewritten longer than before
+  ExternalWriteFile(GetPersonalDictFileName(), "hat\ntot\nbat\n", "wb");
+
+  CHECK(!IsWordInDictionary("cat") );
+  CHECK( IsWordInDictionary("hat") );
+  CHECK( IsWordInDictionary("tot") );
+  CHECK( IsWordInDictionary("bat") );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             IsWordInDictionary_DictionaryReplacedExternally_RemovedWordsGone)
+{
+  ExternalWriteFile(GetPersonalDictFileName(), "cat\nhat\n", "ab");
+  CHECK( IsWordInDictionary("cat") );
+
+  // a different file put in its place
+  std::string replacement = GetPersonalDictFileName() + ".new";
+  ExternalWriteFile(replacement, "hat\ntot\n", "wb");
+  CHECK(g_rename(replacement.c_str(), GetPersonalDictFileName().c_str()) == 0);
+
+  CHECK(!IsWordInDictionary("cat") );
+  CHECK( IsWordInDictionary("hat") );
+  CHECK( IsWordInDictionary("tot") );
+}
+
+static void ExternalWriteFileAtOnce(const std::string& filename, const std::string& contents, const char* mode)
+{
+  FILE * f = g_fopen(filename.c_str(), mode);
+  if(f)
+  {
+    fputs(contents.c_str(), f);
+    fclose(f);
+  }
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             IsWordInDictionary_AddedExternallyInSameSecond_Successful)
+{
+  ExternalWriteFile(GetPersonalDictFileName(), "cat\n", "ab");
+  CHECK( IsWordInDictionary("cat") );
+
+  // no waiting for the modification time to change
+  ExternalWriteFileAtOnce(GetPersonalDictFileName(), "hat\n", "ab");
+
+  CHECK( IsWordInDictionary("cat") );
+  CHECK( IsWordInDictionary("hat") );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             IsWordInDictionary_RemovedExternallyInSameSecond_NotInDictionary)
+{
+  ExternalWriteFile(GetPersonalDictFileName(), "cat\nhat\n", "ab");
+  CHECK( IsWordInDictionary("cat") );
+
+  ExternalWriteFileAtOnce(GetPersonalDictFileName(), "#!remove cat\n", "ab");
+
+  CHECK(!IsWordInDictionary("cat") );
+  CHECK( IsWordInDictionary("hat") );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             IsWordInDictionary_RewrittenExternallyInSameSecondKeepingSize_Successful)
+{
+  ExternalWriteFile(GetPersonalDictFileName(), "cat\nhat\n", "ab");
+  CHECK( IsWordInDictionary("cat") );
+
+  ExternalWriteFileAtOnce(GetPersonalDictFileName(), "cat\nbat\n", "wb");
+
+  CHECK( IsWordInDictionary("cat") );
+  CHECK( IsWordInDictionary("bat") );
+  CHECK(!IsWordInDictionary("hat") );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             IsWordInDictionary_AppendedExternallyAfterAdd_Successful)
+{
+  AddWordToDictionary("hello");
+  ExternalAddWordToDictionary("world");
+  AddWordToDictionary("cat");
+  ExternalAddWordToDictionary("hat");
+
+  CHECK( IsWordInDictionary("hello") );
+  CHECK( IsWordInDictionary("world") );
+  CHECK( IsWordInDictionary("cat") );
+  CHECK( IsWordInDictionary("hat") );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// Removal by appending to the file
+
+static std::string GetFileContents(const std::string& filename)
+{
+  gchar* contents = NULL;
+  std::string result;
+  if(g_file_get_contents(filename.c_str(), &contents, NULL, NULL))
+    result = contents;
+  g_free(contents);
+  return result;
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             RemoveWord_ManyWordsLeft_RemovalAppended)
+{
+  std::vector<std::string> sWords;
+  sWords.push_back("cat");
+  sWords.push_back("hat");
+  sWords.push_back("that");
+  sWords.push_back("bat");
+  sWords.push_back("tot");
+  AddWordsToDictionary(sWords);
+
+  RemoveWordFromDictionary("hat");
+
+  CHECK_EQUAL("cat\nhat\nthat\nbat\ntot\n#!remove hat\n", GetFileContents(GetPersonalDictFileName()));
+  CHECK(!IsWordInDictionary("hat"));
+
+  ReloadTestDictionary();
+  CHECK(!IsWordInDictionary("hat"));
+  CHECK( IsWordInDictionary("cat"));
+  CHECK( IsWordInDictionary("tot"));
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             RemoveWord_MostWordsRemoved_FileCompacted)
+{
+  ExternalWriteFile(GetPersonalDictFileName(), "# my words\ncat\nhat\ncat\nthat\nbat\n", "ab");
+
+  RemoveWordFromDictionary("hat");
+  RemoveWordFromDictionary("cat");
+
+  CHECK_EQUAL("# my words\nthat\nbat\n", GetFileContents(GetPersonalDictFileName()));
+  CHECK(!IsWordInDictionary("hat"));
+  CHECK(!IsWordInDictionary("cat"));
+  CHECK( IsWordInDictionary("that"));
+  CHECK( IsWordInDictionary("bat"));
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             AddWord_PreviouslyRemoved_Successful)
+{
+  std::vector<std::string> sWords;
+  sWords.push_back("cat");
+  sWords.push_back("hat");
+  sWords.push_back("that");
+  sWords.push_back("bat");
+  AddWordsToDictionary(sWords);
+
+  RemoveWordFromDictionary("cat");
+  AddWordToDictionary("cat");
+  CHECK( IsWordInDictionary("cat"));
+
+  ReloadTestDictionary();
+  CHECK( IsWordInDictionary("cat"));
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             IsWordInDictionary_RemovedExternally_False)
+{
+  std::vector<std::string> sWords;
+  sWords.push_back("cat");
+  sWords.push_back("hat");
+  sWords.push_back("that");
+  AddWordsToDictionary(sWords);
+
+  ExternalWriteFile(GetPersonalDictFileName(), "#!remove hat\n", "ab");
+
+  CHECK(!IsWordInDictionary("hat"));
+  CHECK( IsWordInDictionary("cat"));
+}
+
+TEST_FIXTURE(EnchantPwlIndex_TestFixture,
+             RemoveWord_LargeDictionaryLoadedFromIndex_RemovedAfterReload)
+{
+  ReloadTestDictionary();
+
+  RemoveWordFromDictionary(sWords.front());
+  ReloadTestDictionary();
+
+  CHECK(!IsWordInDictionary(sWords.front()) );
+  CHECK( IsWordInDictionary(sWords.back()) );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// Words looked up through the Bloom filter of small lists
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             IsWordInDictionary_ManyWordsAdded_AllFound)
+{
+  std::vector<std::string> sWords = MakeManyWords(3000);
+  ExternalAddWordsToDictionary(sWords);
+  ReloadTestDictionary();
+
+  for(size_t i = 0; i < sWords.size(); ++i){
+    CHECK( IsWordInDictionary(sWords[i]) );
+  }
+  CHECK(!IsWordInDictionary("qb") );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             IsWordInDictionary_TooManyWordsForFilter_AllFound)
+{
+  std::vector<std::string> sWords = MakeManyWords(5000);
+  ExternalAddWordsToDictionary(sWords);
+  ReloadTestDictionary();
+
+  for(size_t i = 0; i < sWords.size(); ++i){
+    CHECK( IsWordInDictionary(sWords[i]) );
+  }
+  CHECK(!IsWordInDictionary("qb") );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             IsWordInDictionary_AddedDecomposedLower_AllCapsComposedSuccessful)
+{
+  AddWordToDictionary("fiance\xcc\x81");  // e followed by u0301 = combining acute accent
+
+  CHECK( IsWordInDictionary("FIANC\xc3\x89") );  // c3 89 = utf8 for u00c9 = Latin capital letter E with acute
+  CHECK( IsWordInDictionary("Fianc\xc3\xa9") );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             IsWordInDictionary_AddedLowerWithFinalSigma_AllCapsSuccessful)
+{
+  AddWordToDictionary("\xce\xbb\xcf\x8c\xce\xb3\xce\xbf\xcf\x82");  // lowercase logos, ending in final sigma
+
+  CHECK( IsWordInDictionary("\xce\x9b\xce\x8c\xce\x93\xce\x9f\xce\xa3") );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture,
+             IsWordInDictionary_RemovedFromSmallDictionary_False)
+{
+  AddWordToDictionary("cat");
+  AddWordToDictionary("hat");
+  RemoveWordFromDictionary("cat");
+
+  CHECK(!IsWordInDictionary("cat") );
+  CHECK(!IsWordInDictionary("Cat") );
+  CHECK( IsWordInDictionary("hat") );
+}